@@ -0,0 +1,444 @@
+// snn_bench: builds synthetic networks of increasing size through the regular YAML loader and
+// reports load and simulation performance as JSON, so that releases can be compared.
+//
+//   snn_bench [--sizes 1000,10000,100000,1000000] [--rule fixed_out_degree|fixed_in_degree|probabilistic]
+//             [--degree 100] [--steps 1000] [--warmup 100] [--threads 1] [--processes 1] [--dt 0.5]
+//             [--seed 1] [--weight-format full|int16|int8]
+//             [--input none|noise|poisson] [--input-interval 1] [--output results.json]
+//
+// Every network has an excitatory group E (75% RS, 5% tonically firing PM neurons that keep the
+// network active without external input) and an inhibitory group I (20% FS). Every neuron has
+// about 'degree' outgoing synapses, split between E and I in proportion to their sizes.
+// With --processes above 1 the network runs as a PartitionedSNN (Linux only), every process
+// single-threaded; peak_rss_bytes is then that of the calling process only.
+// On Linux the cache and dTLB load misses of the timed steps are read from the hardware counters
+// (perf_event_open) of the calling thread, so they cover the whole step only with --threads 1;
+// they are -1 where the counters are not available. synapse_bytes is the memory of the synapse
+// matrix after loading, which --weight-format int16 or int8 reduces (SNN_CONFIGURATION.md,
+// 'weight_format').
+// --input adds background input to every neuron ('inputs'): the Gaussian thalamic noise of
+// Izhikevich (2003), std 5 for E and 2 for I, or 100 Poisson sources of 10 Hz with weight 3, drawn
+// every --input-interval steps ('interval').
+#include "SNN.hpp"
+#include "NetworkTopologyLoader.hpp"
+#include "PartitionedSNN.hpp"
+#include "IzhikevichKernels.hpp"
+#include "SNNParseException.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#include <unistd.h>
+#endif
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#endif
+
+struct BenchOptions {
+    std::vector<int> sizes = {1000, 10000, 100000, 1000000};
+    std::string rule = "fixed_out_degree";
+    int degree = 100;
+    int steps = 1000;
+    int warmup = 100;
+    int threads = 1;
+    int processes = 1;
+    double dt = 0.5;
+    unsigned long long seed = 1;
+    std::string weightFormat = "full";
+    std::string input = "none";
+    int inputInterval = 1;
+    std::string output; // empty = stdout
+};
+
+struct BenchResult {
+    int neurons = 0;
+    size_t synapses = 0;
+    size_t synapseBytes = 0;
+    NetworkTopologyLoader::LoadTimings load;
+    double initSeconds = 0;
+    double stepSeconds = 0;
+    unsigned long long spikes = 0;
+    unsigned long long synapticEvents = 0;
+    long long peakRssBytes = 0;
+    long long cacheMisses = -1;
+    long long dtlbLoadMisses = -1;
+};
+
+// Hardware event counter of the calling thread, user space only. value() is -1 if the counter
+// could not be opened (not Linux, no PMU, or perf_event_paranoid forbids it).
+class PerfCounter {
+public:
+    PerfCounter(uint32_t type, uint64_t config) {
+#ifdef __linux__
+        perf_event_attr attr;
+        std::memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = type;
+        attr.config = config;
+        attr.disabled = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        fd = static_cast<int>(::syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+#else
+        (void)type;
+        (void)config;
+#endif
+    }
+    PerfCounter(const PerfCounter&) = delete;
+    PerfCounter& operator=(const PerfCounter&) = delete;
+    ~PerfCounter() {
+#ifdef __linux__
+        if (fd >= 0) {
+            ::close(fd);
+        }
+#endif
+    }
+
+    void start() {
+#ifdef __linux__
+        if (fd >= 0) {
+            ::ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+            ::ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+        }
+#endif
+    }
+    void stop() {
+#ifdef __linux__
+        if (fd >= 0) {
+            ::ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+        }
+#endif
+    }
+    long long value() const {
+#ifdef __linux__
+        long long count = 0;
+        if (fd >= 0 && ::read(fd, &count, sizeof(count)) == static_cast<ssize_t>(sizeof(count))) {
+            return count;
+        }
+#endif
+        return -1;
+    }
+
+private:
+    int fd = -1;
+};
+
+// process-wide peak, so sizes are run in increasing order
+static long long peakRssBytes() {
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+        return static_cast<long long>(counters.PeakWorkingSetSize);
+    }
+    return -1;
+#else
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) {
+        return -1;
+    }
+#ifdef __APPLE__
+    return static_cast<long long>(usage.ru_maxrss);
+#else
+    return static_cast<long long>(usage.ru_maxrss) * 1024;
+#endif
+#endif
+}
+
+static std::string connectionYaml(const std::string& from, const std::string& fromType, const std::string& to,
+                                  const std::string& toType, const BenchOptions& options, int neurons,
+                                  int fromCount, int toCount, double minWeight, double maxWeight) {
+    std::ostringstream yaml;
+    yaml << "  - from: " << from << "\n    to: " << to << "\n"
+         << "    from_type: " << fromType << "\n    to_type: " << toType << "\n";
+    if (options.rule == "probabilistic") {
+        const double probability = std::min(1.0, static_cast<double>(options.degree) / neurons);
+        yaml << "    rule: {type: probabilistic, probability: " << probability << "}\n";
+    } else if (options.rule == "fixed_in_degree") {
+        // the share of the in-degree coming from this source group
+        const int count = std::max(1, static_cast<int>(static_cast<long long>(options.degree) * fromCount / neurons));
+        yaml << "    rule: {type: fixed_in_degree, count: " << count << "}\n";
+    } else {
+        const int count = std::max(1, static_cast<int>(static_cast<long long>(options.degree) * toCount / neurons));
+        yaml << "    rule: {type: fixed_out_degree, count: " << count << "}\n";
+    }
+    yaml << "    weight: {uniform: {min: " << minWeight << ", max: " << maxWeight << "}}\n";
+    return yaml.str();
+}
+
+static std::string networkYaml(const BenchOptions& options, int neurons) {
+    const int pacemakers = std::max(1, neurons / 20);
+    const int inhibitory = std::max(1, neurons / 5);
+    const int regular = std::max(1, neurons - pacemakers - inhibitory);
+    const int excitatory = regular + pacemakers;
+    const int total = excitatory + inhibitory;
+    // total input per neuron as in Izhikevich (2003): 0.5 * rand excitatory, -1 * rand inhibitory at 1000 inputs
+    const double scale = 1000.0 / std::max(1, options.degree);
+
+    std::ostringstream yaml;
+    yaml << "simulation:\n  seed: " << options.seed << "\n  threads: " << options.threads << "\n"
+         << "  weight_format: " << options.weightFormat << "\n"
+         << "neuron_types:\n"
+         << "  RS: {a: 0.02, b: 0.2, c: -65.0, d: 8.0, v0: -70.0, u0: -14.0}\n"
+         << "  PM: {a: 0.02, b: 0.25, c: -65.0, d: 6.0, v0: -64.0, u0: -16.0}\n"
+         << "  FS: {a: 0.1, b: 0.2, c: -65.0, d: 2.0, v0: -70.0, u0: -14.0}\n"
+         << "groups:\n"
+         << "  - name: \"E\"\n    neurons:\n"
+         << "      - {type: RS, count: " << regular << "}\n"
+         << "      - {type: PM, count: " << pacemakers << "}\n"
+         << "  - name: \"I\"\n    neurons:\n"
+         << "      - {type: FS, count: " << inhibitory << "}\n"
+         << "connections:\n"
+         << connectionYaml("E", "all", "E", "all", options, total, excitatory, excitatory, 0.0, 0.5 * scale)
+         << connectionYaml("E", "all", "I", "all", options, total, excitatory, inhibitory, 0.0, 0.5 * scale)
+         << connectionYaml("I", "all", "E", "all", options, total, inhibitory, excitatory, -1.0 * scale, 0.0)
+         << connectionYaml("I", "all", "I", "all", options, total, inhibitory, inhibitory, -1.0 * scale, 0.0);
+    const std::string interval = "interval: " + std::to_string(options.inputInterval);
+    if (options.input == "noise") {
+        yaml << "inputs:\n"
+             << "  - {group: E, type: noise, std: 5.0, " << interval << "}\n"
+             << "  - {group: I, type: noise, std: 2.0, " << interval << "}\n";
+    } else if (options.input == "poisson") {
+        yaml << "inputs:\n"
+             << "  - {group: E, type: poisson, rate: 10.0, sources: 100, weight: 3.0, " << interval << "}\n"
+             << "  - {group: I, type: poisson, rate: 10.0, sources: 100, weight: 3.0, " << interval << "}\n";
+    }
+    return yaml.str();
+}
+
+template<typename T>
+static size_t vectorBytes(const std::vector<T>& values) {
+    return values.size() * sizeof(T);
+}
+
+// Stored synapses, full or compact; procedural projections are not counted.
+static size_t synapseMatrixBytes(const SynapseMatrix& synapses) {
+    const CompactSynapses<SNNScalar>& compact = synapses.compact;
+    return vectorBytes(synapses.offsets) + vectorBytes(synapses.targets) + vectorBytes(synapses.weights) +
+           vectorBytes(synapses.delays) + vectorBytes(compact.rowScales) + vectorBytes(compact.weights8) +
+           vectorBytes(compact.weights16) + vectorBytes(compact.delays8) + vectorBytes(compact.rowSegments) +
+           vectorBytes(compact.segmentStarts) + vectorBytes(compact.segmentBases) + vectorBytes(compact.targetOffsets);
+}
+
+// SNN or PartitionedSNN
+template<typename Network>
+static void runSteps(Network& snn, const BenchOptions& options, const std::vector<size_t>& outDegree, BenchResult& result) {
+    for (int s = 0; s < options.warmup; s++) {
+        snn.step(options.dt);
+    }
+#ifdef __linux__
+    PerfCounter cacheMisses(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES);
+    PerfCounter dtlbLoadMisses(PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                                                   (PERF_COUNT_HW_CACHE_RESULT_MISS << 16));
+#else
+    PerfCounter cacheMisses(0, 0);
+    PerfCounter dtlbLoadMisses(0, 0);
+#endif
+    cacheMisses.start();
+    dtlbLoadMisses.start();
+    const auto stepStart = std::chrono::steady_clock::now();
+    for (int s = 0; s < options.steps; s++) {
+        snn.step(options.dt);
+        const int* fired = snn.getFiredNeurons();
+        for (int f = 0; f < snn.getFiredCount(); f++) {
+            result.synapticEvents += outDegree[fired[f]];
+        }
+        result.spikes += snn.getFiredCount();
+    }
+    result.stepSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - stepStart).count();
+    cacheMisses.stop();
+    dtlbLoadMisses.stop();
+    result.cacheMisses = cacheMisses.value();
+    result.dtlbLoadMisses = dtlbLoadMisses.value();
+}
+
+static BenchResult runSize(const BenchOptions& options, int neurons) {
+    BenchResult result;
+    const std::string yamlPath = "snn_bench_" + std::to_string(neurons) + ".yaml";
+    {
+        std::ofstream out(yamlPath);
+        out << networkYaml(options, neurons);
+        if (!out) {
+            throw std::runtime_error("Nie mozna zapisac pliku " + yamlPath);
+        }
+    }
+
+    NetworkTopologyLoader loader;
+    loader.setVerbose(false); // keep stdout clean for the JSON
+    NetworkTopologyLoader::ConfigData config = loader.loadFromYaml<SNNScalar>(yamlPath);
+    std::remove(yamlPath.c_str());
+    result.load = loader.getLoadTimings();
+    result.neurons = config.totalNeuronCount;
+    result.synapses = config.synapses.targets.size();
+
+    const auto initStart = std::chrono::steady_clock::now();
+    auto topology = NetworkTopology::createUnique(std::move(config));
+    result.synapseBytes = synapseMatrixBytes(topology->synapses);
+    std::vector<size_t> outDegree(result.neurons);
+    for (int i = 0; i < result.neurons; i++) {
+        outDegree[i] = topology->synapses.offsets[i + 1] - topology->synapses.offsets[i];
+    }
+    if (options.processes > 1) {
+        PartitionedSNN snn(std::move(topology), options.processes); // frees the full matrix once it is sliced
+        result.initSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - initStart).count();
+        runSteps(snn, options, outDegree, result);
+    } else {
+        SNN snn(std::move(topology));
+        result.initSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - initStart).count();
+        runSteps(snn, options, outDegree, result);
+    }
+    result.peakRssBytes = peakRssBytes();
+    return result;
+}
+
+static std::string toJson(const BenchOptions& options, const std::vector<BenchResult>& results) {
+    std::ostringstream json;
+    json.precision(9);
+    json << "{\n"
+         << "  \"benchmark\": \"snn_bench\",\n"
+         << "  \"scalar\": \"" << (sizeof(SNNScalar) == sizeof(float) ? "float" : "double") << "\",\n"
+         << "  \"kernel\": \"" << IzhikevichKernels::kernelName<SNNScalar>(IzhikevichKernels::selectIntegrateKernel<SNNScalar>()) << "\",\n"
+         << "  \"rule\": \"" << options.rule << "\",\n"
+         << "  \"degree\": " << options.degree << ",\n"
+         << "  \"threads\": " << options.threads << ",\n"
+         << "  \"processes\": " << options.processes << ",\n"
+         << "  \"weight_format\": \"" << options.weightFormat << "\",\n"
+         << "  \"input\": \"" << options.input << "\",\n"
+         << "  \"input_interval\": " << options.inputInterval << ",\n"
+         << "  \"steps\": " << options.steps << ",\n"
+         << "  \"warmup_steps\": " << options.warmup << ",\n"
+         << "  \"dt_ms\": " << options.dt << ",\n"
+         << "  \"seed\": " << options.seed << ",\n"
+         << "  \"results\": [";
+    for (size_t r = 0; r < results.size(); r++) {
+        const BenchResult& result = results[r];
+        const double neuronUpdates = static_cast<double>(result.neurons) * options.steps;
+        const double simulatedSeconds = options.steps * options.dt / 1000.0;
+        json << (r == 0 ? "\n" : ",\n")
+             << "    {\n"
+             << "      \"neurons\": " << result.neurons << ",\n"
+             << "      \"synapses\": " << result.synapses << ",\n"
+             << "      \"synapse_bytes\": " << result.synapseBytes << ",\n"
+             << "      \"yaml_parse_s\": " << result.load.parseSeconds << ",\n"
+             << "      \"synapse_generation_s\": " << result.load.generationSeconds << ",\n"
+             << "      \"matrix_build_s\": " << result.load.matrixSeconds << ",\n"
+             << "      \"network_init_s\": " << result.initSeconds << ",\n"
+             << "      \"peak_rss_bytes\": " << result.peakRssBytes << ",\n"
+             << "      \"step_time_s\": " << result.stepSeconds << ",\n"
+             << "      \"steps_per_s\": " << options.steps / result.stepSeconds << ",\n"
+             << "      \"synaptic_events\": " << result.synapticEvents << ",\n"
+             << "      \"synaptic_events_per_s\": " << result.synapticEvents / result.stepSeconds << ",\n"
+             << "      \"ns_per_neuron_update\": " << result.stepSeconds * 1e9 / neuronUpdates << ",\n"
+             << "      \"cache_misses\": " << result.cacheMisses << ",\n"
+             << "      \"dtlb_load_misses\": " << result.dtlbLoadMisses << ",\n"
+             << "      \"spikes\": " << result.spikes << ",\n"
+             << "      \"mean_rate_hz\": " << result.spikes / (static_cast<double>(result.neurons) * simulatedSeconds) << "\n"
+             << "    }";
+    }
+    json << "\n  ]\n}\n";
+    return json.str();
+}
+
+static BenchOptions parseArguments(int argc, char** argv) {
+    BenchOptions options;
+    for (int a = 1; a < argc; a++) {
+        const std::string key = argv[a];
+        if (a + 1 >= argc) {
+            throw std::runtime_error("Brak wartosci dla argumentu " + key);
+        }
+        const std::string value = argv[++a];
+        if (key == "--sizes") {
+            options.sizes.clear();
+            std::istringstream list(value);
+            std::string item;
+            while (std::getline(list, item, ',')) {
+                options.sizes.push_back(std::stoi(item));
+            }
+        } else if (key == "--rule") {
+            if (value != "fixed_out_degree" && value != "fixed_in_degree" && value != "probabilistic") {
+                throw std::runtime_error("Nieznana regula: " + value);
+            }
+            options.rule = value;
+        } else if (key == "--degree") {
+            options.degree = std::stoi(value);
+        } else if (key == "--steps") {
+            options.steps = std::stoi(value);
+        } else if (key == "--warmup") {
+            options.warmup = std::stoi(value);
+        } else if (key == "--threads") {
+            options.threads = std::stoi(value);
+        } else if (key == "--processes") {
+            options.processes = std::stoi(value);
+        } else if (key == "--dt") {
+            options.dt = std::stod(value);
+        } else if (key == "--seed") {
+            options.seed = std::stoull(value);
+        } else if (key == "--weight-format") {
+            if (value != "full" && value != "int16" && value != "int8") {
+                throw std::runtime_error("Nieznany format wag: " + value);
+            }
+            options.weightFormat = value;
+        } else if (key == "--input") {
+            if (value != "none" && value != "noise" && value != "poisson") {
+                throw std::runtime_error("Nieznane wejscie: " + value);
+            }
+            options.input = value;
+        } else if (key == "--input-interval") {
+            options.inputInterval = std::stoi(value);
+        } else if (key == "--output") {
+            options.output = value;
+        } else {
+            throw std::runtime_error("Nieznany argument: " + key);
+        }
+    }
+    if (options.steps < 1 || options.degree < 1 || options.processes < 1 || options.sizes.empty()) {
+        throw std::runtime_error("--steps, --degree, --processes i --sizes musza byc dodatnie.");
+    }
+    std::sort(options.sizes.begin(), options.sizes.end());
+    return options;
+}
+
+int main(int argc, char** argv) {
+    try {
+        const BenchOptions options = parseArguments(argc, argv);
+        std::vector<BenchResult> results;
+        for (int neurons : options.sizes) {
+            std::cerr << "snn_bench: " << neurons << " neuronow...\n";
+            results.push_back(runSize(options, neurons));
+        }
+        const std::string json = toJson(options, results);
+        if (options.output.empty()) {
+            std::cout << json;
+        } else {
+            std::ofstream out(options.output);
+            out << json;
+            if (!out) {
+                throw std::runtime_error("Nie mozna zapisac pliku " + options.output);
+            }
+        }
+    }
+    catch (const SNNParseException& e) {
+        std::cerr << "Blad konfiguracji: " << e.what() << "\n";
+        return EXIT_FAILURE;
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Blad: " << e.what() << "\n";
+        return EXIT_FAILURE;
+    }
+    return 0;
+}
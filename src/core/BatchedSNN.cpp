@@ -0,0 +1,238 @@
+#include "BatchedSNN.hpp"
+#include "IzhikevichKernels.hpp"
+#include "ProceduralSynapses.hpp"
+#include "ThreadPool.hpp"
+#include <algorithm>
+#include <stdexcept>
+
+template<typename Scalar>
+BasicBatchedSNN<Scalar>::BasicBatchedSNN(const std::string& filename, int batchSize)
+    : BasicBatchedSNN(Topology::load(filename), batchSize) {
+}
+
+template<typename Scalar>
+BasicBatchedSNN<Scalar>::BasicBatchedSNN(std::shared_ptr<const Topology> sharedTopology, int batchSize)
+    : topology(std::move(sharedTopology)), batchSize(batchSize) {
+    if (!topology) {
+        throw std::runtime_error("Brak topologii sieci dla symulacji wsadowej.");
+    }
+    if (batchSize <= 0) {
+        throw std::runtime_error("Liczba instancji symulacji wsadowej musi byc dodatnia.");
+    }
+    if (topology->synapses.isCompact()) {
+        throw std::runtime_error("Symulacja wsadowa nie obsluguje skompresowanych wag ('weight_format').");
+    }
+    if (topology->isPlastic()) {
+        // the instances share one weight array, so they cannot learn independently
+        throw std::runtime_error("Symulacja wsadowa nie obsluguje plastycznosci ('plasticity').");
+    }
+    if (!topology->inputs.empty()) {
+        // every instance would need its own input stream (BasicSNN::setInputStream)
+        throw std::runtime_error("Symulacja wsadowa nie obsluguje wejsc tla ('inputs').");
+    }
+    neuronCount = topology->totalNeuronCount;
+
+    // every instance starts from the initial state of the network
+    v.resize(slotSize());
+    u.resize(slotSize());
+    for (int i = 0; i < neuronCount; i++) {
+        std::fill(v.begin() + index(i, 0), v.begin() + index(i + 1, 0), topology->initialV[i]);
+        std::fill(u.begin() + index(i, 0), u.begin() + index(i + 1, 0), topology->initialU[i]);
+    }
+    spiked.assign(slotSize(), Scalar(0));
+
+    const size_t typeCount = topology->neuronParamTypes.size();
+    paramA.resize(typeCount * batchSize);
+    paramB.resize(typeCount * batchSize);
+    paramC.resize(typeCount * batchSize);
+    paramD.resize(typeCount * batchSize);
+    for (size_t t = 0; t < typeCount; t++) {
+        const IzhikevichParams& params = topology->neuronParamTypes[t];
+        for (int k = 0; k < batchSize; k++) {
+            paramA[t * batchSize + k] = static_cast<Scalar>(params.a);
+            paramB[t * batchSize + k] = static_cast<Scalar>(params.b);
+            paramC[t * batchSize + k] = static_cast<Scalar>(params.c);
+            paramD[t * batchSize + k] = static_cast<Scalar>(params.d);
+        }
+    }
+
+    I.resize(static_cast<size_t>(topology->synapses.maxDelay) * slotSize(), Scalar(0));
+    delaySlots.resize(topology->synapses.maxDelay + 1, nullptr);
+    firedAny.resize(neuronCount);
+    instanceFired.resize(batchSize);
+
+    integrateTask = [this](int partition) { integratePartition(partition); };
+    deliverTask = [this](int partition) { deliverPartition(partition); };
+    setThreadCount(topology->simulation.threads);
+}
+
+template<typename Scalar>
+BasicBatchedSNN<Scalar>::~BasicBatchedSNN() = default;
+
+template<typename Scalar>
+void BasicBatchedSNN<Scalar>::setThreadCount(int threads) {
+    threadPool = std::make_unique<ThreadPool>(threads);
+    const int partitions = threadPool->size();
+
+    // equal shares of neurons; with a batch a neuron already spans batchSize scalars,
+    // so the bounds are not aligned
+    partitionBounds.assign(partitions + 1, neuronCount);
+    partitionBounds[0] = 0;
+    for (int p = 1; p < partitions; p++) {
+        partitionBounds[p] = static_cast<int>(static_cast<long long>(neuronCount) * p / partitions);
+    }
+
+    partitionRuns.assign(partitions, {});
+    for (int p = 0; p < partitions; p++) {
+        const int lo = partitionBounds[p];
+        const int hi = partitionBounds[p + 1];
+        for (const NeuronInfo& run : topology->neuronRuns) {
+            const int start = std::max(lo, run.startIndex);
+            const int end = std::min(hi, run.startIndex + run.count);
+            if (start < end) {
+                partitionRuns[p].push_back({run.typeId, end - start, start});
+            }
+        }
+    }
+    partitionFiredCounts.assign(partitions, 0);
+}
+
+template<typename Scalar>
+int BasicBatchedSNN<Scalar>::getThreadCount() const {
+    return threadPool->size();
+}
+
+template<typename Scalar>
+void BasicBatchedSNN<Scalar>::checkInstance(int instance, int neuron) const {
+    if (instance < 0 || instance >= batchSize) {
+        throw std::runtime_error("Instancja " + std::to_string(instance) + " jest poza symulacja wsadowa.");
+    }
+    if (neuron < 0 || neuron >= neuronCount) {
+        throw std::runtime_error("Neuron " + std::to_string(neuron) + " jest poza siecia.");
+    }
+}
+
+template<typename Scalar>
+void BasicBatchedSNN<Scalar>::setInstanceParams(int instance, const std::string& typeName, const IzhikevichParams& params) {
+    checkInstance(instance, 0);
+    const auto type = topology->neuronTypeToIdMap.find(typeName);
+    if (type == topology->neuronTypeToIdMap.end()) {
+        throw std::runtime_error("Nieznany typ neuronu '" + typeName + "'.");
+    }
+    const size_t k = static_cast<size_t>(type->second) * batchSize + instance;
+    paramA[k] = static_cast<Scalar>(params.a);
+    paramB[k] = static_cast<Scalar>(params.b);
+    paramC[k] = static_cast<Scalar>(params.c);
+    paramD[k] = static_cast<Scalar>(params.d);
+}
+
+template<typename Scalar>
+void BasicBatchedSNN<Scalar>::setState(int instance, int neuron, double vValue, double uValue) {
+    checkInstance(instance, neuron);
+    v[index(neuron, instance)] = static_cast<Scalar>(vValue);
+    u[index(neuron, instance)] = static_cast<Scalar>(uValue);
+}
+
+template<typename Scalar>
+void BasicBatchedSNN<Scalar>::injectCurrent(int instance, int neuron, double current) {
+    checkInstance(instance, neuron);
+    currentInput()[index(neuron, instance)] += static_cast<Scalar>(current);
+}
+
+template<typename Scalar>
+void BasicBatchedSNN<Scalar>::step(double dt) {
+    stepDt = static_cast<Scalar>(dt);
+    stepInput = currentInput();
+
+    const int maxDelay = topology->synapses.maxDelay;
+    for (int d = 1; d <= maxDelay; d++) {
+        delaySlots[d] = I.data() + ((currentStep + d) % maxDelay) * slotSize();
+    }
+
+    threadPool->run(integrateTask);
+
+    // gather the neurons that fired in any instance, then split them per instance
+    firedCount = 0;
+    for (size_t p = 0; p < partitionFiredCounts.size(); p++) {
+        const int* first = firedAny.data() + partitionBounds[p];
+        std::copy(first, first + partitionFiredCounts[p], firedAny.data() + firedCount);
+        firedCount += partitionFiredCounts[p];
+    }
+    for (auto& fired : instanceFired) {
+        fired.clear();
+    }
+    for (int f = 0; f < firedCount; f++) {
+        const int neuron = firedAny[f];
+        const Scalar* spikes = spiked.data() + index(neuron, 0);
+        for (int k = 0; k < batchSize; k++) {
+            if (spikes[k] != Scalar(0)) {
+                instanceFired[k].push_back(neuron);
+            }
+        }
+    }
+
+    threadPool->run(deliverTask);
+    currentStep++;
+}
+
+template<typename Scalar>
+void BasicBatchedSNN<Scalar>::integratePartition(int partition) {
+    int* fired = firedAny.data() + partitionBounds[partition];
+    int count = 0;
+    for (const NeuronInfo& run : partitionRuns[partition]) {
+        const size_t params = static_cast<size_t>(run.typeId) * batchSize;
+        count += IzhikevichKernels::integrateBatch(v.data(), u.data(), stepInput, spiked.data(),
+                                                   run.startIndex, run.count, batchSize,
+                                                   paramA.data() + params, paramB.data() + params,
+                                                   paramC.data() + params, paramD.data() + params,
+                                                   stepDt, fired + count);
+    }
+    partitionFiredCounts[partition] = count;
+
+    // this slot has been consumed, it becomes the slot for spikes delayed by maxDelay steps
+    std::fill(stepInput + index(partitionBounds[partition], 0),
+              stepInput + index(partitionBounds[partition + 1], 0), Scalar(0));
+}
+
+template<typename Scalar>
+void BasicBatchedSNN<Scalar>::deliverPartition(int partition) {
+    // one pass over each fired neuron's row serves all instances: an instance in which the
+    // neuron did not fire receives weight * 0
+    const BasicSynapseMatrix<Scalar>& synapses = topology->synapses;
+    const int lo = partitionBounds[partition];
+    const int hi = partitionBounds[partition + 1];
+    const int* targets = synapses.targets.data();
+    const int batch = batchSize;
+    for (int f = 0; f < firedCount; f++) {
+        const int neuron = firedAny[f];
+        const Scalar* spikes = spiked.data() + index(neuron, 0);
+        const int* rowBegin = targets + synapses.offsets[neuron];
+        const int* rowEnd = targets + synapses.offsets[neuron + 1];
+        const int* target = lo > 0 ? std::lower_bound(rowBegin, rowEnd, lo) : rowBegin;
+        for (; target != rowEnd && *target < hi; ++target) {
+            const size_t s = target - targets;
+            const Scalar weight = synapses.weights[s];
+            Scalar* destination = delaySlots[synapses.delays[s]] + index(*target, 0);
+            for (int k = 0; k < batch; k++) {
+                destination[k] += weight * spikes[k];
+            }
+        }
+        if (synapses.procedural.empty()) {
+            continue;
+        }
+        for (size_t p = synapses.proceduralOffsets[neuron]; p < synapses.proceduralOffsets[neuron + 1]; p++) {
+            const ProceduralProjection& projection = synapses.procedural[synapses.proceduralIndex[p]];
+            Scalar* slot = delaySlots[projection.delay];
+            forEachProceduralSynapse(projection, neuron, lo, hi, [&](int targetIdx, double value) {
+                const Scalar weight = static_cast<Scalar>(value);
+                Scalar* destination = slot + index(targetIdx, 0);
+                for (int k = 0; k < batch; k++) {
+                    destination[k] += weight * spikes[k];
+                }
+            });
+        }
+    }
+}
+
+template class BasicBatchedSNN<float>;
+template class BasicBatchedSNN<double>;
@@ -0,0 +1,93 @@
+#ifndef BATCHED_SNN_HPP
+#define BATCHED_SNN_HPP
+
+#include "SNN.hpp"
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+/**
+ * @brief B independent instances of one network advanced together (parameter sweeps, ensembles).
+ *
+ * All instances share one BasicNetworkTopology. The state is stored as [neuron][batch], so the
+ * integration loop runs over the contiguous instances of a neuron and vectorizes, and a spike's
+ * synapse row is fetched once for all instances: every target receives weight * spiked[instance]
+ * for the whole batch at once. Each instance can have its own neuron type parameters, state and
+ * injected currents. Per instance the dynamics are the same as those of BasicSNN. Networks with
+ * plasticity, compact weights or background inputs are rejected by the constructor.
+ */
+template<typename Scalar>
+class BasicBatchedSNN {
+public:
+    using Topology = BasicNetworkTopology<Scalar>;
+
+    BasicBatchedSNN(std::shared_ptr<const Topology> topology, int batchSize);
+    BasicBatchedSNN(const std::string& filename, int batchSize);
+    BasicBatchedSNN(const BasicBatchedSNN&) = delete;
+    BasicBatchedSNN& operator=(const BasicBatchedSNN&) = delete;
+    ~BasicBatchedSNN();
+
+    void step(double dt); // Advance all instances by dt milliseconds
+
+    void setThreadCount(int threads); // 0 = one per hardware thread
+    int getThreadCount() const;
+
+    // Parameters a, b, c, d of a neuron type in one instance (v0 and u0 are not used).
+    void setInstanceParams(int instance, const std::string& typeName, const IzhikevichParams& params);
+    void setState(int instance, int neuron, double vValue, double uValue);
+    // Added to the input current of the neuron in the next step.
+    void injectCurrent(int instance, int neuron, double current);
+
+    Scalar getV(int instance, int neuron) const { return v[index(neuron, instance)]; }
+    Scalar getU(int instance, int neuron) const { return u[index(neuron, instance)]; }
+    const std::vector<int>& getFiredNeurons(int instance) const { return instanceFired[instance]; }
+    int getBatchSize() const { return batchSize; }
+    int getNeuronCount() const { return topology->totalNeuronCount; }
+    long long getCurrentStep() const { return currentStep; }
+    const std::shared_ptr<const Topology>& getTopology() const { return topology; }
+
+private:
+    std::shared_ptr<const Topology> topology;
+    int batchSize;
+    int neuronCount;
+
+    // per instance state, [neuron][batch]
+    std::vector<Scalar> v;
+    std::vector<Scalar> u;
+    std::vector<Scalar> spiked; // 1 if the instance's neuron fired in the last step, else 0
+    // per instance parameters, [type][batch]
+    std::vector<Scalar> paramA, paramB, paramC, paramD;
+
+    // Input currents as a circular delay buffer of maxDelay slots, as in BasicSNN, of [neuron][batch]
+    std::vector<Scalar> I;
+    long long currentStep = 0;
+    std::vector<Scalar*> delaySlots;
+    std::vector<int> firedAny; // neurons that fired in at least one instance, first firedCount entries
+    int firedCount = 0;
+    std::vector<std::vector<int>> instanceFired;
+
+    std::unique_ptr<ThreadPool> threadPool;
+    std::vector<int> partitionBounds;
+    std::vector<std::vector<NeuronInfo>> partitionRuns;
+    std::vector<int> partitionFiredCounts;
+    std::function<void(int)> integrateTask;
+    std::function<void(int)> deliverTask;
+    Scalar stepDt = 0;
+    Scalar* stepInput = nullptr;
+
+    size_t index(int neuron, int instance) const { return static_cast<size_t>(neuron) * batchSize + instance; }
+    size_t slotSize() const { return static_cast<size_t>(neuronCount) * batchSize; }
+    Scalar* currentInput() { return I.data() + (currentStep % topology->synapses.maxDelay) * slotSize(); }
+    void checkInstance(int instance, int neuron) const;
+    void integratePartition(int partition);
+    void deliverPartition(int partition);
+};
+
+// explicitly instantiated in BatchedSNN.cpp
+extern template class BasicBatchedSNN<float>;
+extern template class BasicBatchedSNN<double>;
+
+using BatchedSNN = BasicBatchedSNN<SNNScalar>;
+
+#endif // BATCHED_SNN_HPP
@@ -0,0 +1,192 @@
+#include "CompactSynapses.hpp"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+
+namespace {
+
+// Synapses dequantized at once by deliverCompactRow, a few vector registers of weights.
+constexpr size_t DELIVERY_BLOCK = 64;
+
+template<typename Scalar, typename Quantized>
+std::vector<Quantized> quantizeWeights(const BasicSynapseMatrix<Scalar>& synapses, int neuronCount,
+                                       std::vector<Scalar>& rowScales) {
+    constexpr Scalar largest = std::numeric_limits<Quantized>::max();
+    std::vector<Quantized> quantized(synapses.weights.size());
+    rowScales.assign(neuronCount, Scalar(0));
+    for (int row = 0; row < neuronCount; row++) {
+        const size_t begin = synapses.offsets[row];
+        const size_t end = synapses.offsets[row + 1];
+        Scalar maxAbs = 0;
+        for (size_t s = begin; s < end; s++) {
+            maxAbs = std::max(maxAbs, std::abs(synapses.weights[s]));
+        }
+        if (maxAbs == 0) {
+            continue; // all zero, quantized stays 0
+        }
+        const Scalar scale = maxAbs / largest;
+        rowScales[row] = scale;
+        for (size_t s = begin; s < end; s++) {
+            const Scalar value = std::round(synapses.weights[s] / scale);
+            quantized[s] = static_cast<Quantized>(std::max(-largest, std::min(largest, value)));
+        }
+    }
+    return quantized;
+}
+
+// Splits every row into runs of targets less than 65536 apart, the segments of CompactSynapses.
+// Rows are sorted by target, so a segment starts at its smallest target.
+template<typename Scalar>
+void buildSegments(const BasicSynapseMatrix<Scalar>& synapses, int neuronCount, CompactSynapses<Scalar>& compact) {
+    constexpr int span = std::numeric_limits<uint16_t>::max() + 1;
+    compact.rowSegments.assign(neuronCount + 1, 0);
+    compact.segmentStarts.clear();
+    compact.segmentBases.clear();
+    for (int row = 0; row < neuronCount; row++) {
+        compact.rowSegments[row] = compact.segmentBases.size();
+        for (size_t s = synapses.offsets[row]; s < synapses.offsets[row + 1]; s++) {
+            if (compact.segmentBases.size() == compact.rowSegments[row] ||
+                synapses.targets[s] - compact.segmentBases.back() >= span) {
+                compact.segmentStarts.push_back(s);
+                compact.segmentBases.push_back(synapses.targets[s]);
+            }
+        }
+    }
+    compact.rowSegments[neuronCount] = compact.segmentBases.size();
+    compact.segmentStarts.push_back(synapses.targets.size());
+}
+
+template<typename Scalar, typename Quantized, typename Delay, bool Segmented>
+uint64_t deliverRow(const BasicSynapseMatrix<Scalar>& synapses, const Quantized* quantized, const Delay* delays, int neuron,
+                    int lo, int hi, Scalar* const* delaySlots) {
+    const CompactSynapses<Scalar>& compact = synapses.compact;
+    const Scalar scale = compact.rowScales[neuron];
+    Scalar block[DELIVERY_BLOCK];
+    uint64_t delivered = 0;
+
+    // [begin, end) with the targets base + offsets[s] (or targets[s])
+    const auto deliverRange = [&](size_t begin, size_t end, int base, const uint16_t* offsets, const int* targets) {
+        for (size_t blockBegin = begin; blockBegin < end; blockBegin += DELIVERY_BLOCK) {
+            const size_t count = std::min(DELIVERY_BLOCK, end - blockBegin);
+            const Quantized* q = quantized + blockBegin;
+            for (size_t k = 0; k < count; k++) {
+                block[k] = static_cast<Scalar>(q[k]) * scale;
+            }
+            for (size_t k = 0; k < count; k++) {
+                const size_t s = blockBegin + k;
+                const int target = Segmented ? base + offsets[s] : targets[s];
+                delaySlots[delays[s]][target] += block[k];
+            }
+        }
+        delivered += end - begin;
+    };
+
+    if (!Segmented) {
+        // rows are sorted by target: only the part inside [lo, hi) belongs to this partition
+        const int* targets = synapses.targets.data();
+        const int* rowBegin = targets + synapses.offsets[neuron];
+        const int* rowEnd = targets + synapses.offsets[neuron + 1];
+        const int* first = std::lower_bound(rowBegin, rowEnd, lo);
+        const int* last = std::lower_bound(first, rowEnd, hi);
+        deliverRange(first - targets, last - targets, 0, nullptr, targets);
+        return delivered;
+    }
+    const uint16_t* offsets = compact.targetOffsets.data();
+    for (size_t segment = compact.rowSegments[neuron]; segment < compact.rowSegments[neuron + 1]; segment++) {
+        const int base = compact.segmentBases[segment];
+        if (base >= hi) {
+            break;
+        }
+        size_t begin = compact.segmentStarts[segment];
+        size_t end = compact.segmentStarts[segment + 1];
+        if (end - begin == 0 || base + offsets[end - 1] < lo) {
+            continue;
+        }
+        // offsets grow within a segment
+        begin = std::lower_bound(offsets + begin, offsets + end, lo - base,
+                                 [](uint16_t offset, int value) { return offset < value; }) - offsets;
+        end = std::lower_bound(offsets + begin, offsets + end, hi - base,
+                               [](uint16_t offset, int value) { return offset < value; }) - offsets;
+        deliverRange(begin, end, base, offsets, nullptr);
+    }
+    return delivered;
+}
+
+template<typename Scalar, typename Quantized, typename Delay>
+uint64_t deliverRow(const BasicSynapseMatrix<Scalar>& synapses, const Quantized* quantized, const Delay* delays, int neuron,
+                    int lo, int hi, Scalar* const* delaySlots) {
+    return synapses.compact.targetOffsets.empty()
+               ? deliverRow<Scalar, Quantized, Delay, false>(synapses, quantized, delays, neuron, lo, hi, delaySlots)
+               : deliverRow<Scalar, Quantized, Delay, true>(synapses, quantized, delays, neuron, lo, hi, delaySlots);
+}
+
+template<typename Scalar, typename Quantized>
+uint64_t deliverRow(const BasicSynapseMatrix<Scalar>& synapses, const Quantized* quantized, int neuron, int lo, int hi,
+                    Scalar* const* delaySlots) {
+    const std::vector<uint8_t>& delays8 = synapses.compact.delays8;
+    return delays8.empty() ? deliverRow(synapses, quantized, synapses.delays.data(), neuron, lo, hi, delaySlots)
+                           : deliverRow(synapses, quantized, delays8.data(), neuron, lo, hi, delaySlots);
+}
+
+} // namespace
+
+template<typename Scalar>
+void compactSynapseMatrix(BasicSynapseMatrix<Scalar>& synapses, int weightBits) {
+    if (weightBits != 8 && weightBits != 16) {
+        throw std::runtime_error("Nieobslugiwana liczba bitow wag: " + std::to_string(weightBits) + ".");
+    }
+    if (!synapses.plasticity.empty()) {
+        throw std::runtime_error("Skompresowane wagi ('weight_format') nie obsluguja plastycznosci.");
+    }
+    if (synapses.isCompact()) {
+        return;
+    }
+    const int neuronCount = static_cast<int>(synapses.offsets.size()) - 1;
+    CompactSynapses<Scalar>& compact = synapses.compact;
+    if (weightBits == 8) {
+        compact.weights8 = quantizeWeights<Scalar, int8_t>(synapses, neuronCount, compact.rowScales);
+    } else {
+        compact.weights16 = quantizeWeights<Scalar, int16_t>(synapses, neuronCount, compact.rowScales);
+    }
+    compact.weightBits = weightBits;
+    std::vector<Scalar>().swap(synapses.weights);
+
+    if (synapses.maxDelay <= std::numeric_limits<uint8_t>::max()) {
+        compact.delays8.assign(synapses.delays.begin(), synapses.delays.end());
+        std::vector<uint16_t>().swap(synapses.delays);
+    }
+
+    // 16-bit offsets save 2 bytes per synapse, the segments cost their bases and starts
+    buildSegments(synapses, neuronCount, compact);
+    const size_t segmentBytes = compact.rowSegments.size() * sizeof(size_t) +
+                                compact.segmentStarts.size() * sizeof(size_t) +
+                                compact.segmentBases.size() * sizeof(int);
+    const size_t savedBytes = synapses.targets.size() * (sizeof(int) - sizeof(uint16_t));
+    if (segmentBytes >= savedBytes) {
+        std::vector<size_t>().swap(compact.rowSegments);
+        std::vector<size_t>().swap(compact.segmentStarts);
+        std::vector<int>().swap(compact.segmentBases);
+        return;
+    }
+    compact.targetOffsets.resize(synapses.targets.size());
+    for (size_t segment = 0; segment < compact.segmentBases.size(); segment++) {
+        for (size_t s = compact.segmentStarts[segment]; s < compact.segmentStarts[segment + 1]; s++) {
+            compact.targetOffsets[s] = static_cast<uint16_t>(synapses.targets[s] - compact.segmentBases[segment]);
+        }
+    }
+    std::vector<int>().swap(synapses.targets);
+}
+
+template<typename Scalar>
+uint64_t deliverCompactRow(const BasicSynapseMatrix<Scalar>& synapses, int neuron, int lo, int hi,
+                           Scalar* const* delaySlots) {
+    const CompactSynapses<Scalar>& compact = synapses.compact;
+    return compact.weightBits == 8 ? deliverRow(synapses, compact.weights8.data(), neuron, lo, hi, delaySlots)
+                                   : deliverRow(synapses, compact.weights16.data(), neuron, lo, hi, delaySlots);
+}
+
+template void compactSynapseMatrix<float>(BasicSynapseMatrix<float>&, int);
+template void compactSynapseMatrix<double>(BasicSynapseMatrix<double>&, int);
+template uint64_t deliverCompactRow<float>(const BasicSynapseMatrix<float>&, int, int, int, float* const*);
+template uint64_t deliverCompactRow<double>(const BasicSynapseMatrix<double>&, int, int, int, double* const*);
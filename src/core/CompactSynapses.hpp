@@ -0,0 +1,58 @@
+#ifndef COMPACT_SYNAPSES_HPP
+#define COMPACT_SYNAPSES_HPP
+
+#include "SNN.hpp"
+#include <cstdint>
+
+// Converts the weights of the matrix to weightBits-bit integers with one scale per row (the
+// largest magnitude of the row maps to the largest integer), and the targets to 16-bit offsets
+// from the base of their row segment when that takes less memory than 32-bit targets (see
+// CompactSynapses), and the delays to bytes when maxDelay allows. Frees the arrays that are no
+// longer used; offsets stay.
+template<typename Scalar>
+void compactSynapseMatrix(BasicSynapseMatrix<Scalar>& synapses, int weightBits);
+
+// Adds the dequantized weights of the synapses of row neuron whose target lies in [lo, hi) to
+// delaySlots[delay][target], as BasicSNN::deliverPartition does for a full matrix. Blocks of
+// weights are dequantized into a buffer first, which the compiler vectorizes, then scattered.
+// Returns the number of synapses delivered.
+template<typename Scalar>
+uint64_t deliverCompactRow(const BasicSynapseMatrix<Scalar>& synapses, int neuron, int lo, int hi,
+                           Scalar* const* delaySlots);
+
+// Calls fn(target, weight, delay) for the synapses of row neuron in target order, for a full or a
+// compact matrix. For code outside the delivery loop, e.g. to copy rows.
+template<typename Scalar, typename Fn>
+void forEachSynapse(const BasicSynapseMatrix<Scalar>& synapses, int neuron, Fn&& fn) {
+    const CompactSynapses<Scalar>& compact = synapses.compact;
+    const size_t begin = synapses.offsets[neuron];
+    const size_t end = synapses.offsets[neuron + 1];
+    if (compact.weightBits == 0) {
+        for (size_t s = begin; s < end; s++) {
+            fn(synapses.targets[s], synapses.weights[s], static_cast<int>(synapses.delays[s]));
+        }
+        return;
+    }
+    const Scalar scale = compact.rowScales[neuron];
+    const auto weightOf = [&](size_t s) {
+        return compact.weightBits == 8 ? static_cast<Scalar>(compact.weights8[s]) * scale
+                                       : static_cast<Scalar>(compact.weights16[s]) * scale;
+    };
+    const auto delayOf = [&](size_t s) {
+        return compact.delays8.empty() ? static_cast<int>(synapses.delays[s]) : static_cast<int>(compact.delays8[s]);
+    };
+    if (compact.targetOffsets.empty()) {
+        for (size_t s = begin; s < end; s++) {
+            fn(synapses.targets[s], weightOf(s), delayOf(s));
+        }
+        return;
+    }
+    for (size_t segment = compact.rowSegments[neuron]; segment < compact.rowSegments[neuron + 1]; segment++) {
+        const int base = compact.segmentBases[segment];
+        for (size_t s = compact.segmentStarts[segment]; s < compact.segmentStarts[segment + 1]; s++) {
+            fn(base + compact.targetOffsets[s], weightOf(s), delayOf(s));
+        }
+    }
+}
+
+#endif // COMPACT_SYNAPSES_HPP
@@ -0,0 +1,419 @@
+#include "InputGenerator.hpp"
+#include "CounterRng.hpp"
+#include "IzhikevichKernels.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define SNN_X86_KERNELS 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#define SNN_TARGET(isa)
+#else
+#define SNN_TARGET(isa) __attribute__((target(isa)))
+#endif
+#endif
+
+#if defined(_MSC_VER)
+#define SNN_FORCE_INLINE __forceinline
+#else
+#define SNN_FORCE_INLINE inline __attribute__((always_inline))
+#endif
+
+namespace {
+
+constexpr int BLOCKS = 64;                 // Philox blocks generated at once
+constexpr int CHUNK = 4 * BLOCKS;          // neurons served by them, see addCurrents
+constexpr size_t MAX_POISSON_TABLE = 1024; // largest spike count per step that can be drawn
+constexpr uint64_t INPUT_KEY = 0x9E3779B97F4A7C15ull; // separates the input streams from the connection streams
+
+using Words = uint32_t[4][BLOCKS]; // words[j][k] = word j of block k
+
+// The kernels of one instruction set. The conversions are the same source compiled for each
+// target and use no FMA contraction, so every variant gives bit-identical values.
+struct Kernels {
+    // Philox4x32-10 of the counters (blocks[k], c1, c2, c3) for k < count. blocks holds BLOCKS
+    // entries, the SIMD variants may compute (and write) the lanes after count as well.
+    void (*philox)(const uint32_t* blocks, int count, uint32_t c1, uint32_t c2, uint32_t c3, uint64_t key, Words& words);
+    // a pair of standard normal values from a radius word and an angle word (Box-Muller)
+    void (*normals)(const uint32_t* radiusWords, const uint32_t* angleWords, int count, float* cosines, float* sines);
+    // spike counts: the number of the ascending thresholds each word reaches
+    void (*poisson)(const uint32_t* words, int count, const uint32_t* thresholds, size_t thresholdCount, float* counts);
+};
+
+void philoxScalar(const uint32_t* blocks, int count, uint32_t c1, uint32_t c2, uint32_t c3, uint64_t key, Words& words) {
+    for (int k = 0; k < count; k++) {
+        const uint32_t counter[4] = {blocks[k], c1, c2, c3};
+        uint32_t out[4];
+        CounterRng::philox(counter, key, out);
+        for (int j = 0; j < 4; j++) {
+            words[j][k] = out[j];
+        }
+    }
+}
+
+// ln(x) for x in (0, 1): exponent from the bits, the mantissa moved into [sqrt(1/2), sqrt(2)) and
+// ln(m) = 2 atanh((m - 1) / (m + 1)) from its series. Integer selects only, so loops vectorize.
+SNN_FORCE_INLINE float logUnit(float x) {
+    uint32_t bits;
+    std::memcpy(&bits, &x, sizeof(bits));
+    const uint32_t mantissa = bits & 0x007FFFFFu;
+    const uint32_t large = mantissa > 0x003504F3u ? 1u : 0u; // 1.m above sqrt(2), halved
+    const float exponent = static_cast<float>(static_cast<int32_t>((bits >> 23) + large) - 127);
+    bits = mantissa | ((0x7Fu - large) << 23);
+    float m;
+    std::memcpy(&m, &bits, sizeof(m));
+    const float t = (m - 1.0f) / (m + 1.0f);
+    const float t2 = t * t;
+    const float series = 1.0f + t2 * (1.0f / 3 + t2 * (1.0f / 5 + t2 * (1.0f / 7 + t2 * (1.0f / 9))));
+    return exponent * 0.693147181f + 2.0f * t * series;
+}
+
+SNN_FORCE_INLINE void normalsImpl(const uint32_t* radiusWords, const uint32_t* angleWords, int count,
+                                  float* cosines, float* sines) {
+    for (int k = 0; k < count; k++) {
+        // u in (0, 1) from the top 24 bits, never 0
+        const float u = (static_cast<float>(static_cast<int32_t>(radiusWords[k] >> 8)) + 0.5f) * (1.0f / 16777216.0f);
+        const float radius = std::sqrt(-2.0f * logUnit(u));
+        // angle q pi/2 + x: quarter turn q from the top 2 bits, x in [-pi/4, pi/4) from the next 24,
+        // where the series below are accurate to 3e-7
+        const uint32_t quadrant = angleWords[k] >> 30;
+        const float x = static_cast<float>(static_cast<int32_t>((angleWords[k] >> 6) & 0x00FFFFFFu) - 0x00800000) *
+                        (1.57079633f / 16777216.0f);
+        const float x2 = x * x;
+        const float sine = x * (1.0f + x2 * (-1.0f / 6 + x2 * (1.0f / 120 + x2 * (-1.0f / 5040))));
+        const float cosine = 1.0f + x2 * (-1.0f / 2 + x2 * (1.0f / 24 + x2 * (-1.0f / 720 + x2 * (1.0f / 40320))));
+        // rotated by the quadrant: cos(q pi/2 + x) is sine in odd quadrants and negative in the
+        // second and third, sin(q pi/2 + x) is cosine in odd quadrants and negative in the last two
+        uint32_t sineBits, cosineBits;
+        std::memcpy(&sineBits, &sine, sizeof(sineBits));
+        std::memcpy(&cosineBits, &cosine, sizeof(cosineBits));
+        const uint32_t odd = 0u - (quadrant & 1u);
+        const uint32_t cosineResult = ((sineBits & odd) | (cosineBits & ~odd)) ^ (((quadrant + 1u) & 2u) << 30);
+        const uint32_t sineResult = ((cosineBits & odd) | (sineBits & ~odd)) ^ ((quadrant & 2u) << 30);
+        float cosineValue, sineValue;
+        std::memcpy(&cosineValue, &cosineResult, sizeof(cosineValue));
+        std::memcpy(&sineValue, &sineResult, sizeof(sineValue));
+        cosines[k] = radius * cosineValue;
+        sines[k] = radius * sineValue;
+    }
+}
+
+SNN_FORCE_INLINE void poissonImpl(const uint32_t* words, int count, const uint32_t* thresholds, size_t thresholdCount,
+                                  float* counts) {
+    uint32_t largest = 0;
+    for (int k = 0; k < count; k++) {
+        largest = std::max(largest, words[k]);
+    }
+    uint32_t reached[BLOCKS] = {};
+    // thresholds ascend, none above largest can be reached
+    for (size_t j = 0; j < thresholdCount && thresholds[j] <= largest; j++) {
+        const uint32_t threshold = thresholds[j];
+        for (int k = 0; k < count; k++) {
+            reached[k] += words[k] >= threshold ? 1u : 0u;
+        }
+    }
+    for (int k = 0; k < count; k++) {
+        counts[k] = static_cast<float>(static_cast<int32_t>(reached[k]));
+    }
+}
+
+void normalsScalar(const uint32_t* radiusWords, const uint32_t* angleWords, int count, float* cosines, float* sines) {
+    normalsImpl(radiusWords, angleWords, count, cosines, sines);
+}
+
+void poissonScalar(const uint32_t* words, int count, const uint32_t* thresholds, size_t thresholdCount, float* counts) {
+    poissonImpl(words, count, thresholds, thresholdCount, counts);
+}
+
+#ifdef SNN_X86_KERNELS
+
+struct Avx2Words {
+    using Vec = __m256i;
+    static constexpr int WIDTH = 8;
+    SNN_TARGET("avx2") static Vec set1(uint32_t x) { return _mm256_set1_epi32(static_cast<int>(x)); }
+    SNN_TARGET("avx2") static Vec load(const uint32_t* p) { return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)); }
+    SNN_TARGET("avx2") static void store(uint32_t* p, Vec x) { _mm256_storeu_si256(reinterpret_cast<__m256i*>(p), x); }
+    SNN_TARGET("avx2") static Vec bitXor(Vec x, Vec y) { return _mm256_xor_si256(x, y); }
+    SNN_TARGET("avx2") static Vec bitXor(Vec x, Vec y, Vec z) { return _mm256_xor_si256(_mm256_xor_si256(x, y), z); }
+    struct Product {
+        Vec hi, lo;
+    };
+    // high and low halves of the 32x32-bit products of the lanes of a with m
+    SNN_TARGET("avx2") static Product mulHiLo(Vec a, Vec m) {
+        const Vec even = _mm256_mul_epu32(a, m);                       // lanes 0, 2, 4, 6
+        const Vec odd = _mm256_mul_epu32(_mm256_srli_epi64(a, 32), m); // lanes 1, 3, 5, 7
+        return {_mm256_blend_epi32(_mm256_srli_epi64(even, 32), odd, 0xAA),
+                _mm256_blend_epi32(even, _mm256_slli_epi64(odd, 32), 0xAA)};
+    }
+};
+
+struct Avx512Words {
+    using Vec = __m512i;
+    static constexpr int WIDTH = 16;
+    SNN_TARGET("avx512f") static Vec set1(uint32_t x) { return _mm512_set1_epi32(static_cast<int>(x)); }
+    SNN_TARGET("avx512f") static Vec load(const uint32_t* p) { return _mm512_loadu_si512(p); }
+    SNN_TARGET("avx512f") static void store(uint32_t* p, Vec x) { _mm512_storeu_si512(p, x); }
+    SNN_TARGET("avx512f") static Vec bitXor(Vec x, Vec y) { return _mm512_xor_si512(x, y); }
+    SNN_TARGET("avx512f") static Vec bitXor(Vec x, Vec y, Vec z) { return _mm512_ternarylogic_epi32(x, y, z, 0x96); }
+    struct Product {
+        Vec hi, lo;
+    };
+    // 512-bit shifts and multiplications share one port, the lanes are moved by shuffles instead.
+    // The unmasked intrinsics pass an undefined vector that GCC 12 reports as uninitialized, the
+    // zero-masked ones with every lane selected compile to the same instructions.
+    SNN_TARGET("avx512f") static Product mulHiLo(Vec a, Vec m) {
+        const Vec even = _mm512_maskz_mul_epu32(0xFF, a, m);
+        const Vec odd = _mm512_maskz_mul_epu32(0xFF, _mm512_maskz_shuffle_epi32(0xFFFF, a, _MM_PERM_DDBB), m);
+        return {_mm512_mask_shuffle_epi32(odd, 0x5555, even, _MM_PERM_DDBB),
+                _mm512_mask_shuffle_epi32(even, 0xAAAA, odd, _MM_PERM_CCAA)};
+    }
+};
+
+// Independent vectors of counters per round, enough to hide the latency of the multiplications.
+constexpr int VECTORS = 4;
+static_assert(BLOCKS % (VECTORS * Avx512Words::WIDTH) == 0, "philox writes whole groups of vectors");
+
+// The rounds of CounterRng::philox on many counters at once. The AVX2 and AVX-512 bodies are
+// identical apart from the target attribute, as in IzhikevichKernels.cpp.
+SNN_TARGET("avx2")
+void philoxAvx2(const uint32_t* blocks, int count, uint32_t c1, uint32_t c2, uint32_t c3, uint64_t key, Words& words) {
+    using Ops = Avx2Words;
+    const typename Ops::Vec m0 = Ops::set1(0xD2511F53u);
+    const typename Ops::Vec m1 = Ops::set1(0xCD9E8D57u);
+    // whole groups of VECTORS vectors, lanes past count are computed and ignored
+    for (int k = 0; k < count; k += VECTORS * Ops::WIDTH) {
+        typename Ops::Vec x0[VECTORS], x1[VECTORS], x2[VECTORS], x3[VECTORS];
+        for (int v = 0; v < VECTORS; v++) {
+            x0[v] = Ops::load(blocks + k + v * Ops::WIDTH);
+            x1[v] = Ops::set1(c1);
+            x2[v] = Ops::set1(c2);
+            x3[v] = Ops::set1(c3);
+        }
+        uint32_t k0 = static_cast<uint32_t>(key), k1 = static_cast<uint32_t>(key >> 32);
+        for (int round = 0; round < 10; round++) {
+            const typename Ops::Vec key0 = Ops::set1(k0);
+            const typename Ops::Vec key1 = Ops::set1(k1);
+            for (int v = 0; v < VECTORS; v++) {
+                const typename Ops::Product p0 = Ops::mulHiLo(x0[v], m0);
+                const typename Ops::Product p1 = Ops::mulHiLo(x2[v], m1);
+                x0[v] = Ops::bitXor(p1.hi, x1[v], key0);
+                x1[v] = p1.lo;
+                x2[v] = Ops::bitXor(p0.hi, x3[v], key1);
+                x3[v] = p0.lo;
+            }
+            k0 += 0x9E3779B9u;
+            k1 += 0xBB67AE85u;
+        }
+        for (int v = 0; v < VECTORS; v++) {
+            Ops::store(words[0] + k + v * Ops::WIDTH, x0[v]);
+            Ops::store(words[1] + k + v * Ops::WIDTH, x1[v]);
+            Ops::store(words[2] + k + v * Ops::WIDTH, x2[v]);
+            Ops::store(words[3] + k + v * Ops::WIDTH, x3[v]);
+        }
+    }
+}
+
+SNN_TARGET("avx512f")
+void philoxAvx512(const uint32_t* blocks, int count, uint32_t c1, uint32_t c2, uint32_t c3, uint64_t key, Words& words) {
+    using Ops = Avx512Words;
+    const typename Ops::Vec m0 = Ops::set1(0xD2511F53u);
+    const typename Ops::Vec m1 = Ops::set1(0xCD9E8D57u);
+    // whole groups of VECTORS vectors, lanes past count are computed and ignored
+    for (int k = 0; k < count; k += VECTORS * Ops::WIDTH) {
+        typename Ops::Vec x0[VECTORS], x1[VECTORS], x2[VECTORS], x3[VECTORS];
+        for (int v = 0; v < VECTORS; v++) {
+            x0[v] = Ops::load(blocks + k + v * Ops::WIDTH);
+            x1[v] = Ops::set1(c1);
+            x2[v] = Ops::set1(c2);
+            x3[v] = Ops::set1(c3);
+        }
+        uint32_t k0 = static_cast<uint32_t>(key), k1 = static_cast<uint32_t>(key >> 32);
+        for (int round = 0; round < 10; round++) {
+            const typename Ops::Vec key0 = Ops::set1(k0);
+            const typename Ops::Vec key1 = Ops::set1(k1);
+            for (int v = 0; v < VECTORS; v++) {
+                const typename Ops::Product p0 = Ops::mulHiLo(x0[v], m0);
+                const typename Ops::Product p1 = Ops::mulHiLo(x2[v], m1);
+                x0[v] = Ops::bitXor(p1.hi, x1[v], key0);
+                x1[v] = p1.lo;
+                x2[v] = Ops::bitXor(p0.hi, x3[v], key1);
+                x3[v] = p0.lo;
+            }
+            k0 += 0x9E3779B9u;
+            k1 += 0xBB67AE85u;
+        }
+        for (int v = 0; v < VECTORS; v++) {
+            Ops::store(words[0] + k + v * Ops::WIDTH, x0[v]);
+            Ops::store(words[1] + k + v * Ops::WIDTH, x1[v]);
+            Ops::store(words[2] + k + v * Ops::WIDTH, x2[v]);
+            Ops::store(words[3] + k + v * Ops::WIDTH, x3[v]);
+        }
+    }
+}
+
+SNN_TARGET("avx2")
+void normalsAvx2(const uint32_t* radiusWords, const uint32_t* angleWords, int count, float* cosines, float* sines) {
+    normalsImpl(radiusWords, angleWords, count, cosines, sines);
+}
+
+SNN_TARGET("avx2")
+void poissonAvx2(const uint32_t* words, int count, const uint32_t* thresholds, size_t thresholdCount, float* counts) {
+    poissonImpl(words, count, thresholds, thresholdCount, counts);
+}
+
+SNN_TARGET("avx512f")
+void normalsAvx512(const uint32_t* radiusWords, const uint32_t* angleWords, int count, float* cosines, float* sines) {
+    normalsImpl(radiusWords, angleWords, count, cosines, sines);
+}
+
+SNN_TARGET("avx512f")
+void poissonAvx512(const uint32_t* words, int count, const uint32_t* thresholds, size_t thresholdCount, float* counts) {
+    poissonImpl(words, count, thresholds, thresholdCount, counts);
+}
+
+Kernels selectKernels() {
+    switch (IzhikevichKernels::cpuLevel()) {
+        case IzhikevichKernels::CpuLevel::Avx512:
+            return {philoxAvx512, normalsAvx512, poissonAvx512};
+        case IzhikevichKernels::CpuLevel::Avx2:
+            return {philoxAvx2, normalsAvx2, poissonAvx2};
+        default:
+            return {philoxScalar, normalsScalar, poissonScalar};
+    }
+}
+
+#else
+
+Kernels selectKernels() {
+    return {philoxScalar, normalsScalar, poissonScalar};
+}
+
+#endif // SNN_X86_KERNELS
+
+} // namespace
+
+template<typename Scalar>
+InputGenerator<Scalar>::InputGenerator(const std::vector<InputSource>& sources, uint64_t seed)
+    : sources(sources), seed(seed), key(seed ^ INPUT_KEY), poissonThresholds(sources.size()) {
+}
+
+template<typename Scalar>
+void InputGenerator<Scalar>::setStream(uint32_t stream) {
+    // an odd multiplier gives every stream its own key
+    key = (seed ^ INPUT_KEY) + stream * 0xD1B54A32D192ED03ull;
+}
+
+template<typename Scalar>
+void InputGenerator<Scalar>::prepare(double dt) {
+    if (dt == preparedDt) {
+        return;
+    }
+    for (size_t s = 0; s < sources.size(); s++) {
+        const InputSource& source = sources[s];
+        std::vector<uint32_t>& thresholds = poissonThresholds[s];
+        thresholds.clear();
+        if (source.type != InputSource::Type::Poisson) {
+            continue;
+        }
+        // P(k) = lambda^k e^-lambda / k!, threshold j at P(count <= j) * 2^32 until it reaches 2^32;
+        // one draw covers the spikes of interval steps
+        const double lambda = source.rate * source.sources * dt * source.interval / 1000.0;
+        if (lambda <= 0.0) {
+            continue;
+        }
+        double probability = std::exp(-lambda);
+        double cumulative = probability;
+        for (size_t j = 0;; j++) {
+            const double threshold = std::round(cumulative * 4294967296.0);
+            if (threshold >= 4294967296.0) {
+                break;
+            }
+            if (j == MAX_POISSON_TABLE) {
+                throw std::runtime_error("Srednia liczba spikow wejscia Poissona na krok (" + std::to_string(lambda) +
+                                         ") jest zbyt duza, uzyj wejscia 'noise'.");
+            }
+            thresholds.push_back(static_cast<uint32_t>(threshold));
+            probability *= lambda / static_cast<double>(j + 1);
+            cumulative += probability;
+        }
+    }
+    preparedDt = dt;
+}
+
+// Neuron i takes word (i / BLOCKS) % 4 of block (i / CHUNK) * BLOCKS + i % BLOCKS, so that the
+// words of the blocks of one chunk, word-major, are the values of its CHUNK consecutive neurons. Noise
+// takes the cosine of the Box-Muller pair of words 0 and 1 for word 0 and its sine for word 1,
+// and the pair of words 2 and 3 the same way. Sources with an interval above 1 draw only in the
+// steps that are multiples of it; noise then adds just its mean in the other steps.
+template<typename Scalar>
+void InputGenerator<Scalar>::addCurrents(long long step, int lo, int hi, Scalar* input) const {
+    static const Kernels kernels = selectKernels();
+    const uint32_t stepLow = static_cast<uint32_t>(step);
+    const uint32_t stepHigh = static_cast<uint32_t>(static_cast<uint64_t>(step) >> 32);
+    uint32_t blocks[BLOCKS] = {};
+    Words words;
+    float values[CHUNK]; // values[j * BLOCKS + k] of neuron chunk * CHUNK + j * BLOCKS + k
+    for (size_t s = 0; s < sources.size(); s++) {
+        const InputSource& source = sources[s];
+        const bool noise = source.type == InputSource::Type::Noise;
+        const std::vector<uint32_t>& thresholds = poissonThresholds[s];
+        if (!noise && thresholds.empty()) {
+            continue; // no spikes at this rate
+        }
+        const uint32_t sourceIndex = static_cast<uint32_t>(s);
+        const Scalar offset = static_cast<Scalar>(noise ? source.mean : 0.0);
+        if (step % source.interval != 0) {
+            if (noise && offset != Scalar(0)) {
+                for (const NeuronRange& range : source.ranges) {
+                    for (int i = std::max(lo, range.start); i < std::min(hi, range.start + range.count); i++) {
+                        input[i - lo] += offset;
+                    }
+                }
+            }
+            continue;
+        }
+        // the sum of interval independent draws has sqrt(interval) times their deviation
+        const Scalar scale = static_cast<Scalar>(noise ? source.stddev * std::sqrt(static_cast<double>(source.interval))
+                                                       : source.weight);
+        // adds value[k] to neuron first + k for the neurons [first, last)
+        const auto add = [&](const float* value, int first, int last) {
+            Scalar* target = input + (first - lo);
+            for (int k = 0; k < last - first; k++) {
+                target[k] += offset + scale * static_cast<Scalar>(value[k]);
+            }
+        };
+
+        for (const NeuronRange& range : source.ranges) {
+            const int begin = std::max(lo, range.start);
+            const int end = std::min(hi, range.start + range.count);
+            if (begin >= end) {
+                continue;
+            }
+            // whole chunks, clipped to [begin, end) when added
+            for (int chunk = begin / CHUNK; chunk * CHUNK < end; chunk++) {
+                for (int k = 0; k < BLOCKS; k++) {
+                    blocks[k] = static_cast<uint32_t>(chunk * BLOCKS + k);
+                }
+                kernels.philox(blocks, BLOCKS, stepLow, stepHigh, sourceIndex, key, words);
+                if (noise) {
+                    kernels.normals(words[0], words[1], BLOCKS, values, values + BLOCKS);
+                    kernels.normals(words[2], words[3], BLOCKS, values + 2 * BLOCKS, values + 3 * BLOCKS);
+                } else {
+                    for (int j = 0; j < 4; j++) {
+                        kernels.poisson(words[j], BLOCKS, thresholds.data(), thresholds.size(), values + j * BLOCKS);
+                    }
+                }
+                const int first = std::max(begin, chunk * CHUNK);
+                const int last = std::min(end, (chunk + 1) * CHUNK);
+                add(values + (first - chunk * CHUNK), first, last);
+            }
+        }
+    }
+}
+
+template class InputGenerator<float>;
+template class InputGenerator<double>;
@@ -0,0 +1,380 @@
+#include "IzhikevichKernels.hpp"
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define SNN_X86_KERNELS 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define SNN_TARGET(isa)
+#else
+#define SNN_TARGET(isa) __attribute__((target(isa)))
+#endif
+#endif
+
+namespace IzhikevichKernels {
+
+template<typename Scalar>
+int integrateScalar(Scalar* v, Scalar* u, const Scalar* input, int start, int count,
+                    const IzhikevichParams& params, Scalar dt, int* fired) {
+    const Scalar a = static_cast<Scalar>(params.a);
+    const Scalar b = static_cast<Scalar>(params.b);
+    const Scalar c = static_cast<Scalar>(params.c);
+    const Scalar d = static_cast<Scalar>(params.d);
+    const Scalar k004 = static_cast<Scalar>(0.04);
+
+    int firedCount = 0;
+    const int end = start + count;
+    for (int i = start; i < end; i++) {
+        // u' = a(bv - u)
+        // v' = 0.04v^2 + 5v + 140 - u + I
+        // it is crucial to update u before v to achieve numerical stability
+        u[i] += dt * (a * (b * v[i] - u[i]));
+        v[i] += dt * (k004 * v[i] * v[i] + Scalar(5) * v[i] + Scalar(143) - u[i] + input[i]);
+
+        // if v >= 30 mV
+        //  v = c, u = u + d
+        if (v[i] >= Scalar(30)) {
+            v[i] = c;
+            u[i] += d;
+            fired[firedCount++] = i;
+        }
+    }
+    return firedCount;
+}
+
+template<typename Scalar>
+int integrateBatch(Scalar* v, Scalar* u, const Scalar* input, Scalar* spikes, int start, int count, int batch,
+                   const Scalar* a, const Scalar* b, const Scalar* c, const Scalar* d, Scalar dt, int* fired) {
+    const Scalar k004 = static_cast<Scalar>(0.04);
+
+    int firedCount = 0;
+    const int end = start + count;
+    for (int i = start; i < end; i++) {
+        Scalar* vi = v + static_cast<size_t>(i) * batch;
+        Scalar* ui = u + static_cast<size_t>(i) * batch;
+        const Scalar* inputi = input + static_cast<size_t>(i) * batch;
+        Scalar* spikesi = spikes + static_cast<size_t>(i) * batch;
+        Scalar anyFired = 0;
+        // same operations as integrateScalar, written without branches so that the loop over
+        // the instances is vectorized
+        for (int k = 0; k < batch; k++) {
+            const Scalar uk = ui[k] + dt * (a[k] * (b[k] * vi[k] - ui[k]));
+            const Scalar vk = vi[k] + dt * (k004 * vi[k] * vi[k] + Scalar(5) * vi[k] + Scalar(143) - uk + inputi[k]);
+            const bool spiked = vk >= Scalar(30);
+            vi[k] = spiked ? c[k] : vk;
+            ui[k] = spiked ? uk + d[k] : uk;
+            spikesi[k] = spiked ? Scalar(1) : Scalar(0);
+            anyFired = anyFired + spikesi[k];
+        }
+        if (anyFired > Scalar(0)) {
+            fired[firedCount++] = i;
+        }
+    }
+    return firedCount;
+}
+
+#ifdef SNN_X86_KERNELS
+
+static inline int lowestBit(unsigned int bits) {
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanForward(&index, bits);
+    return static_cast<int>(index);
+#else
+    return __builtin_ctz(bits);
+#endif
+}
+
+// Thin wrappers over the intrinsics of one instruction set and scalar type,
+// so that a single kernel body per instruction set serves both float and double.
+struct Avx2Double {
+    using Vec = __m256d;
+    using Mask = __m256d;
+    static constexpr int WIDTH = 4;
+    SNN_TARGET("avx2") static Vec set1(double x) { return _mm256_set1_pd(x); }
+    SNN_TARGET("avx2") static Vec load(const double* p) { return _mm256_loadu_pd(p); }
+    SNN_TARGET("avx2") static void store(double* p, Vec x) { _mm256_storeu_pd(p, x); }
+    SNN_TARGET("avx2") static Vec add(Vec x, Vec y) { return _mm256_add_pd(x, y); }
+    SNN_TARGET("avx2") static Vec sub(Vec x, Vec y) { return _mm256_sub_pd(x, y); }
+    SNN_TARGET("avx2") static Vec mul(Vec x, Vec y) { return _mm256_mul_pd(x, y); }
+    SNN_TARGET("avx2") static Mask greaterEqual(Vec x, Vec y) { return _mm256_cmp_pd(x, y, _CMP_GE_OQ); }
+    SNN_TARGET("avx2") static Vec select(Mask m, Vec ifTrue, Vec ifFalse) { return _mm256_blendv_pd(ifFalse, ifTrue, m); }
+    SNN_TARGET("avx2") static unsigned int bits(Mask m) { return static_cast<unsigned int>(_mm256_movemask_pd(m)); }
+};
+
+struct Avx2Float {
+    using Vec = __m256;
+    using Mask = __m256;
+    static constexpr int WIDTH = 8;
+    SNN_TARGET("avx2") static Vec set1(float x) { return _mm256_set1_ps(x); }
+    SNN_TARGET("avx2") static Vec load(const float* p) { return _mm256_loadu_ps(p); }
+    SNN_TARGET("avx2") static void store(float* p, Vec x) { _mm256_storeu_ps(p, x); }
+    SNN_TARGET("avx2") static Vec add(Vec x, Vec y) { return _mm256_add_ps(x, y); }
+    SNN_TARGET("avx2") static Vec sub(Vec x, Vec y) { return _mm256_sub_ps(x, y); }
+    SNN_TARGET("avx2") static Vec mul(Vec x, Vec y) { return _mm256_mul_ps(x, y); }
+    SNN_TARGET("avx2") static Mask greaterEqual(Vec x, Vec y) { return _mm256_cmp_ps(x, y, _CMP_GE_OQ); }
+    SNN_TARGET("avx2") static Vec select(Mask m, Vec ifTrue, Vec ifFalse) { return _mm256_blendv_ps(ifFalse, ifTrue, m); }
+    SNN_TARGET("avx2") static unsigned int bits(Mask m) { return static_cast<unsigned int>(_mm256_movemask_ps(m)); }
+};
+
+struct Avx512Double {
+    using Vec = __m512d;
+    using Mask = __mmask8;
+    static constexpr int WIDTH = 8;
+    SNN_TARGET("avx512f") static Vec set1(double x) { return _mm512_set1_pd(x); }
+    SNN_TARGET("avx512f") static Vec load(const double* p) { return _mm512_loadu_pd(p); }
+    SNN_TARGET("avx512f") static void store(double* p, Vec x) { _mm512_storeu_pd(p, x); }
+    SNN_TARGET("avx512f") static Vec add(Vec x, Vec y) { return _mm512_add_pd(x, y); }
+    SNN_TARGET("avx512f") static Vec sub(Vec x, Vec y) { return _mm512_sub_pd(x, y); }
+    SNN_TARGET("avx512f") static Vec mul(Vec x, Vec y) { return _mm512_mul_pd(x, y); }
+    SNN_TARGET("avx512f") static Mask greaterEqual(Vec x, Vec y) { return _mm512_cmp_pd_mask(x, y, _CMP_GE_OQ); }
+    SNN_TARGET("avx512f") static Vec select(Mask m, Vec ifTrue, Vec ifFalse) { return _mm512_mask_blend_pd(m, ifFalse, ifTrue); }
+    SNN_TARGET("avx512f") static unsigned int bits(Mask m) { return static_cast<unsigned int>(m); }
+};
+
+struct Avx512Float {
+    using Vec = __m512;
+    using Mask = __mmask16;
+    static constexpr int WIDTH = 16;
+    SNN_TARGET("avx512f") static Vec set1(float x) { return _mm512_set1_ps(x); }
+    SNN_TARGET("avx512f") static Vec load(const float* p) { return _mm512_loadu_ps(p); }
+    SNN_TARGET("avx512f") static void store(float* p, Vec x) { _mm512_storeu_ps(p, x); }
+    SNN_TARGET("avx512f") static Vec add(Vec x, Vec y) { return _mm512_add_ps(x, y); }
+    SNN_TARGET("avx512f") static Vec sub(Vec x, Vec y) { return _mm512_sub_ps(x, y); }
+    SNN_TARGET("avx512f") static Vec mul(Vec x, Vec y) { return _mm512_mul_ps(x, y); }
+    SNN_TARGET("avx512f") static Mask greaterEqual(Vec x, Vec y) { return _mm512_cmp_ps_mask(x, y, _CMP_GE_OQ); }
+    SNN_TARGET("avx512f") static Vec select(Mask m, Vec ifTrue, Vec ifFalse) { return _mm512_mask_blend_ps(m, ifFalse, ifTrue); }
+    SNN_TARGET("avx512f") static unsigned int bits(Mask m) { return static_cast<unsigned int>(m); }
+};
+
+template<typename Scalar> struct Avx2Ops;
+template<> struct Avx2Ops<double> { using type = Avx2Double; };
+template<> struct Avx2Ops<float> { using type = Avx2Float; };
+template<typename Scalar> struct Avx512Ops;
+template<> struct Avx512Ops<double> { using type = Avx512Double; };
+template<> struct Avx512Ops<float> { using type = Avx512Float; };
+
+// The AVX2 and AVX-512 bodies are identical apart from the target attribute, which cannot
+// be a template parameter. The loop mirrors the operation order of integrateScalar.
+// The attribute has to be on the first declaration, hence the separate Impl functions.
+template<typename Scalar>
+SNN_TARGET("avx2")
+static int integrateAvx2Impl(Scalar* v, Scalar* u, const Scalar* input, int start, int count,
+                  const IzhikevichParams& params, Scalar dt, int* fired) {
+    using Ops = typename Avx2Ops<Scalar>::type;
+    const typename Ops::Vec a = Ops::set1(static_cast<Scalar>(params.a));
+    const typename Ops::Vec b = Ops::set1(static_cast<Scalar>(params.b));
+    const typename Ops::Vec c = Ops::set1(static_cast<Scalar>(params.c));
+    const typename Ops::Vec d = Ops::set1(static_cast<Scalar>(params.d));
+    const typename Ops::Vec step = Ops::set1(dt);
+    const typename Ops::Vec k004 = Ops::set1(static_cast<Scalar>(0.04));
+    const typename Ops::Vec k5 = Ops::set1(Scalar(5));
+    const typename Ops::Vec k143 = Ops::set1(Scalar(143));
+    const typename Ops::Vec threshold = Ops::set1(Scalar(30));
+
+    int firedCount = 0;
+    int i = start;
+    const int end = start + count;
+    for (; i + Ops::WIDTH <= end; i += Ops::WIDTH) {
+        typename Ops::Vec vi = Ops::load(v + i);
+        typename Ops::Vec ui = Ops::load(u + i);
+        const typename Ops::Vec in = Ops::load(input + i);
+
+        ui = Ops::add(ui, Ops::mul(step, Ops::mul(a, Ops::sub(Ops::mul(b, vi), ui))));
+        typename Ops::Vec dv = Ops::mul(Ops::mul(k004, vi), vi);
+        dv = Ops::add(dv, Ops::mul(k5, vi));
+        dv = Ops::add(dv, k143);
+        dv = Ops::sub(dv, ui);
+        dv = Ops::add(dv, in);
+        vi = Ops::add(vi, Ops::mul(step, dv));
+
+        // masked reset of the neurons that crossed the threshold
+        const typename Ops::Mask spiked = Ops::greaterEqual(vi, threshold);
+        vi = Ops::select(spiked, c, vi);
+        ui = Ops::select(spiked, Ops::add(ui, d), ui);
+        Ops::store(v + i, vi);
+        Ops::store(u + i, ui);
+
+        unsigned int bits = Ops::bits(spiked);
+        while (bits) {
+            fired[firedCount++] = i + lowestBit(bits);
+            bits &= bits - 1;
+        }
+    }
+    return firedCount + integrateScalar<Scalar>(v, u, input, i, end - i, params, dt, fired + firedCount);
+}
+
+template<typename Scalar>
+SNN_TARGET("avx512f")
+static int integrateAvx512Impl(Scalar* v, Scalar* u, const Scalar* input, int start, int count,
+                    const IzhikevichParams& params, Scalar dt, int* fired) {
+    using Ops = typename Avx512Ops<Scalar>::type;
+    const typename Ops::Vec a = Ops::set1(static_cast<Scalar>(params.a));
+    const typename Ops::Vec b = Ops::set1(static_cast<Scalar>(params.b));
+    const typename Ops::Vec c = Ops::set1(static_cast<Scalar>(params.c));
+    const typename Ops::Vec d = Ops::set1(static_cast<Scalar>(params.d));
+    const typename Ops::Vec step = Ops::set1(dt);
+    const typename Ops::Vec k004 = Ops::set1(static_cast<Scalar>(0.04));
+    const typename Ops::Vec k5 = Ops::set1(Scalar(5));
+    const typename Ops::Vec k143 = Ops::set1(Scalar(143));
+    const typename Ops::Vec threshold = Ops::set1(Scalar(30));
+
+    int firedCount = 0;
+    int i = start;
+    const int end = start + count;
+    for (; i + Ops::WIDTH <= end; i += Ops::WIDTH) {
+        typename Ops::Vec vi = Ops::load(v + i);
+        typename Ops::Vec ui = Ops::load(u + i);
+        const typename Ops::Vec in = Ops::load(input + i);
+
+        ui = Ops::add(ui, Ops::mul(step, Ops::mul(a, Ops::sub(Ops::mul(b, vi), ui))));
+        typename Ops::Vec dv = Ops::mul(Ops::mul(k004, vi), vi);
+        dv = Ops::add(dv, Ops::mul(k5, vi));
+        dv = Ops::add(dv, k143);
+        dv = Ops::sub(dv, ui);
+        dv = Ops::add(dv, in);
+        vi = Ops::add(vi, Ops::mul(step, dv));
+
+        // masked reset of the neurons that crossed the threshold
+        const typename Ops::Mask spiked = Ops::greaterEqual(vi, threshold);
+        vi = Ops::select(spiked, c, vi);
+        ui = Ops::select(spiked, Ops::add(ui, d), ui);
+        Ops::store(v + i, vi);
+        Ops::store(u + i, ui);
+
+        unsigned int bits = Ops::bits(spiked);
+        while (bits) {
+            fired[firedCount++] = i + lowestBit(bits);
+            bits &= bits - 1;
+        }
+    }
+    return firedCount + integrateScalar<Scalar>(v, u, input, i, end - i, params, dt, fired + firedCount);
+}
+
+template<typename Scalar>
+int integrateAvx2(Scalar* v, Scalar* u, const Scalar* input, int start, int count,
+                  const IzhikevichParams& params, Scalar dt, int* fired) {
+    return integrateAvx2Impl<Scalar>(v, u, input, start, count, params, dt, fired);
+}
+
+template<typename Scalar>
+int integrateAvx512(Scalar* v, Scalar* u, const Scalar* input, int start, int count,
+                    const IzhikevichParams& params, Scalar dt, int* fired) {
+    return integrateAvx512Impl<Scalar>(v, u, input, start, count, params, dt, fired);
+}
+
+static CpuLevel detectCpuLevel() {
+#if defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 0);
+    const int maxLeaf = info[0];
+    __cpuid(info, 1);
+    const bool osxsave = (info[2] & (1 << 27)) != 0;
+    const bool avx = (info[2] & (1 << 28)) != 0;
+    if (!osxsave || !avx || maxLeaf < 7) {
+        return CpuLevel::Scalar;
+    }
+    const unsigned long long xcr0 = _xgetbv(0);
+    __cpuidex(info, 7, 0);
+    const bool avx2 = (info[1] & (1 << 5)) != 0 && (xcr0 & 0x6) == 0x6;
+    const bool avx512 = (info[1] & (1 << 16)) != 0 && (xcr0 & 0xE6) == 0xE6;
+    if (avx512) return CpuLevel::Avx512;
+    if (avx2) return CpuLevel::Avx2;
+    return CpuLevel::Scalar;
+#else
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) return CpuLevel::Avx512;
+    if (__builtin_cpu_supports("avx2")) return CpuLevel::Avx2;
+    return CpuLevel::Scalar;
+#endif
+}
+
+// The environment variable SNN_CPU_LEVEL (scalar, avx2 or avx512) caps the detected level, so that
+// the kernels can be compared on one machine.
+static CpuLevel limitCpuLevel(CpuLevel detected) {
+    const char* limit = std::getenv("SNN_CPU_LEVEL");
+    if (limit == nullptr) {
+        return detected;
+    }
+    const std::string name(limit);
+    CpuLevel requested;
+    if (name == "scalar") {
+        requested = CpuLevel::Scalar;
+    } else if (name == "avx2") {
+        requested = CpuLevel::Avx2;
+    } else if (name == "avx512") {
+        requested = CpuLevel::Avx512;
+    } else {
+        std::cerr << "Ostrzezenie: nieznana wartosc SNN_CPU_LEVEL: " << name << " (dozwolone: scalar, avx2, avx512).\n";
+        return detected;
+    }
+    return requested < detected ? requested : detected;
+}
+
+CpuLevel cpuLevel() {
+    static const CpuLevel level = limitCpuLevel(detectCpuLevel());
+    return level;
+}
+
+template<typename Scalar>
+IntegrateFn<Scalar> selectIntegrateKernel() {
+    switch (cpuLevel()) {
+        case CpuLevel::Avx512:
+            return integrateAvx512<Scalar>;
+        case CpuLevel::Avx2:
+            return integrateAvx2<Scalar>;
+        default:
+            return integrateScalar<Scalar>;
+    }
+}
+
+#else // no x86 SIMD, the wide kernels fall back to the scalar one
+
+template<typename Scalar>
+int integrateAvx2(Scalar* v, Scalar* u, const Scalar* input, int start, int count,
+                  const IzhikevichParams& params, Scalar dt, int* fired) {
+    return integrateScalar<Scalar>(v, u, input, start, count, params, dt, fired);
+}
+
+template<typename Scalar>
+int integrateAvx512(Scalar* v, Scalar* u, const Scalar* input, int start, int count,
+                    const IzhikevichParams& params, Scalar dt, int* fired) {
+    return integrateScalar<Scalar>(v, u, input, start, count, params, dt, fired);
+}
+
+CpuLevel cpuLevel() {
+    return CpuLevel::Scalar;
+}
+
+template<typename Scalar>
+IntegrateFn<Scalar> selectIntegrateKernel() {
+    return integrateScalar<Scalar>;
+}
+
+#endif // SNN_X86_KERNELS
+
+template<typename Scalar>
+const char* kernelName(IntegrateFn<Scalar> kernel) {
+#ifdef SNN_X86_KERNELS
+    if (kernel == static_cast<IntegrateFn<Scalar>>(integrateAvx512<Scalar>)) return "avx512";
+    if (kernel == static_cast<IntegrateFn<Scalar>>(integrateAvx2<Scalar>)) return "avx2";
+#endif
+    return "scalar";
+}
+
+#define SNN_INSTANTIATE_KERNELS(Scalar) \
+    template int integrateScalar<Scalar>(Scalar*, Scalar*, const Scalar*, int, int, const IzhikevichParams&, Scalar, int*); \
+    template int integrateAvx2<Scalar>(Scalar*, Scalar*, const Scalar*, int, int, const IzhikevichParams&, Scalar, int*); \
+    template int integrateAvx512<Scalar>(Scalar*, Scalar*, const Scalar*, int, int, const IzhikevichParams&, Scalar, int*); \
+    template int integrateBatch<Scalar>(Scalar*, Scalar*, const Scalar*, Scalar*, int, int, int, \
+                                        const Scalar*, const Scalar*, const Scalar*, const Scalar*, Scalar, int*); \
+    template IntegrateFn<Scalar> selectIntegrateKernel<Scalar>(); \
+    template const char* kernelName<Scalar>(IntegrateFn<Scalar>);
+
+SNN_INSTANTIATE_KERNELS(float)
+SNN_INSTANTIATE_KERNELS(double)
+
+} // namespace IzhikevichKernels
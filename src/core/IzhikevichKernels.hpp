@@ -0,0 +1,49 @@
+#ifndef IZHIKEVICH_KERNELS_HPP
+#define IZHIKEVICH_KERNELS_HPP
+
+#include "SNN.hpp"
+
+// Integration kernels for a run of neurons [start, start + count) sharing the same IzhikevichParams.
+// Each kernel advances u and v by one Euler step, resets neurons that crossed the 30 mV threshold
+// and writes their indices to fired. Returns the number of neurons written to fired.
+// All variants perform the same floating point operations in the same order (no FMA contraction),
+// so for a given Scalar they produce bit-identical results.
+namespace IzhikevichKernels {
+
+template<typename Scalar>
+using IntegrateFn = int (*)(Scalar* v, Scalar* u, const Scalar* input, int start, int count,
+                            const IzhikevichParams& params, Scalar dt, int* fired);
+
+template<typename Scalar>
+int integrateScalar(Scalar* v, Scalar* u, const Scalar* input, int start, int count,
+                    const IzhikevichParams& params, Scalar dt, int* fired);
+template<typename Scalar>
+int integrateAvx2(Scalar* v, Scalar* u, const Scalar* input, int start, int count,
+                  const IzhikevichParams& params, Scalar dt, int* fired);
+template<typename Scalar>
+int integrateAvx512(Scalar* v, Scalar* u, const Scalar* input, int start, int count,
+                    const IzhikevichParams& params, Scalar dt, int* fired);
+
+// Batched kernel for BatchedSNN: state is laid out [neuron][batch] and a, b, c, d hold the
+// parameters of the run's type for every instance. Writes 1 or 0 per instance to spikes and the
+// neurons that fired in at least one instance to fired. Per instance it performs the same
+// operations as integrateScalar; the loop over instances has no branches and is auto-vectorized.
+template<typename Scalar>
+int integrateBatch(Scalar* v, Scalar* u, const Scalar* input, Scalar* spikes, int start, int count, int batch,
+                   const Scalar* a, const Scalar* b, const Scalar* c, const Scalar* d, Scalar dt, int* fired);
+
+// Widest SIMD instruction set of the CPU we are running on, detected once and capped by the
+// environment variable SNN_CPU_LEVEL (scalar, avx2 or avx512) if it is set. Also used by the other
+// kernels that are picked at run time (InputGenerator).
+enum class CpuLevel { Scalar, Avx2, Avx512 };
+CpuLevel cpuLevel();
+
+// Picks the widest kernel supported by the CPU we are running on.
+template<typename Scalar>
+IntegrateFn<Scalar> selectIntegrateKernel();
+template<typename Scalar>
+const char* kernelName(IntegrateFn<Scalar> kernel);
+
+} // namespace IzhikevichKernels
+
+#endif // IZHIKEVICH_KERNELS_HPP
@@ -0,0 +1,312 @@
+#include "NetworkCache.hpp"
+#include "BinaryIO.hpp"
+#include "FileReplace.hpp"
+#include "Hash.hpp"
+#include "MappedFile.hpp"
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+
+static const char CACHE_MAGIC[8] = {'S', 'N', 'N', 'C', 'A', 'C', 'H', 'E'};
+
+struct CacheHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t scalarSize;
+    uint64_t key;
+};
+
+static void writeGroup(BinaryWriter& writer, const GroupInfo& group) {
+    writer.writeString(group.name);
+    writer.writeString(group.fullName);
+    writer.write<int32_t>(group.startIndex);
+    writer.write<int32_t>(group.totalCount);
+    writer.writeString(group.externalInput);
+    writer.writeString(group.actionOutput);
+    writer.write<uint32_t>(static_cast<uint32_t>(group.neuronInfos.size()));
+    for (const NeuronInfo& nInfo : group.neuronInfos) {
+        writer.write<int32_t>(nInfo.typeId);
+        writer.write<int32_t>(nInfo.count);
+        writer.write<int32_t>(nInfo.startIndex);
+    }
+    writer.write<uint32_t>(static_cast<uint32_t>(group.subgroups.size()));
+    for (const GroupInfo& subgroup : group.subgroups) {
+        writeGroup(writer, subgroup);
+    }
+}
+
+static void readGroup(BinaryReader& reader, GroupInfo& group) {
+    group.name = reader.readString();
+    group.fullName = reader.readString();
+    group.startIndex = reader.read<int32_t>();
+    group.totalCount = reader.read<int32_t>();
+    group.externalInput = reader.readString();
+    group.actionOutput = reader.readString();
+    group.neuronInfos.resize(reader.read<uint32_t>());
+    for (NeuronInfo& nInfo : group.neuronInfos) {
+        nInfo.typeId = reader.read<int32_t>();
+        nInfo.count = reader.read<int32_t>();
+        nInfo.startIndex = reader.read<int32_t>();
+    }
+    group.subgroups.resize(reader.read<uint32_t>());
+    for (GroupInfo& subgroup : group.subgroups) {
+        readGroup(reader, subgroup);
+    }
+}
+
+static void writeProjection(BinaryWriter& writer, const ProceduralProjection& projection) {
+    writer.write<uint8_t>(projection.probabilistic ? 1 : 0);
+    writer.write<double>(projection.probability);
+    writer.write(projection.weights);
+    writer.write<uint64_t>(projection.seed);
+    writer.write<uint32_t>(projection.ruleIndex);
+    writer.write<uint32_t>(projection.pairIndex);
+    writer.write<uint16_t>(projection.delay);
+    writer.write<uint8_t>(projection.excludeSelf ? 1 : 0);
+    writer.writeVector(projection.targets);
+}
+
+static void readProjection(BinaryReader& reader, ProceduralProjection& projection) {
+    projection.probabilistic = reader.read<uint8_t>() != 0;
+    projection.probability = reader.read<double>();
+    reader.readBytes(&projection.weights, sizeof(projection.weights));
+    projection.seed = reader.read<uint64_t>();
+    projection.ruleIndex = reader.read<uint32_t>();
+    projection.pairIndex = reader.read<uint32_t>();
+    projection.delay = reader.read<uint16_t>();
+    projection.excludeSelf = reader.read<uint8_t>() != 0;
+    reader.readVector(projection.targets);
+}
+
+static void writeInput(BinaryWriter& writer, const InputSource& input) {
+    writer.write<uint8_t>(static_cast<uint8_t>(input.type));
+    writer.writeVector(input.ranges);
+    writer.write<double>(input.mean);
+    writer.write<double>(input.stddev);
+    writer.write<double>(input.rate);
+    writer.write<int32_t>(input.sources);
+    writer.write<double>(input.weight);
+    writer.write<int32_t>(input.interval);
+}
+
+static void readInput(BinaryReader& reader, InputSource& input) {
+    input.type = static_cast<InputSource::Type>(reader.read<uint8_t>());
+    reader.readVector(input.ranges);
+    input.mean = reader.read<double>();
+    input.stddev = reader.read<double>();
+    input.rate = reader.read<double>();
+    input.sources = reader.read<int32_t>();
+    input.weight = reader.read<double>();
+    input.interval = reader.read<int32_t>();
+}
+
+// Appends the FNV-1a checksum of the whole file, like the checkpoints do.
+static void appendChecksum(const std::string& path) {
+    uint64_t checksum;
+    {
+        MappedFile file(path);
+        checksum = fnv1a64(file.data(), file.size());
+    }
+    std::ofstream out(path, std::ios::binary | std::ios::app);
+    out.write(reinterpret_cast<const char*>(&checksum), sizeof(checksum));
+    out.flush();
+    if (!out) {
+        throw std::runtime_error("Blad zapisu pliku binarnego " + path);
+    }
+}
+
+bool NetworkCache::computeKey(const std::string& yamlPath, uint64_t& key) {
+    std::ifstream in(yamlPath, std::ios::binary);
+    if (!in) {
+        throw SNNParseException("Nie mozna znalezc lub otworzyc pliku " + yamlPath);
+    }
+    const std::string content((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    uint64_t seed;
+    try {
+        const YAML::Node config = YAML::Load(content);
+        const YAML::Node seedNode = config["simulation"] ? config["simulation"]["seed"] : YAML::Node();
+        if (!seedNode) {
+            return false;
+        }
+        seed = seedNode.as<uint64_t>();
+    }
+    catch (const YAML::Exception&) {
+        return false; // the loader reports the error
+    }
+    key = fnv1a64(&seed, sizeof(seed), fnv1a64(content.data(), content.size()));
+    return true;
+}
+
+template<typename Scalar>
+void NetworkCache::save(const std::string& cachePath, uint64_t key, const NetworkTopologyLoader::BasicConfigData<Scalar>& data) {
+    // write to a temporary file first so that a crash leaves either the old or the new cache, never
+    // none or a truncated one
+    const std::string tempPath = cachePath + ".tmp";
+    {
+        BinaryWriter writer(tempPath);
+        CacheHeader header;
+        std::copy(std::begin(CACHE_MAGIC), std::end(CACHE_MAGIC), header.magic);
+        header.version = FORMAT_VERSION;
+        header.scalarSize = sizeof(Scalar);
+        header.key = key;
+        writer.write(header);
+
+        writer.write<int32_t>(data.simulation.threads);
+        writer.write<uint64_t>(data.simulation.seed);
+        writer.write<uint8_t>(data.simulation.hasSeed ? 1 : 0);
+        writer.write<uint8_t>(static_cast<uint8_t>(data.simulation.weightBits));
+
+        writer.write<uint32_t>(static_cast<uint32_t>(data.neuronParamTypes.size()));
+        std::vector<std::string> typeNames(data.neuronParamTypes.size());
+        for (const auto& entry : data.neuronTypeToIdMap) {
+            typeNames[entry.second] = entry.first;
+        }
+        for (size_t typeId = 0; typeId < data.neuronParamTypes.size(); typeId++) {
+            writer.writeString(typeNames[typeId]);
+            writer.write(data.neuronParamTypes[typeId]);
+        }
+
+        writeGroup(writer, data.rootGroup);
+
+        writer.write<int32_t>(data.totalNeuronCount);
+        writer.writeVector(data.globalNeuronTypeIds);
+        writer.writeVector(data.initialV);
+        writer.writeVector(data.initialU);
+
+        writer.write<int32_t>(data.synapses.maxDelay);
+        writer.writeVector(data.synapses.offsets);
+        writer.writeVector(data.synapses.targets);
+        writer.writeVector(data.synapses.weights);
+        writer.writeVector(data.synapses.delays);
+        writer.writeVector(data.synapses.plasticity);
+        writer.writeVector(data.synapses.stdpRules);
+        writer.write<uint32_t>(static_cast<uint32_t>(data.synapses.procedural.size()));
+        for (const ProceduralProjection& projection : data.synapses.procedural) {
+            writeProjection(writer, projection);
+        }
+        writer.writeVector(data.synapses.proceduralOffsets);
+        writer.writeVector(data.synapses.proceduralIndex);
+        writer.write<uint32_t>(static_cast<uint32_t>(data.inputs.size()));
+        for (const InputSource& input : data.inputs) {
+            writeInput(writer, input);
+        }
+        writer.close();
+    }
+    appendChecksum(tempPath);
+    replaceFile(tempPath, cachePath);
+}
+
+template<typename Scalar>
+bool NetworkCache::load(const std::string& cachePath, uint64_t key, NetworkTopologyLoader::BasicConfigData<Scalar>& out) {
+    if (!MappedFile::exists(cachePath)) {
+        return false;
+    }
+    try {
+        MappedFile file(cachePath);
+        uint64_t stored;
+        if (file.size() < sizeof(CacheHeader) + sizeof(stored)) {
+            return false;
+        }
+        const size_t imageSize = file.size() - sizeof(stored);
+        std::memcpy(&stored, static_cast<const char*>(file.data()) + imageSize, sizeof(stored));
+        BinaryReader reader(file.data(), imageSize);
+
+        const CacheHeader header = reader.read<CacheHeader>();
+        if (!std::equal(std::begin(CACHE_MAGIC), std::end(CACHE_MAGIC), header.magic) ||
+            header.version != FORMAT_VERSION || header.scalarSize != sizeof(Scalar) || header.key != key) {
+            return false;
+        }
+        // checked after the header, a stale cache is rejected without reading all of it
+        if (fnv1a64(file.data(), imageSize) != stored) {
+            std::cerr << "Ostrzezenie: plik cache sieci " << cachePath << " jest uszkodzony (niezgodna suma kontrolna).\n";
+            return false;
+        }
+
+        NetworkTopologyLoader::BasicConfigData<Scalar> data;
+        data.simulation.threads = reader.read<int32_t>();
+        data.simulation.seed = reader.read<uint64_t>();
+        data.simulation.hasSeed = reader.read<uint8_t>() != 0;
+        data.simulation.weightBits = reader.read<uint8_t>();
+
+        data.neuronParamTypes.resize(reader.read<uint32_t>());
+        for (size_t typeId = 0; typeId < data.neuronParamTypes.size(); typeId++) {
+            const std::string typeName = reader.readString();
+            data.neuronParamTypes[typeId] = reader.read<IzhikevichParams>();
+            data.neuronTypeToIdMap[typeName] = static_cast<int>(typeId);
+        }
+
+        readGroup(reader, data.rootGroup);
+
+        data.totalNeuronCount = reader.read<int32_t>();
+        reader.readVector(data.globalNeuronTypeIds);
+        reader.readVector(data.initialV);
+        reader.readVector(data.initialU);
+
+        data.synapses.maxDelay = reader.read<int32_t>();
+        reader.readVector(data.synapses.offsets);
+        reader.readVector(data.synapses.targets);
+        reader.readVector(data.synapses.weights);
+        reader.readVector(data.synapses.delays);
+        reader.readVector(data.synapses.plasticity);
+        reader.readVector(data.synapses.stdpRules);
+        data.synapses.procedural.resize(reader.read<uint32_t>());
+        for (ProceduralProjection& projection : data.synapses.procedural) {
+            readProjection(reader, projection);
+        }
+        reader.readVector(data.synapses.proceduralOffsets);
+        reader.readVector(data.synapses.proceduralIndex);
+        data.inputs.resize(reader.read<uint32_t>());
+        for (InputSource& input : data.inputs) {
+            readInput(reader, input);
+        }
+
+        const size_t neuronCount = static_cast<size_t>(data.totalNeuronCount);
+        if (data.synapses.offsets.size() != neuronCount + 1 ||
+            data.synapses.offsets.back() != data.synapses.targets.size() ||
+            data.synapses.weights.size() != data.synapses.targets.size() ||
+            data.synapses.delays.size() != data.synapses.targets.size() ||
+            (!data.synapses.plasticity.empty() && data.synapses.plasticity.size() != data.synapses.targets.size()) ||
+            (!data.synapses.procedural.empty() && data.synapses.proceduralOffsets.size() != neuronCount + 1) ||
+            !data.simulation.hasSeed) {
+            return false;
+        }
+        out = std::move(data);
+        return true;
+    }
+    catch (const std::runtime_error&) {
+        return false;
+    }
+}
+
+template<typename Scalar>
+NetworkTopologyLoader::BasicConfigData<Scalar> NetworkCache::loadOrBuild(const std::string& yamlPath, const std::string& cachePath) {
+    uint64_t key;
+    if (!computeKey(yamlPath, key)) {
+        // without a fixed seed every load draws a different network, a cached one would freeze it
+        std::cerr << "Ostrzezenie: brak 'simulation.seed' w " << yamlPath << ", plik cache sieci nie jest uzywany.\n";
+        return NetworkTopologyLoader().loadFromYaml<Scalar>(yamlPath);
+    }
+
+    NetworkTopologyLoader::BasicConfigData<Scalar> data;
+    if (load(cachePath, key, data)) {
+        return data;
+    }
+
+    NetworkTopologyLoader loader;
+    data = loader.loadFromYaml<Scalar>(yamlPath);
+    try {
+        save(cachePath, key, data);
+    }
+    catch (const std::runtime_error& e) {
+        std::cerr << "Ostrzezenie: nie zapisano pliku cache sieci: " << e.what() << "\n";
+    }
+    return data;
+}
+
+template NetworkTopologyLoader::BasicConfigData<float> NetworkCache::loadOrBuild<float>(const std::string&, const std::string&);
+template NetworkTopologyLoader::BasicConfigData<double> NetworkCache::loadOrBuild<double>(const std::string&, const std::string&);
+template bool NetworkCache::load<float>(const std::string&, uint64_t, NetworkTopologyLoader::BasicConfigData<float>&);
+template bool NetworkCache::load<double>(const std::string&, uint64_t, NetworkTopologyLoader::BasicConfigData<double>&);
+template void NetworkCache::save<float>(const std::string&, uint64_t, const NetworkTopologyLoader::BasicConfigData<float>&);
+template void NetworkCache::save<double>(const std::string&, uint64_t, const NetworkTopologyLoader::BasicConfigData<double>&);
@@ -0,0 +1,36 @@
+#ifndef NETWORK_CACHE_HPP
+#define NETWORK_CACHE_HPP
+
+#include "NetworkTopologyLoader.hpp"
+#include <cstdint>
+#include <string>
+
+// Versioned binary image of a compiled network (neuron type table, group tree, initial v/u, the
+// CSR synapse arrays with their plasticity and the procedural projections). The cache is keyed by
+// a hash of the YAML file content and the seed, so any change to the configuration invalidates it.
+// Only configurations with a fixed 'simulation.seed' are cached. Arrays are 8-byte aligned and read
+// from a memory mapping with one bulk copy each, skipping synapse generation entirely. A trailing
+// FNV-1a checksum of the file rejects a corrupt cache.
+// The layout is the native one of the machine that wrote it and is not meant to be portable.
+class NetworkCache {
+public:
+    static constexpr uint32_t FORMAT_VERSION = 11;
+
+    // Loads the network from cachePath if it matches yamlPath, otherwise builds it from the YAML
+    // and (re)writes the cache. Failing to write the cache is reported but not fatal. Without a
+    // seed in the YAML the cache is neither read nor written.
+    template<typename Scalar>
+    static NetworkTopologyLoader::BasicConfigData<Scalar> loadOrBuild(const std::string& yamlPath, const std::string& cachePath);
+
+    // Returns false if the file is missing, stale (different key, version or scalar type) or corrupt.
+    template<typename Scalar>
+    static bool load(const std::string& cachePath, uint64_t key, NetworkTopologyLoader::BasicConfigData<Scalar>& out);
+
+    template<typename Scalar>
+    static void save(const std::string& cachePath, uint64_t key, const NetworkTopologyLoader::BasicConfigData<Scalar>& data);
+
+    // Key of the network built from yamlPath. Returns false if the configuration has no seed.
+    static bool computeKey(const std::string& yamlPath, uint64_t& key);
+};
+
+#endif // NETWORK_CACHE_HPP
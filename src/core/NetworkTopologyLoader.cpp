@@ -1,9 +1,16 @@
 #include "NetworkTopologyLoader.hpp"
 #include <iostream>
-#include "Random.hpp"
+#include "CounterRng.hpp"
+#include "ThreadPool.hpp"
+#include <atomic>
+#include <chrono>
+#include <random>
+#include <cmath>
 #include <algorithm>
 #include <vector>
 #include <utility>
+#include <tuple>
+#include <type_traits>
 
 template<typename T>
 T NetworkTopologyLoader::getNodeAs(const YAML::Node& parent, const std::string& key, const std::string& contextPath) const {
@@ -24,7 +31,7 @@ WeightGenerator NetworkTopologyLoader::createWeightGenerator(const YAML::Node& w
 
     if (weightNode["fixed"]) {
         double fixedValue = getNodeAs<double>(weightNode, "fixed", contextPath + ".weight");
-        return WeightGenerator::createFixed(Random::getInstance(), fixedValue);
+        return WeightGenerator::createFixed(fixedValue);
     }
 
     if (weightNode["uniform"]) {
@@ -37,7 +44,7 @@ WeightGenerator NetworkTopologyLoader::createWeightGenerator(const YAML::Node& w
         if (min > max) {
             throw SNNParseException("'min' musi byc mniejsze od 'max' w '" + contextPath, uniformNode);
         }
-        return WeightGenerator::createUniform(Random::getInstance(), min, max);
+        return WeightGenerator::createUniform(min, max);
     }
 
     if (weightNode["normal"]) {
@@ -48,12 +55,43 @@ WeightGenerator NetworkTopologyLoader::createWeightGenerator(const YAML::Node& w
         if (stdVal < 0.0) {
              throw SNNParseException("Blad parsowania: 'std' musi byc nieujemne w normal.", normalNode);
         }
-        return WeightGenerator::createNormal(Random::getInstance(), meanVal, stdVal);
+        return WeightGenerator::createNormal(meanVal, stdVal);
     }
 
     throw SNNParseException("Nieprawidlowy format dla 'weight' w '" + contextPath + "'. Oczekiwano jednego z kluczy: 'fixed', 'uniform', 'normal'.", weightNode);
 }
 
+StdpParams NetworkTopologyLoader::loadStdpParams(const YAML::Node& plasticityNode, const std::string& contextPath) const {
+    if (!plasticityNode.IsMap()) {
+        throw SNNParseException("Oczekiwano mapy dla 'plasticity' w '" + contextPath + "'.", plasticityNode);
+    }
+    const std::string context = contextPath + ".plasticity";
+    const std::string type = getNodeAs<std::string>(plasticityNode, "type", context);
+    if (type != "stdp") {
+        throw SNNParseException("Nieznany typ plastycznosci '" + type + "' w '" + context + "' (dozwolone: stdp).", plasticityNode["type"]);
+    }
+    StdpParams params;
+    if (plasticityNode["a_plus"]) params.aPlus = getNodeAs<double>(plasticityNode, "a_plus", context);
+    if (plasticityNode["a_minus"]) params.aMinus = getNodeAs<double>(plasticityNode, "a_minus", context);
+    if (plasticityNode["tau_plus"]) params.tauPlus = getNodeAs<double>(plasticityNode, "tau_plus", context);
+    if (plasticityNode["tau_minus"]) params.tauMinus = getNodeAs<double>(plasticityNode, "tau_minus", context);
+    if (plasticityNode["w_min"]) params.wMin = getNodeAs<double>(plasticityNode, "w_min", context);
+    params.wMax = getNodeAs<double>(plasticityNode, "w_max", context);
+    if (params.aPlus < 0.0 || params.aMinus < 0.0) {
+        throw SNNParseException("'a_plus' i 'a_minus' musza byc nieujemne w '" + context + "'.", plasticityNode);
+    }
+    if (params.tauPlus <= 0.0 || params.tauMinus <= 0.0) {
+        throw SNNParseException("'tau_plus' i 'tau_minus' musza byc dodatnie w '" + context + "'.", plasticityNode);
+    }
+    if (params.wMin > params.wMax) {
+        throw SNNParseException("'w_min' nie moze byc wieksze niz 'w_max' w '" + context + "'.", plasticityNode);
+    }
+    if (stdpRules.size() >= UINT16_MAX) {
+        throw SNNParseException("Zbyt wiele regul z plastycznoscia w '" + context + "'.", plasticityNode);
+    }
+    return params;
+}
+
 int NetworkTopologyLoader::getNeuronTypeId(const std::string& typeName) const {
     auto it = data.neuronTypeToIdMap.find(typeName);
     if (it != data.neuronTypeToIdMap.end()) {
@@ -63,11 +101,56 @@ int NetworkTopologyLoader::getNeuronTypeId(const std::string& typeName) const {
     }
 }
 
-NetworkTopologyLoader::ConfigData NetworkTopologyLoader::loadFromYaml(const std::string &filename) {
-    data = ConfigData(); // reset data
-    existingConnections.clear();
+template<typename Scalar>
+NetworkTopologyLoader::BasicConfigData<Scalar> NetworkTopologyLoader::loadFromYaml(const std::string &filename) {
+    singlePrecision = std::is_same<Scalar, float>::value;
+    parseYaml(filename);
+
+    BasicConfigData<Scalar> result;
+    result.neuronParamTypes = std::move(data.neuronParamTypes);
+    result.totalNeuronCount = data.totalNeuronCount;
+    result.globalNeuronTypeIds = std::move(data.globalNeuronTypeIds);
+    result.initialV.assign(data.initialV.begin(), data.initialV.end());
+    result.initialU.assign(data.initialU.begin(), data.initialU.end());
+    result.rootGroup = std::move(data.rootGroup);
+    result.neuronTypeToIdMap = std::move(data.neuronTypeToIdMap);
+    result.inputs = std::move(data.inputs);
+    result.simulation = data.simulation;
+    const auto matrixStart = std::chrono::steady_clock::now();
+    buildSynapseMatrix(result.synapses);
+    timings.matrixSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - matrixStart).count();
+    result.loadTimings = timings;
+    data = BasicConfigData<double>();
+    return result;
+}
+
+void NetworkTopologyLoader::parseYaml(const std::string &filename) {
+    data = BasicConfigData<double>(); // reset data
+    maxDelay = 1;
+    timings = LoadTimings();
+    const auto parseStart = std::chrono::steady_clock::now();
+    duplicatePolicy = DuplicatePolicy::Sum;
+    constructionMode = ConstructionMode::Rows;
+    rowCursors.clear();
+    singleWeights.clear();
+    synapticTargets.clear();
+    synapticWeights.clear();
+    synapticDelays.clear();
+    synapticPlasticity.clear();
+    stdpRules.clear();
+    proceduralSources.clear();
     try {
         YAML::Node config = YAML::LoadFile(filename);
+        // simulation options are optional
+        if (config["simulation"]) {
+            loadSimulationOptions(config["simulation"]);
+        }
+        if (!data.simulation.hasSeed) {
+            // no seed given, every load produces a different network
+            std::random_device rd;
+            data.simulation.seed = (static_cast<uint64_t>(rd()) << 32) | rd();
+        }
+        threadPool = std::make_unique<ThreadPool>(data.simulation.threads);
         if (!config["neuron_types"]) {
             throw SNNParseException("Brak sekcji 'neuron_types' w pliku YAML.", config);
         }
@@ -114,7 +197,15 @@ NetworkTopologyLoader::ConfigData NetworkTopologyLoader::loadFromYaml(const std:
             throw SNNParseException("Brak sekcji 'connections' w pliku YAML.", config);
         }
         const YAML::Node& connections = config["connections"];
+        const auto generationStart = std::chrono::steady_clock::now();
+        timings.parseSeconds = std::chrono::duration<double>(generationStart - parseStart).count();
         loadConnectionsData(connections);
+        timings.generationSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - generationStart).count();
+
+        // background inputs are optional
+        if (config["inputs"]) {
+            loadInputsData(config["inputs"]);
+        }
     }
     catch(const YAML::BadFile&) {
         throw SNNParseException("Nie mozna znalezc lub otworzyc pliku " + filename);
@@ -122,7 +213,65 @@ NetworkTopologyLoader::ConfigData NetworkTopologyLoader::loadFromYaml(const std:
     catch(const YAML::ParserException& e) {
         throw SNNParseException(std::string(e.what()));
     }
-    return data;
+}
+
+void NetworkTopologyLoader::loadSimulationOptions(const YAML::Node& simulationNode) {
+    if (!simulationNode.IsMap()) {
+        throw SNNParseException("Oczekiwano mapy dla sekcji 'simulation'.", simulationNode);
+    }
+    const std::string context = "simulation";
+    if (simulationNode["seed"]) {
+        data.simulation.seed = getNodeAs<uint64_t>(simulationNode, "seed", context);
+        data.simulation.hasSeed = true;
+    }
+    if (simulationNode["threads"]) {
+        data.simulation.threads = getNodeAs<int>(simulationNode, "threads", context);
+        if (data.simulation.threads < 0) {
+            throw SNNParseException("'threads' musi byc nieujemne w sekcji 'simulation'.", simulationNode["threads"]);
+        }
+    }
+    if (simulationNode["duplicates"]) {
+        const std::string policy = getNodeAs<std::string>(simulationNode, "duplicates", context);
+        if (policy == "error") {
+            duplicatePolicy = DuplicatePolicy::Error;
+        }
+        else if (policy == "keep_first") {
+            duplicatePolicy = DuplicatePolicy::KeepFirst;
+        }
+        else if (policy == "sum") {
+            duplicatePolicy = DuplicatePolicy::Sum;
+        }
+        else {
+            throw SNNParseException("Nieznana wartosc 'duplicates': " + policy + " (dozwolone: error, keep_first, sum).", simulationNode["duplicates"]);
+        }
+    }
+    if (simulationNode["construction"]) {
+        const std::string mode = getNodeAs<std::string>(simulationNode, "construction", context);
+        if (mode == "rows") {
+            constructionMode = ConstructionMode::Rows;
+        }
+        else if (mode == "two_pass") {
+            constructionMode = ConstructionMode::TwoPass;
+        }
+        else {
+            throw SNNParseException("Nieznana wartosc 'construction': " + mode + " (dozwolone: rows, two_pass).", simulationNode["construction"]);
+        }
+    }
+    if (simulationNode["weight_format"]) {
+        const std::string format = getNodeAs<std::string>(simulationNode, "weight_format", context);
+        if (format == "full") {
+            data.simulation.weightBits = 0;
+        }
+        else if (format == "int16") {
+            data.simulation.weightBits = 16;
+        }
+        else if (format == "int8") {
+            data.simulation.weightBits = 8;
+        }
+        else {
+            throw SNNParseException("Nieznana wartosc 'weight_format': " + format + " (dozwolone: full, int16, int8).", simulationNode["weight_format"]);
+        }
+    }
 }
 
 void NetworkTopologyLoader::loadGroupData(const YAML::Node& groupNode, GroupInfo& groupInfo, int& currentStartIndex) {
@@ -142,6 +291,13 @@ void NetworkTopologyLoader::loadGroupData(const YAML::Node& groupNode, GroupInfo
         subgroup.fullName = groupInfo.fullName + "." + subgroup.name;
         subgroup.startIndex = currentStartIndex;
         subgroup.totalCount = 0;
+        // optional bindings of the group to the environment, see MouseRunner
+        if (node["external_input"]) {
+            subgroup.externalInput = getNodeAs<std::string>(node, "external_input", subgroup.fullName);
+        }
+        if (node["action_output"]) {
+            subgroup.actionOutput = getNodeAs<std::string>(node, "action_output", subgroup.fullName);
+        }
 
         bool hasNeurons = node["neurons"].IsDefined();
         bool hasSubgroups = node["subgroups"].IsDefined();
@@ -197,15 +353,60 @@ void NetworkTopologyLoader::loadNeuronData(const YAML::Node& neuronsNode, GroupI
     }
 }
 
+void NetworkTopologyLoader::loadInputsData(const YAML::Node& inputsNode) {
+    if (!inputsNode.IsSequence()) {
+        throw SNNParseException("Oczekiwano sekwencji dla 'inputs'.", inputsNode);
+    }
+    for (const auto& inputNode : inputsNode) {
+        if (!inputNode.IsMap()) {
+            throw SNNParseException("Oczekiwano mapy dla wejscia w 'inputs'.", inputNode);
+        }
+        const std::string context = "inputs";
+        const std::string group = getNodeAs<std::string>(inputNode, "group", context);
+        const std::string type = getNodeAs<std::string>(inputNode, "type", context);
+        InputSource input;
+        input.ranges = resolveGroupPattern(data.rootGroup, group);
+        if (input.ranges.empty()) {
+            throw SNNParseException("Wzorzec '" + group + "' nie pasuje do zadnej grupy neuronow w 'inputs'.", inputNode["group"]);
+        }
+        if (type == "noise") {
+            input.type = InputSource::Type::Noise;
+            input.mean = inputNode["mean"] ? getNodeAs<double>(inputNode, "mean", context) : 0.0;
+            input.stddev = getNodeAs<double>(inputNode, "std", context);
+            if (input.stddev < 0.0) {
+                throw SNNParseException("'std' musi byc nieujemne w 'inputs' (grupa '" + group + "').", inputNode["std"]);
+            }
+        }
+        else if (type == "poisson") {
+            input.type = InputSource::Type::Poisson;
+            input.rate = getNodeAs<double>(inputNode, "rate", context);
+            input.sources = inputNode["sources"] ? getNodeAs<int>(inputNode, "sources", context) : 1;
+            input.weight = getNodeAs<double>(inputNode, "weight", context);
+            if (input.rate < 0.0) {
+                throw SNNParseException("'rate' musi byc nieujemne w 'inputs' (grupa '" + group + "').", inputNode["rate"]);
+            }
+            if (input.sources < 1) {
+                throw SNNParseException("'sources' musi byc dodatnie w 'inputs' (grupa '" + group + "').", inputNode["sources"]);
+            }
+        }
+        else {
+            throw SNNParseException("Nieznany typ wejscia '" + type + "' w 'inputs' (dozwolone: noise, poisson).", inputNode["type"]);
+        }
+        input.interval = inputNode["interval"] ? getNodeAs<int>(inputNode, "interval", context) : 1;
+        if (input.interval < 1) {
+            throw SNNParseException("'interval' musi byc dodatnie w 'inputs' (grupa '" + group + "').", inputNode["interval"]);
+        }
+        data.inputs.push_back(std::move(input));
+    }
+}
+
 void NetworkTopologyLoader::loadConnectionsData(const YAML::Node& connectionsNode) {
     if (!connectionsNode.IsSequence()) {
         throw SNNParseException("Oczekiwano sekwencji dla 'connections'.", connectionsNode);
     }
 
-    data.synapticTargets.resize(data.globalNeuronTypeIds.size());
-    data.synapticWeights.resize(data.globalNeuronTypeIds.size());
-    existingConnections.resize(data.globalNeuronTypeIds.size());
-
+    // all rules are parsed up front, the two-pass construction applies them twice
+    std::vector<ConnectionRule> rules;
     for (const auto& connectionNode : connectionsNode) {
         if (!connectionNode.IsMap()) {
             throw SNNParseException("Oczekiwano mapy dla polaczenia w 'connections'.", connectionNode);
@@ -217,37 +418,389 @@ void NetworkTopologyLoader::loadConnectionsData(const YAML::Node& connectionsNod
         std::string toType = getNodeAs<std::string>(connectionNode, "to_type", context);
         // exclude_self is optional, default to false
         bool excludeSelf = connectionNode["exclude_self"] ? getNodeAs<bool>(connectionNode, "exclude_self", context + " (default false)") : false;
+        // delay is optional, default to 1 step (spike arrives in the next step)
+        int delay = connectionNode["delay"] ? getNodeAs<int>(connectionNode, "delay", context) : 1;
+        if (delay < 1 || delay > MAX_SYNAPTIC_DELAY) {
+            throw SNNParseException("'delay' musi byc w zakresie [1, " + std::to_string(MAX_SYNAPTIC_DELAY) + "] w '" + context + "'.", connectionNode["delay"]);
+        }
+        maxDelay = std::max(maxDelay, delay);
         YAML::Node ruleNode = getNodeAs<YAML::Node>(connectionNode, "rule", context);
         YAML::Node weightNode = getNodeAs<YAML::Node>(connectionNode, "weight", context);
 
         WeightGenerator weightGen = createWeightGenerator(weightNode, context + " (from '" + fromGroup + "' to '" + toGroup + "')");
-        
-        // Make actual connection here (not implemented in this commit). For now, just print the connection details.
+
+        // plasticity is optional
+        uint16_t plasticity = 0;
+        if (connectionNode["plasticity"]) {
+            stdpRules.push_back(loadStdpParams(connectionNode["plasticity"], context + " (from '" + fromGroup + "' to '" + toGroup + "')"));
+            plasticity = static_cast<uint16_t>(stdpRules.size());
+            if (data.simulation.weightBits != 0) {
+                throw SNNParseException("Regula z 'plasticity' wymaga 'weight_format: full' w sekcji 'simulation'.", connectionNode["plasticity"]);
+            }
+        }
+        // procedural is optional, such a rule stores no synapses and regenerates them at every spike
+        const bool procedural = connectionNode["procedural"] ? getNodeAs<bool>(connectionNode, "procedural", context) : false;
+        if (procedural) {
+            const std::string ruleType = getNodeAs<std::string>(ruleNode, "type", "rule");
+            if (ruleType != "all_to_all" && ruleType != "probabilistic") {
+                throw SNNParseException("'procedural' jest dostepne tylko dla regul 'all_to_all' i 'probabilistic'.", connectionNode["procedural"]);
+            }
+            if (plasticity != 0) {
+                throw SNNParseException("Regula z 'procedural' nie moze miec 'plasticity'.", connectionNode["plasticity"]);
+            }
+        }
+        rules.push_back({fromGroup, toGroup, fromType, toType, excludeSelf, static_cast<uint16_t>(delay), ruleNode, weightGen,
+                         plasticity, procedural});
+    }
+
+    const size_t neuronCount = data.globalNeuronTypeIds.size();
+    if (constructionMode == ConstructionMode::TwoPass) {
+        // first pass: only count the synapses of every row
+        buildPass = BuildPass::Count;
+        rowCursors.assign(neuronCount, 0);
+        applyConnectionRules(rules);
+
+        // allocate the final arrays exactly once
+        BasicSynapseMatrix<double>& matrix = data.synapses;
+        matrix.offsets.resize(neuronCount + 1);
+        matrix.offsets[0] = 0;
+        for (size_t i = 0; i < neuronCount; i++) {
+            matrix.offsets[i + 1] = matrix.offsets[i] + rowCursors[i];
+            rowCursors[i] = matrix.offsets[i];
+        }
+        const size_t synapseCount = matrix.offsets[neuronCount];
+        matrix.targets.resize(synapseCount);
+        if (singlePrecision) {
+            singleWeights.resize(synapseCount);
+        } else {
+            matrix.weights.resize(synapseCount);
+        }
+        matrix.delays.resize(synapseCount);
+        if (!stdpRules.empty()) {
+            matrix.plasticity.resize(synapseCount);
+        }
+
+        // second pass: the streams repeat the same draws, the synapses go straight to their rows
+        buildPass = BuildPass::Fill;
+        applyConnectionRules(rules);
+        if (singlePrecision) {
+            sortAndMergeMatrix(singleWeights);
+        } else {
+            sortAndMergeMatrix(matrix.weights);
+        }
+        std::vector<size_t>().swap(rowCursors);
+    }
+    else {
+        buildPass = BuildPass::Rows;
+        synapticTargets.resize(neuronCount);
+        synapticWeights.resize(neuronCount);
+        synapticDelays.resize(neuronCount);
+        if (!stdpRules.empty()) {
+            synapticPlasticity.resize(neuronCount);
+        }
+        applyConnectionRules(rules);
+        sortAndMergeRows();
+    }
+}
+
+void NetworkTopologyLoader::applyConnectionRules(const std::vector<ConnectionRule>& rules) {
+    const bool firstPass = buildPass != BuildPass::Fill;
+    size_t synapsesBeforeRule = 0;
+    for (uint32_t ruleIndex = 0; ruleIndex < rules.size(); ruleIndex++) {
+        const ConnectionRule& rule = rules[ruleIndex];
+        rulePlasticity = rule.plasticity;
+
         std::vector<std::pair<const GroupInfo*, const GroupInfo*>> matchedPairs;
-        printf("From '%s', To '%s'\n", fromGroup.c_str(), toGroup.c_str());
-        findMatchingGroups(fromGroup, toGroup, data.rootGroup, excludeSelf, matchedPairs);
-        for (const auto& pair : matchedPairs) {
-            printf("  Matched Pair: %s -> %s\n", pair.first->fullName.c_str(), pair.second->fullName.c_str());
-            createConnectionsBetweenGroups(*pair.first, *pair.second, fromType, toType, ruleNode, weightGen, excludeSelf);
+        if (verbose && firstPass) {
+            printf("From '%s', To '%s'\n", rule.fromGroup.c_str(), rule.toGroup.c_str());
+        }
+        const auto ruleStart = std::chrono::steady_clock::now();
+        findMatchingGroups(rule.fromGroup, rule.toGroup, data.rootGroup, rule.excludeSelf, matchedPairs);
+        // the random streams (stored and procedural) tell rules and pairs apart by 16 bits each;
+        // larger indices would silently reuse the streams of earlier ones
+        if (ruleIndex > CounterRng::MAX_STREAM_INDEX) {
+            throw SNNParseException("Zbyt wiele regul w sekcji 'connections' (najwyzej " +
+                                    std::to_string(CounterRng::MAX_STREAM_INDEX + 1) + ").", rule.ruleNode);
+        }
+        if (matchedPairs.size() > CounterRng::MAX_STREAM_INDEX + size_t(1)) {
+            throw SNNParseException("Regula '" + rule.fromGroup + "' -> '" + rule.toGroup + "' pasuje do " +
+                                    std::to_string(matchedPairs.size()) + " par grup (najwyzej " +
+                                    std::to_string(CounterRng::MAX_STREAM_INDEX + 1) + ").", rule.ruleNode);
         }
-        printf("\n");
+        for (uint32_t pairIndex = 0; pairIndex < matchedPairs.size(); pairIndex++) {
+            const auto& pair = matchedPairs[pairIndex];
+            if (verbose && firstPass) {
+                printf("  Matched Pair: %s -> %s\n", pair.first->fullName.c_str(), pair.second->fullName.c_str());
+            }
+            if (rule.procedural) {
+                if (firstPass) {
+                    addProceduralProjection(*pair.first, *pair.second, rule, ruleIndex, pairIndex);
+                }
+                continue;
+            }
+            createConnectionsBetweenGroups(*pair.first, *pair.second, rule.fromType, rule.toType, rule.ruleNode, rule.weightGen,
+                                           rule.delay, rule.excludeSelf, ruleIndex, pairIndex);
+        }
+        if (verbose && firstPass) {
+            printf("\n");
+        }
+        if (buildPass == BuildPass::Rows && !synapticPlasticity.empty()) {
+            // rules only append to the rows, so the new synapses are the tail of each row
+            forEachBlock(synapticTargets.size(), [&](size_t begin, size_t end) {
+                for (size_t i = begin; i < end; i++) {
+                    synapticPlasticity[i].resize(synapticTargets[i].size(), rule.plasticity);
+                }
+            });
+        }
+
+        const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - ruleStart).count();
+        if (!firstPass) {
+            timings.rules[ruleIndex].seconds += seconds;
+            continue;
+        }
+        NetworkLoadTimings::Rule ruleTiming;
+        ruleTiming.index = static_cast<int>(ruleIndex);
+        ruleTiming.from = rule.fromGroup;
+        ruleTiming.to = rule.toGroup;
+        ruleTiming.type = rule.ruleNode["type"] && rule.ruleNode["type"].IsScalar() ? rule.ruleNode["type"].as<std::string>() : "";
+        ruleTiming.seconds = seconds;
+        size_t totalSynapses = 0;
+        if (buildPass == BuildPass::Count) {
+            for (size_t count : rowCursors) {
+                totalSynapses += count;
+            }
+        } else {
+            for (const auto& row : synapticTargets) {
+                totalSynapses += row.size();
+            }
+        }
+        ruleTiming.synapses = totalSynapses - synapsesBeforeRule;
+        synapsesBeforeRule = totalSynapses;
+        timings.rules.push_back(std::move(ruleTiming));
     }
+}
 
-    // After loading configuration, simplify the structure of existingConnections
-    for (int i = 0; i < data.synapticTargets.size(); i++) {
-        // Sort synapticTargets and corresponding synapticWeights
-        std::vector<std::pair<int, double>> pairs;
-        pairs.reserve(data.synapticTargets[i].size());
-        for (int j = 0; j < data.synapticTargets[i].size(); ++j) {
-            pairs.emplace_back(data.synapticTargets[i][j], data.synapticWeights[i][j]);
+// Sorts the row in place by (target, delay) and merges synapses that repeat a (target, delay) pair
+// according to duplicatePolicy. The sort is stable, so "first" means first in rule order.
+// A merged synapse keeps the plasticity of the first of its synapses.
+template<typename Weight>
+size_t NetworkTopologyLoader::sortAndMergeRow(int* targets, Weight* weights, uint16_t* delays, uint16_t* plasticity,
+                                              size_t count, std::vector<RowSynapse>& scratch, bool& duplicate) const {
+    scratch.clear();
+    for (size_t j = 0; j < count; ++j) {
+        scratch.push_back({targets[j], delays[j], weights[j], plasticity ? plasticity[j] : uint16_t(0)});
+    }
+    std::stable_sort(scratch.begin(), scratch.end(), [](const RowSynapse& a, const RowSynapse& b) {
+        return a.target != b.target ? a.target < b.target : a.delay < b.delay;
+    });
+    size_t kept = 0;
+    for (size_t j = 0; j < scratch.size(); ++j) {
+        if (kept > 0 && scratch[kept - 1].target == scratch[j].target && scratch[kept - 1].delay == scratch[j].delay) {
+            if (duplicatePolicy == DuplicatePolicy::Sum) {
+                scratch[kept - 1].weight += scratch[j].weight;
+                continue;
+            }
+            if (duplicatePolicy == DuplicatePolicy::KeepFirst) {
+                continue;
+            }
+            duplicate = true;
         }
-        std::sort(pairs.begin(), pairs.end());
-        for (int j = 0; j < pairs.size(); ++j) {
-            data.synapticTargets[i][j] = pairs[j].first;
-            data.synapticWeights[i][j] = pairs[j].second;
+        scratch[kept++] = scratch[j];
+    }
+    for (size_t j = 0; j < kept; ++j) {
+        targets[j] = scratch[j].target;
+        weights[j] = static_cast<Weight>(scratch[j].weight);
+        delays[j] = scratch[j].delay;
+        if (plasticity) {
+            plasticity[j] = scratch[j].plasticity;
+        }
+    }
+    return kept;
+}
+
+// Names the first duplicate of a sorted row in the error for DuplicatePolicy::Error.
+static void throwDuplicateError(size_t row, const int* targets, const uint16_t* delays, size_t count) {
+    size_t j = 1;
+    while (j < count && (targets[j] != targets[j - 1] || delays[j] != delays[j - 1])) {
+        j++;
+    }
+    throw SNNParseException("Zduplikowana synapsa " + std::to_string(row) + " -> " + std::to_string(targets[j]) +
+                            " (opoznienie " + std::to_string(delays[j]) + "). Ustaw 'duplicates' w sekcji 'simulation' na 'keep_first' lub 'sum'.");
+}
+
+// Records row as duplicated if it is lower than the one found so far, so the reported row does not
+// depend on the thread count.
+static void noteDuplicateRow(std::atomic<size_t>& firstDuplicateRow, size_t row) {
+    size_t current = firstDuplicateRow.load();
+    while (row < current && !firstDuplicateRow.compare_exchange_weak(current, row)) {}
+}
+
+void NetworkTopologyLoader::sortAndMergeRows() {
+    const bool plastic = !synapticPlasticity.empty();
+    std::atomic<size_t> firstDuplicateRow{synapticTargets.size()};
+    forEachBlock(synapticTargets.size(), [&](size_t begin, size_t end) {
+        std::vector<RowSynapse> scratch;
+        for (size_t i = begin; i < end; i++) {
+            bool duplicate = false;
+            const size_t kept = sortAndMergeRow(synapticTargets[i].data(), synapticWeights[i].data(), synapticDelays[i].data(),
+                                                plastic ? synapticPlasticity[i].data() : nullptr, synapticTargets[i].size(),
+                                                scratch, duplicate);
+            if (duplicate) {
+                noteDuplicateRow(firstDuplicateRow, i);
+            }
+            synapticTargets[i].resize(kept);
+            synapticWeights[i].resize(kept);
+            synapticDelays[i].resize(kept);
+            synapticTargets[i].shrink_to_fit();
+            synapticWeights[i].shrink_to_fit();
+            synapticDelays[i].shrink_to_fit();
+            if (plastic) {
+                synapticPlasticity[i].resize(kept);
+                synapticPlasticity[i].shrink_to_fit();
+            }
+        }
+    });
+
+    const size_t row = firstDuplicateRow.load();
+    if (row < synapticTargets.size()) {
+        throwDuplicateError(row, synapticTargets[row].data(), synapticDelays[row].data(), synapticTargets[row].size());
+    }
+}
+
+// sortAndMergeRows for the two-pass construction, in place on data.synapses with the given weights.
+// Rows that lost merged duplicates are then moved together; the arrays are shortened without reallocating.
+template<typename Weight>
+void NetworkTopologyLoader::sortAndMergeMatrix(std::vector<Weight>& weights) {
+    BasicSynapseMatrix<double>& matrix = data.synapses;
+    const size_t neuronCount = matrix.offsets.size() - 1;
+    uint16_t* plasticity = matrix.plasticity.empty() ? nullptr : matrix.plasticity.data();
+    std::vector<size_t>& keptCounts = rowCursors; // the cursors are no longer needed
+    std::atomic<size_t> firstDuplicateRow{neuronCount};
+    forEachBlock(neuronCount, [&](size_t begin, size_t end) {
+        std::vector<RowSynapse> scratch;
+        for (size_t i = begin; i < end; i++) {
+            const size_t first = matrix.offsets[i];
+            bool duplicate = false;
+            keptCounts[i] = sortAndMergeRow(matrix.targets.data() + first, weights.data() + first, matrix.delays.data() + first,
+                                            plasticity ? plasticity + first : nullptr, matrix.offsets[i + 1] - first, scratch, duplicate);
+            if (duplicate) {
+                noteDuplicateRow(firstDuplicateRow, i);
+            }
+        }
+    });
+
+    const size_t row = firstDuplicateRow.load();
+    if (row < neuronCount) {
+        const size_t first = matrix.offsets[row];
+        throwDuplicateError(row, matrix.targets.data() + first, matrix.delays.data() + first, matrix.offsets[row + 1] - first);
+    }
+
+    size_t position = 0;
+    for (size_t i = 0; i < neuronCount; i++) {
+        const size_t first = matrix.offsets[i];
+        const size_t kept = keptCounts[i];
+        matrix.offsets[i] = position;
+        if (position != first) {
+            // moving left, the source is never overwritten before it is read
+            std::copy(matrix.targets.begin() + first, matrix.targets.begin() + first + kept, matrix.targets.begin() + position);
+            std::copy(weights.begin() + first, weights.begin() + first + kept, weights.begin() + position);
+            std::copy(matrix.delays.begin() + first, matrix.delays.begin() + first + kept, matrix.delays.begin() + position);
+            if (plasticity) {
+                std::copy(plasticity + first, plasticity + first + kept, plasticity + position);
+            }
+        }
+        position += kept;
+    }
+    matrix.offsets[neuronCount] = position;
+    matrix.targets.resize(position);
+    weights.resize(position);
+    matrix.delays.resize(position);
+    if (plasticity) {
+        matrix.plasticity.resize(position);
+    }
+}
+
+// Hands over the two-pass weights, which were already written in the precision of Scalar.
+static void takeWeights(std::vector<double>& doubleWeights, std::vector<float>&, std::vector<double>& weights) {
+    weights = std::move(doubleWeights);
+}
+
+static void takeWeights(std::vector<double>&, std::vector<float>& singleWeights, std::vector<float>& weights) {
+    weights = std::move(singleWeights);
+}
+
+template<typename Scalar>
+void NetworkTopologyLoader::buildSynapseMatrix(BasicSynapseMatrix<Scalar>& matrix) {
+    matrix.maxDelay = maxDelay;
+    matrix.stdpRules = stdpRules;
+    matrix.procedural = std::move(data.synapses.procedural);
+    buildProceduralIndex(matrix.proceduralOffsets, matrix.proceduralIndex);
+    if (constructionMode == ConstructionMode::TwoPass) {
+        // already in the final layout
+        BasicSynapseMatrix<double>& built = data.synapses;
+        matrix.offsets = std::move(built.offsets);
+        matrix.targets = std::move(built.targets);
+        matrix.delays = std::move(built.delays);
+        matrix.plasticity = std::move(built.plasticity);
+        takeWeights(built.weights, singleWeights, matrix.weights);
+        return;
+    }
+
+    const size_t neuronCount = synapticTargets.size();
+    matrix.offsets.assign(neuronCount + 1, 0);
+    for (size_t i = 0; i < neuronCount; i++) {
+        matrix.offsets[i + 1] = matrix.offsets[i] + synapticTargets[i].size();
+    }
+    matrix.targets.resize(matrix.offsets[neuronCount]);
+    matrix.weights.resize(matrix.offsets[neuronCount]);
+    matrix.delays.resize(matrix.offsets[neuronCount]);
+    const bool plastic = !synapticPlasticity.empty();
+    if (plastic) {
+        matrix.plasticity.resize(matrix.offsets[neuronCount]);
+    }
+
+    // copy rows into the flat arrays, releasing each row right away to keep peak memory low
+    for (size_t i = 0; i < neuronCount; i++) {
+        std::copy(synapticTargets[i].begin(), synapticTargets[i].end(), matrix.targets.begin() + matrix.offsets[i]);
+        std::copy(synapticWeights[i].begin(), synapticWeights[i].end(), matrix.weights.begin() + matrix.offsets[i]);
+        std::copy(synapticDelays[i].begin(), synapticDelays[i].end(), matrix.delays.begin() + matrix.offsets[i]);
+        std::vector<int>().swap(synapticTargets[i]);
+        std::vector<double>().swap(synapticWeights[i]);
+        std::vector<uint16_t>().swap(synapticDelays[i]);
+        if (plastic) {
+            std::copy(synapticPlasticity[i].begin(), synapticPlasticity[i].end(), matrix.plasticity.begin() + matrix.offsets[i]);
+            std::vector<uint16_t>().swap(synapticPlasticity[i]);
+        }
+    }
+    synapticTargets.clear();
+    synapticWeights.clear();
+    synapticDelays.clear();
+    synapticPlasticity.clear();
+}
+
+// Where a synapse created by a rule goes depends on the pass, see BuildPass.
+void NetworkTopologyLoader::addSynapse(int source, int target, double weight, uint16_t delay) {
+    if (buildPass == BuildPass::Rows) {
+        synapticTargets[source].push_back(target);
+        // rounded like the two-pass weights, so that merged duplicates sum to the same value
+        synapticWeights[source].push_back(singlePrecision ? static_cast<float>(weight) : weight);
+        synapticDelays[source].push_back(delay);
+    }
+    else if (buildPass == BuildPass::Count) {
+        rowCursors[source]++;
+    }
+    else {
+        const size_t s = rowCursors[source]++;
+        data.synapses.targets[s] = target;
+        if (singlePrecision) {
+            singleWeights[s] = static_cast<float>(weight);
+        } else {
+            data.synapses.weights[s] = weight;
+        }
+        data.synapses.delays[s] = delay;
+        if (!data.synapses.plasticity.empty()) {
+            data.synapses.plasticity[s] = rulePlasticity;
         }
-        data.synapticTargets[i].shrink_to_fit();
-        data.synapticWeights[i].shrink_to_fit();
     }
 }
 
@@ -270,137 +823,227 @@ void NetworkTopologyLoader::getMatchingNeuronCount(const GroupInfo& group, const
     return;
 }
 
+// Floyd's algorithm: 'count' distinct values from [0, n) in O(count) expected time and memory,
+// without materializing the n candidates. Buffers are reused between calls.
+const std::vector<int>& NetworkTopologyLoader::DistinctSampler::sample(int n, int count, CounterRng& rng) {
+    selected.clear();
+    seen.clear();
+    for (int j = n - count; j < n; j++) {
+        const int candidate = rng.nextInt(j + 1);
+        const int chosen = seen.insert(candidate).second ? candidate : j;
+        if (chosen == j) {
+            seen.insert(j);
+        }
+        selected.push_back(chosen);
+    }
+    return selected;
+}
+
+// position of neuronIdx in a sorted list of neuron indices, -1 if absent
+int NetworkTopologyLoader::ordinalOf(const std::vector<int>& sortedNeurons, int neuronIdx) {
+    auto it = std::lower_bound(sortedNeurons.begin(), sortedNeurons.end(), neuronIdx);
+    return (it != sortedNeurons.end() && *it == neuronIdx) ? static_cast<int>(it - sortedNeurons.begin()) : -1;
+}
+
+void NetworkTopologyLoader::forEachBlock(size_t count, const std::function<void(size_t, size_t)>& body) {
+    const size_t blockCount = (count + GENERATION_BLOCK_SIZE - 1) / GENERATION_BLOCK_SIZE;
+    if (blockCount <= 1 || threadPool->size() == 1) {
+        body(0, count);
+        return;
+    }
+    // blocks are handed out dynamically, which block runs on which thread does not affect the result
+    std::atomic<size_t> nextBlock{0};
+    threadPool->run([&](int) {
+        for (size_t block = nextBlock++; block < blockCount; block = nextBlock++) {
+            const size_t begin = block * GENERATION_BLOCK_SIZE;
+            body(begin, std::min(count, begin + GENERATION_BLOCK_SIZE));
+        }
+    });
+}
+
+std::vector<int> NetworkTopologyLoader::matchingNeuronIndices(const GroupInfo& group, const std::string& typeName) const {
+    const int typeId = (typeName == "all") ? -1 : getNeuronTypeId(typeName);
+    std::vector<NeuronInfo> neurons;
+    getMatchingNeuronCount(group, typeId, neurons);
+    std::vector<int> indices;
+    for (const auto& n : neurons) {
+        for (int i = 0; i < n.count; i++) indices.push_back(n.startIndex + i);
+    }
+    return indices;
+}
+
+void NetworkTopologyLoader::addProceduralProjection(const GroupInfo& fromGroup, const GroupInfo& toGroup,
+                                                    const ConnectionRule& rule, uint32_t ruleIndex, uint32_t pairIndex) {
+    ProceduralProjection projection;
+    projection.probabilistic = getNodeAs<std::string>(rule.ruleNode, "type", "rule") == "probabilistic";
+    if (projection.probabilistic) {
+        projection.probability = getNodeAs<double>(rule.ruleNode, "probability", "rule");
+        if (projection.probability < 0.0 || projection.probability > 1.0) {
+            throw SNNParseException("'probability' musi byc w zakresie [0.0, 1.0] w regule 'probabilistic'.", rule.ruleNode);
+        }
+    }
+    projection.weights = rule.weightGen;
+    projection.seed = data.simulation.seed;
+    projection.ruleIndex = ruleIndex;
+    projection.pairIndex = pairIndex;
+    projection.delay = rule.delay;
+    projection.excludeSelf = rule.excludeSelf;
+    projection.targets = matchingNeuronIndices(toGroup, rule.toType);
+    std::vector<int> sources = matchingNeuronIndices(fromGroup, rule.fromType);
+    if (sources.empty() || projection.targets.empty()) {
+        return;
+    }
+    data.synapses.procedural.push_back(std::move(projection));
+    proceduralSources.push_back(std::move(sources));
+}
+
+// Counting sort of the projections by source neuron, in rule order for each neuron.
+void NetworkTopologyLoader::buildProceduralIndex(std::vector<size_t>& offsets, std::vector<uint32_t>& index) {
+    if (proceduralSources.empty()) {
+        return;
+    }
+    const size_t neuronCount = static_cast<size_t>(data.totalNeuronCount);
+    offsets.assign(neuronCount + 1, 0);
+    for (const std::vector<int>& sources : proceduralSources) {
+        for (int source : sources) {
+            offsets[source + 1]++;
+        }
+    }
+    for (size_t i = 0; i < neuronCount; i++) {
+        offsets[i + 1] += offsets[i];
+    }
+    index.resize(offsets[neuronCount]);
+    std::vector<size_t> next(offsets.begin(), offsets.end() - 1);
+    for (size_t projection = 0; projection < proceduralSources.size(); projection++) {
+        for (int source : proceduralSources[projection]) {
+            index[next[source]++] = static_cast<uint32_t>(projection);
+        }
+    }
+    proceduralSources.clear();
+}
+
 void NetworkTopologyLoader::createConnectionsBetweenGroups(
     const GroupInfo& fromGroup, const GroupInfo& toGroup,
     const std::string& fromType, const std::string& toType,
-    const YAML::Node& ruleNode, WeightGenerator& weightGen, bool excludeSelf) {
-
-    int fromTypeId = (fromType == "all") ? -1 : getNeuronTypeId(fromType);
-    int toTypeId = (toType == "all") ? -1 : getNeuronTypeId(toType);
-    std::vector<NeuronInfo> fromNeurons;
-    std::vector<NeuronInfo> toNeurons;
-    getMatchingNeuronCount(fromGroup, fromTypeId, fromNeurons);
-    getMatchingNeuronCount(toGroup, toTypeId, toNeurons);
-    
-    int fromCount = 0;
-    int toCount = 0;
-    for (const auto& n : fromNeurons) fromCount += n.count;
-    for (const auto& n : toNeurons) toCount += n.count;
+    const YAML::Node& ruleNode, const WeightGenerator& weightGen, uint16_t delay, bool excludeSelf,
+    uint32_t ruleIndex, uint32_t pairIndex) {
+
+    const std::vector<int> sources = matchingNeuronIndices(fromGroup, fromType);
+    const std::vector<int> targets = matchingNeuronIndices(toGroup, toType);
+    const int fromCount = static_cast<int>(sources.size());
+    const int toCount = static_cast<int>(targets.size());
+
+    // Every source neuron (every target neuron for fixed_in_degree) draws from its own stream,
+    // so the generated network depends only on the seed, never on the number of threads.
+    const uint64_t seed = data.simulation.seed;
+    auto connect = [&](int sourceIdx, int targetIdx, CounterRng& rng) {
+        addSynapse(sourceIdx, targetIdx, weightGen.generate(rng), delay);
+    };
 
     std::string ruleType = getNodeAs<std::string>(ruleNode, "type", "rule");
     if (ruleType == "one_to_one") {
         if (fromCount != toCount) {
             throw SNNParseException("Liczba neuronow w 'from' i 'to' musi byc rowna dla reguly 'one_to_one'.", ruleNode);
         }
-        int fromIndex = 0;
-        for (const auto& fromN : fromNeurons) {
-            for (int i = 0; i < fromN.count; i++) {
-                int toIndex = 0;
-                for (const auto& toN : toNeurons) {
-                    for (int j = 0; j < toN.count; j++) {
-                        if (existingConnections[fromN.startIndex + i].count(toN.startIndex + j) > 0) {
-                            continue;
-                        }
-                        if (excludeSelf && fromN.startIndex + i == toN.startIndex + j) {
-                            continue;
-                        }
-                        if (fromIndex == toIndex) {
-                            double weight = weightGen.generate();
-                            data.synapticTargets[fromN.startIndex + i].push_back(toN.startIndex + j);
-                            data.synapticWeights[fromN.startIndex + i].push_back(weight);
-                        }
-                        toIndex++;
-                    }
+        forEachBlock(sources.size(), [&](size_t begin, size_t end) {
+            for (size_t k = begin; k < end; k++) {
+                const int sourceIdx = sources[k];
+                const int targetIdx = targets[k];
+                if (excludeSelf && sourceIdx == targetIdx) {
+                    continue;
                 }
-                fromIndex++;
+                CounterRng rng(seed, CounterRng::streamId(ruleIndex, pairIndex, sourceIdx));
+                connect(sourceIdx, targetIdx, rng);
             }
-        }
+        });
     }
     else if (ruleType == "all_to_all") {
-        for (const auto& fromN : fromNeurons) {
-            for (int i = 0; i < fromN.count; i++) {
-                for (const auto& toN : toNeurons) {
-                    for (int j = 0; j < toN.count; j++) {
-                        if (existingConnections[fromN.startIndex + i].count(toN.startIndex + j) > 0) {
-                            continue;
-                        }
-                        if (excludeSelf && fromN.startIndex + i == toN.startIndex + j) {
-                            continue;
-                        }
-                        double weight = weightGen.generate();
-                        data.synapticTargets[fromN.startIndex + i].push_back(toN.startIndex + j);
-                        data.synapticWeights[fromN.startIndex + i].push_back(weight);
+        forEachBlock(sources.size(), [&](size_t begin, size_t end) {
+            for (size_t k = begin; k < end; k++) {
+                const int sourceIdx = sources[k];
+                CounterRng rng(seed, CounterRng::streamId(ruleIndex, pairIndex, sourceIdx));
+                for (int targetIdx : targets) {
+                    if (excludeSelf && sourceIdx == targetIdx) {
+                        continue;
                     }
+                    connect(sourceIdx, targetIdx, rng);
                 }
             }
-        }
+        });
     }
     else if (ruleType == "probabilistic") {
-        Random& randGen = Random::getInstance();
         double probability = getNodeAs<double>(ruleNode, "probability", "rule");
         if (probability < 0.0 || probability > 1.0) {
             throw SNNParseException("'probability' musi byc w zakresie [0.0, 1.0] w regule 'probabilistic'.", ruleNode);
         }
-        for (const auto& fromN : fromNeurons) {
-            for (int i = 0; i < fromN.count; i++) {
-                for (const auto& toN : toNeurons) {
-                    for (int j = 0; j < toN.count; j++) {
-                        if (existingConnections[fromN.startIndex + i].count(toN.startIndex + j) > 0) {
-                            continue;
-                        }
-                        if (excludeSelf && fromN.startIndex + i == toN.startIndex + j) {
-                            continue;
-                        }
-                        if (randGen.nextDouble() < probability) {
-                            double weight = weightGen.generate();
-                            data.synapticTargets[fromN.startIndex + i].push_back(toN.startIndex + j);
-                            data.synapticWeights[fromN.startIndex + i].push_back(weight);
-                        }
+        if (probability == 0.0) {
+            return;
+        }
+        // Geometric skip sampling: the gap to the next connected target is geometrically
+        // distributed, so only the created synapses cost work instead of every candidate pair.
+        const double logNoConnection = std::log1p(-probability);
+        forEachBlock(sources.size(), [&](size_t begin, size_t end) {
+            for (size_t k = begin; k < end; k++) {
+                const int sourceIdx = sources[k];
+                CounterRng rng(seed, CounterRng::streamId(ruleIndex, pairIndex, sourceIdx));
+                long long position = -1;
+                while (true) {
+                    if (probability < 1.0) {
+                        const double gap = std::floor(std::log(1.0 - rng.nextDouble()) / logNoConnection);
+                        position += 1 + static_cast<long long>(std::min(gap, static_cast<double>(toCount)));
+                    } else {
+                        position++;
                     }
+                    if (position >= toCount) {
+                        break;
+                    }
+                    const int targetIdx = targets[position];
+                    if (excludeSelf && sourceIdx == targetIdx) {
+                        continue;
+                    }
+                    connect(sourceIdx, targetIdx, rng);
                 }
             }
-        }
+        });
     }
     else if (ruleType == "fixed_in_degree") {
         int count = getNodeAs<int>(ruleNode, "count", "rule");
         if (count <= 0) {
             throw SNNParseException("'count' musi byc dodatnie w regule 'fixed_in_degree'.", ruleNode);
         }
-        Random& randGen = Random::getInstance();
-        // Create a list of all possible source indices
-        std::vector<int> allSourceIndices;
-        allSourceIndices.reserve(fromCount);
-        for (const auto& from_n : fromNeurons) {
-            for (int i = 0; i < from_n.count; i++) {
-                allSourceIndices.push_back(from_n.startIndex + i);
-            }
-        }
-        // For each target neuron
-        for (const auto& to_n : toNeurons) {
-            for (int j = 0; j < to_n.count; j++) {
-                int targetIdx = to_n.startIndex + j;
-                std::vector<int> availableSources;
-                // Build list of available sources
-                availableSources.reserve(allSourceIndices.size());
-                for (int srcIdx : allSourceIndices) {
-                    if (excludeSelf && srcIdx == targetIdx) {
-                        continue;
-                    }
-                    if (existingConnections[srcIdx].count(targetIdx) == 0) {
-                        availableSources.push_back(srcIdx);
+        // Sources of a target are scattered over many rows, so each block of targets collects its
+        // synapses first and the blocks are appended to the rows in order afterwards. The targets
+        // are processed in waves of about PENDING_SYNAPSE_BUDGET synapses to bound that buffer.
+        struct PendingSynapse { int source; int target; double weight; };
+        const size_t blocksPerWave = std::max<size_t>(threadPool->size(),
+            PENDING_SYNAPSE_BUDGET / (static_cast<size_t>(count) * GENERATION_BLOCK_SIZE));
+        const size_t waveSize = blocksPerWave * GENERATION_BLOCK_SIZE;
+        std::vector<std::vector<PendingSynapse>> pending(blocksPerWave);
+        for (size_t waveBegin = 0; waveBegin < targets.size(); waveBegin += waveSize) {
+            const size_t waveEnd = std::min(targets.size(), waveBegin + waveSize);
+            forEachBlock(waveEnd - waveBegin, [&](size_t begin, size_t end) {
+                std::vector<PendingSynapse>& out = pending[begin / GENERATION_BLOCK_SIZE];
+                out.clear();
+                out.reserve((end - begin) * count);
+                DistinctSampler sampler;
+                for (size_t k = waveBegin + begin; k < waveBegin + end; k++) {
+                    const int targetIdx = targets[k];
+                    CounterRng rng(seed, CounterRng::streamId(ruleIndex, pairIndex, targetIdx));
+                    // the target itself is not a candidate source when excludeSelf is set
+                    const int selfPos = excludeSelf ? ordinalOf(sources, targetIdx) : -1;
+                    const int available = fromCount - (selfPos >= 0 ? 1 : 0);
+                    for (int ordinal : sampler.sample(available, std::min(count, available), rng)) {
+                        if (selfPos >= 0 && ordinal >= selfPos) {
+                            ordinal++;
+                        }
+                        out.push_back({sources[ordinal], targetIdx, weightGen.generate(rng)});
                     }
                 }
-                int realCount = std::min(count, static_cast<int>(availableSources.size()));
-                for (int k = 0; k < realCount; k++) {
-                    // Select a random source from available sources
-                    int randIndex = randGen.nextInt(static_cast<int>(availableSources.size()) - 1);
-                    int sourceIdx = availableSources[randIndex];
-                    double weight = weightGen.generate();
-                    data.synapticTargets[sourceIdx].push_back(targetIdx);
-                    data.synapticWeights[sourceIdx].push_back(weight);
-                    // Replace the removed element with the last one for O(1) removal
-                    availableSources[randIndex] = availableSources.back();
-                    availableSources.pop_back();
+            });
+            const size_t waveBlocks = (waveEnd - waveBegin + GENERATION_BLOCK_SIZE - 1) / GENERATION_BLOCK_SIZE;
+            for (size_t block = 0; block < waveBlocks; block++) {
+                for (const PendingSynapse& synapse : pending[block]) {
+                    addSynapse(synapse.source, synapse.target, synapse.weight, delay);
                 }
             }
         }
@@ -410,44 +1053,28 @@ void NetworkTopologyLoader::createConnectionsBetweenGroups(
         if (count <= 0) {
             throw SNNParseException("'count' musi byc dodatnie w regule 'fixed_out_degree'.", ruleNode);
         }
-        Random& randGen = Random::getInstance();
-        // Create a list of all possible target indices
-        std::vector<int> allTargetIndices;
-        allTargetIndices.reserve(toCount);
-        for (const auto& to_n : toNeurons) {
-            for (int j = 0; j < to_n.count; j++) {
-                allTargetIndices.push_back(to_n.startIndex + j);
-            }
-        }
-        // For each source neuron
-        for (const auto& from_n : fromNeurons) {
-            for (int i = 0; i < from_n.count; i++) {
-                int sourceIdx = from_n.startIndex + i;
-                std::vector<int> availableTargets;
-                for (int tgtIdx : allTargetIndices) {
-                    if (excludeSelf && sourceIdx == tgtIdx) {
-                        continue;
-                    }
-                    if (existingConnections[sourceIdx].count(tgtIdx) == 0) {
-                        availableTargets.push_back(tgtIdx);
-                    }
+        forEachBlock(sources.size(), [&](size_t begin, size_t end) {
+            DistinctSampler sampler;
+            for (size_t k = begin; k < end; k++) {
+                const int sourceIdx = sources[k];
+                CounterRng rng(seed, CounterRng::streamId(ruleIndex, pairIndex, sourceIdx));
+                // the source itself is not a candidate target when excludeSelf is set
+                const int selfPos = excludeSelf ? ordinalOf(targets, sourceIdx) : -1;
+                const int available = toCount - (selfPos >= 0 ? 1 : 0);
+                const int realCount = std::min(count, available);
+                if (buildPass == BuildPass::Rows) {
+                    synapticTargets[sourceIdx].reserve(synapticTargets[sourceIdx].size() + realCount);
+                    synapticWeights[sourceIdx].reserve(synapticWeights[sourceIdx].size() + realCount);
+                    synapticDelays[sourceIdx].reserve(synapticDelays[sourceIdx].size() + realCount);
                 }
-                int realCount = std::min(count, static_cast<int>(availableTargets.size()));
-                data.synapticTargets[sourceIdx].reserve(data.synapticTargets[sourceIdx].size() + realCount);
-                data.synapticWeights[sourceIdx].reserve(data.synapticWeights[sourceIdx].size() + realCount);
-                for (int k = 0; k < realCount; k++) {
-                    // Select a random target from available targets
-                    int randIndex = randGen.nextInt(static_cast<int>(availableTargets.size()) - 1);
-                    int targetIdx = availableTargets[randIndex];
-                    double weight = weightGen.generate();
-                    data.synapticTargets[sourceIdx].push_back(targetIdx);
-                    data.synapticWeights[sourceIdx].push_back(weight);
-                    // Replace the removed element with the last one for O(1) removal
-                    availableTargets[randIndex] = availableTargets.back();
-                    availableTargets.pop_back();
+                for (int ordinal : sampler.sample(available, realCount, rng)) {
+                    if (selfPos >= 0 && ordinal >= selfPos) {
+                        ordinal++;
+                    }
+                    connect(sourceIdx, targets[ordinal], rng);
                 }
             }
-        }
+        });
     }
     else {
         throw SNNParseException("Nieznany typ reguly polaczen '" + ruleType + "' w 'rule'.", ruleNode);
@@ -598,4 +1225,7 @@ bool NetworkTopologyLoader::isWildcard(const std::string& segment) const {
 // Helper function to extract wildcard number
 int NetworkTopologyLoader::getWildcardNumber(const std::string& segment) const {
     return std::stoi(segment.substr(1, segment.size() - 2));
-}
\ No newline at end of file
+}
+
+template NetworkTopologyLoader::BasicConfigData<float> NetworkTopologyLoader::loadFromYaml<float>(const std::string&);
+template NetworkTopologyLoader::BasicConfigData<double> NetworkTopologyLoader::loadFromYaml<double>(const std::string&);
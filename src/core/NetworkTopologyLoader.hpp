@@ -5,45 +5,142 @@
 #include <yaml-cpp/yaml.h>
 #include "SNNParseException.hpp"
 #include "WeightGenerator.hpp"
+#include "ThreadPool.hpp"
 #include <unordered_set>
 
+// Everything needed to construct a BasicSNN, produced by NetworkTopologyLoader or NetworkCache.
+template<typename Scalar>
+struct NetworkConfigData {
+    std::vector<IzhikevichParams> neuronParamTypes;
+    int totalNeuronCount = 0;
+    std::vector<int> globalNeuronTypeIds;
+    std::vector<Scalar> initialV;
+    std::vector<Scalar> initialU;
+    
+    BasicSynapseMatrix<Scalar> synapses;
+
+    GroupInfo rootGroup;
+    std::unordered_map<std::string, int> neuronTypeToIdMap;
+
+    std::vector<InputSource> inputs;
+    SimulationOptions simulation;
+    NetworkLoadTimings loadTimings;
+};
+
 class NetworkTopologyLoader {
 public:
-    struct ConfigData {
-        std::vector<IzhikevichParams> neuronParamTypes;
-        int totalNeuronCount = 0;
-        std::vector<int> globalNeuronTypeIds;
-        std::vector<double> initialV;
-        std::vector<double> initialU;
-        
-        std::vector<std::vector<int>> synapticTargets;
-        std::vector<std::vector<double>> synapticWeights;
-        
-        GroupInfo rootGroup;
-        std::unordered_map<std::string, int> neuronTypeToIdMap;
-    };
-    
-    ConfigData loadFromYaml(const std::string& filename);
+    static constexpr int MAX_SYNAPTIC_DELAY = 1000; // in simulation steps
+
+    template<typename Scalar>
+    using BasicConfigData = NetworkConfigData<Scalar>;
+    using ConfigData = BasicConfigData<SNNScalar>;
+
+    using LoadTimings = NetworkLoadTimings;
+
+    // Weights are drawn in double precision and rounded to Scalar as each synapse is added.
+    // Duplicates merged by 'sum' are added up in double and rounded again.
+    template<typename Scalar = SNNScalar>
+    BasicConfigData<Scalar> loadFromYaml(const std::string& filename);
+    const LoadTimings& getLoadTimings() const { return timings; } // of the last loadFromYaml call
+    void setVerbose(bool enabled) { verbose = enabled; } // print the matched group pairs of every rule (default on)
 
 private:
-    ConfigData data;
-    std::vector<std::unordered_set<int>> existingConnections;
+    // What to do with several synapses between the same pair of neurons with the same delay,
+    // e.g. created by overlapping rules (simulation.duplicates).
+    enum class DuplicatePolicy { Error, KeepFirst, Sum };
+
+    // How the synapses are built (simulation.construction). Rows grows a vector per neuron and
+    // flattens them at the end, which is fast but needs several times the final size at its peak.
+    // TwoPass applies the rules twice: the first pass only counts the synapses of every row, the
+    // final arrays are allocated once, and the second pass, which repeats the same random draws,
+    // writes the synapses straight into them.
+    enum class ConstructionMode { Rows, TwoPass };
+    enum class BuildPass { Rows, Count, Fill }; // what addSynapse does
+
+    // A parsed entry of 'connections'.
+    struct ConnectionRule {
+        std::string fromGroup;
+        std::string toGroup;
+        std::string fromType;
+        std::string toType;
+        bool excludeSelf;
+        uint16_t delay;
+        YAML::Node ruleNode;
+        WeightGenerator weightGen;
+        uint16_t plasticity; // index into stdpRules + 1, 0 = static
+        bool procedural;     // see ProceduralProjection
+    };
+    struct RowSynapse { int target; uint16_t delay; double weight; uint16_t plasticity; };
+
+    BasicConfigData<double> data; // working copy, synapses live in the per-neuron rows below
+    int maxDelay = 1;
+    LoadTimings timings;
+    bool verbose = true;
+    DuplicatePolicy duplicatePolicy = DuplicatePolicy::Sum;
+    ConstructionMode constructionMode = ConstructionMode::Rows;
+    BuildPass buildPass = BuildPass::Rows;
+    uint16_t rulePlasticity = 0;    // of the rule being applied
+    std::vector<size_t> rowCursors; // two-pass: synapse count of each row, then its next free position
+    bool singlePrecision = false;   // the weights are rounded to float, set by loadFromYaml
+    std::vector<float> singleWeights; // two-pass in single precision: the weights of data.synapses
+    std::unique_ptr<ThreadPool> threadPool; // used for connection generation, sized by simulation.threads
+
+    // per-neuron rows used while the rules are applied (ConstructionMode::Rows), flattened afterwards
+    std::vector<std::vector<int>> synapticTargets;
+    std::vector<std::vector<double>> synapticWeights;
+    std::vector<std::vector<uint16_t>> synapticDelays;
+    std::vector<std::vector<uint16_t>> synapticPlasticity; // see BasicSynapseMatrix::plasticity, empty until a rule is plastic
+    std::vector<StdpParams> stdpRules;
+    std::vector<std::vector<int>> proceduralSources; // of each projection in data.synapses.procedural
 
     template<typename T>
     T getNodeAs(const YAML::Node& parent, const std::string& key, const std::string& contextPath) const;
 
     WeightGenerator createWeightGenerator(const YAML::Node& weightNode, const std::string& contextPath) const;
+    StdpParams loadStdpParams(const YAML::Node& plasticityNode, const std::string& contextPath) const;
 
     int getNeuronTypeId(const std::string& typeName) const;
+    void loadSimulationOptions(const YAML::Node& simulationNode);
     void loadGroupData(const YAML::Node& groupNode, GroupInfo& groupInfo, int& currentStartIndex);
     void loadNeuronData(const YAML::Node& neuronsNode, GroupInfo& groupInfo, int& currentStartIndex);
     void loadConnectionsData(const YAML::Node& connectionsNode);
+    void loadInputsData(const YAML::Node& inputsNode);
+    void applyConnectionRules(const std::vector<ConnectionRule>& rules);
+    void addSynapse(int source, int target, double weight, uint16_t delay);
+    template<typename Weight>
+    size_t sortAndMergeRow(int* targets, Weight* weights, uint16_t* delays, uint16_t* plasticity, size_t count,
+                           std::vector<RowSynapse>& scratch, bool& duplicate) const;
+    void sortAndMergeRows();
+    template<typename Weight>
+    void sortAndMergeMatrix(std::vector<Weight>& weights);
+    void parseYaml(const std::string& filename);
+    template<typename Scalar>
+    void buildSynapseMatrix(BasicSynapseMatrix<Scalar>& matrix);
 
     void getMatchingNeuronCount(const GroupInfo& group, const int typeId, std::vector<NeuronInfo>& outNeurons) const;    // typeId == -1 means all types
+    std::vector<int> matchingNeuronIndices(const GroupInfo& group, const std::string& typeName) const; // ascending, "all" = every type
+    void addProceduralProjection(const GroupInfo& fromGroup, const GroupInfo& toGroup, const ConnectionRule& rule,
+                                 uint32_t ruleIndex, uint32_t pairIndex);
+    void buildProceduralIndex(std::vector<size_t>& offsets, std::vector<uint32_t>& index);
     void createConnectionsBetweenGroups(
         const GroupInfo& fromGroup, const GroupInfo& toGroup,
         const std::string& fromType, const std::string& toType,
-        const YAML::Node& ruleNode, WeightGenerator& weightGen, bool excludeSelf);
+        const YAML::Node& ruleNode, const WeightGenerator& weightGen, uint16_t delay, bool excludeSelf,
+        uint32_t ruleIndex, uint32_t pairIndex);
+
+    class DistinctSampler {
+    private:
+        std::vector<int> selected;
+        std::unordered_set<int> seen;
+    public:
+        const std::vector<int>& sample(int n, int count, CounterRng& rng);
+    };
+    static int ordinalOf(const std::vector<int>& sortedNeurons, int neuronIdx);
+
+    // Runs body(begin, end) over [0, count) split into blocks, in parallel on threadPool.
+    static constexpr size_t GENERATION_BLOCK_SIZE = 256;
+    static constexpr size_t PENDING_SYNAPSE_BUDGET = size_t(1) << 20; // per wave of fixed_in_degree targets
+    void forEachBlock(size_t count, const std::function<void(size_t, size_t)>& body);
 
     // find all pairs of (Group Nodes) matching the patterns
     std::vector<std::string> splitPath(const std::string& path) const;
@@ -0,0 +1,508 @@
+#include "PartitionedSNN.hpp"
+#include "CompactSynapses.hpp"
+#include "IzhikevichKernels.hpp"
+#include "InputGenerator.hpp"
+#include "ProceduralSynapses.hpp"
+#include "ProcessBarrier.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <stdexcept>
+
+#ifdef __linux__
+#include <csignal>
+#include <sys/mman.h>
+#include <sys/prctl.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+// Group starts as candidate partition bounds, with the depth of the group in the tree.
+static void collectGroupBounds(const GroupInfo& group, int depth, std::vector<std::pair<int, int>>& candidates) {
+    for (const GroupInfo& subgroup : group.subgroups) {
+        if (subgroup.totalCount > 0) {
+            candidates.push_back({subgroup.startIndex, depth + 1});
+            candidates.push_back({subgroup.startIndex + subgroup.totalCount, depth + 1});
+        }
+        collectGroupBounds(subgroup, depth + 1, candidates);
+    }
+}
+
+std::vector<int> planPartitionBounds(const GroupInfo& root, int totalNeuronCount, int parts) {
+    std::vector<std::pair<int, int>> candidates;
+    collectGroupBounds(root, 0, candidates);
+
+    std::vector<int> bounds(parts + 1, totalNeuronCount);
+    bounds[0] = 0;
+    const long long tolerance = static_cast<long long>(totalNeuronCount) / (4LL * parts);
+    for (int p = 1; p < parts; p++) {
+        const long long ideal = static_cast<long long>(totalNeuronCount) * p / parts;
+        int best = -1;
+        int bestDepth = 0;
+        long long bestDistance = 0;
+        for (const auto& [bound, depth] : candidates) {
+            const long long distance = std::llabs(bound - ideal);
+            if (bound <= bounds[p - 1] || bound >= totalNeuronCount || distance > tolerance) {
+                continue;
+            }
+            if (best < 0 || depth < bestDepth || (depth == bestDepth && distance < bestDistance)) {
+                best = bound;
+                bestDepth = depth;
+                bestDistance = distance;
+            }
+        }
+        if (best < 0) {
+            // no group boundary nearby, cut inside a group as SNN::setThreadCount does
+            best = std::min(totalNeuronCount, static_cast<int>((ideal + 7) / 8 * 8));
+        }
+        bounds[p] = std::max(best, bounds[p - 1]);
+    }
+    return bounds;
+}
+
+// Synapses onto the neurons [lo, hi) of one partition and the state of those neurons. Runs in the
+// process that owns the partition. Everything it needs is copied from the topology on construction,
+// so the stored synapses of the topology can be freed afterwards (see releaseSynapses).
+template<typename Scalar>
+class BasicPartitionedSNN<Scalar>::Worker {
+public:
+    Worker(const Topology& topology, int lo, int hi);
+
+    // Integrates the partition with the external input added and writes the global indices of the
+    // neurons that fired to fired. Returns their number.
+    int integrate(Scalar dt, Scalar* external, int* fired);
+    // Delivers the spikes of every partition (spikes + bounds[p], counts[p] entries) to our neurons.
+    void deliver(const int* spikes, const int* counts, const std::vector<int>& bounds);
+
+private:
+    const int lo;
+    const int hi;
+    const int count;
+    const int maxDelay;
+    long long step = 0;
+    std::vector<Scalar> v;
+    std::vector<Scalar> u;
+    std::vector<Scalar> I; // maxDelay slots of count currents, as in BasicSNN
+    std::vector<NeuronInfo> runs; // neuron runs clipped to the partition, start relative to lo
+    // CSR rows of all sources restricted to targets in [lo, hi), targets relative to lo
+    std::vector<size_t> offsets;
+    std::vector<int> targets;
+    std::vector<Scalar> weights;
+    std::vector<uint16_t> delays;
+    std::vector<Scalar*> delaySlots; // delaySlots[d] = slot receiving spikes delayed by d steps
+    IzhikevichKernels::IntegrateFn<Scalar> integrateKernel;
+    std::vector<IzhikevichParams> neuronParamTypes;
+    // the procedural projections with a target in [lo, hi), indexed as in BasicSynapseMatrix
+    std::vector<ProceduralProjection> procedural;
+    std::vector<size_t> proceduralOffsets;
+    std::vector<uint32_t> proceduralIndex;
+    std::vector<InputSource> inputs;
+    InputGenerator<Scalar> inputGenerator; // the inputs above, drawn for [lo, hi) only
+};
+
+template<typename Scalar>
+BasicPartitionedSNN<Scalar>::Worker::Worker(const Topology& topology, int lo, int hi)
+    : lo(lo), hi(hi), count(hi - lo), maxDelay(topology.synapses.maxDelay),
+      v(topology.initialV.begin() + lo, topology.initialV.begin() + hi),
+      u(topology.initialU.begin() + lo, topology.initialU.begin() + hi),
+      I(static_cast<size_t>(maxDelay) * (hi - lo), Scalar(0)), delaySlots(maxDelay + 1, nullptr),
+      integrateKernel(IzhikevichKernels::selectIntegrateKernel<Scalar>()),
+      neuronParamTypes(topology.neuronParamTypes), inputs(topology.inputs),
+      inputGenerator(inputs, topology.simulation.seed) {
+    for (const NeuronInfo& run : topology.neuronRuns) {
+        const int start = std::max(lo, run.startIndex);
+        const int end = std::min(hi, run.startIndex + run.count);
+        if (start < end) {
+            runs.push_back({run.typeId, end - start, start - lo});
+        }
+    }
+
+    const BasicSynapseMatrix<Scalar>& synapses = topology.synapses;
+    const int neuronCount = topology.totalNeuronCount;
+    if (!synapses.procedural.empty()) {
+        std::vector<int> keptIndex(synapses.procedural.size(), -1);
+        for (size_t k = 0; k < synapses.procedural.size(); k++) {
+            const std::vector<int>& candidates = synapses.procedural[k].targets; // ascending
+            const auto first = std::lower_bound(candidates.begin(), candidates.end(), lo);
+            if (first != candidates.end() && *first < hi) {
+                keptIndex[k] = static_cast<int>(procedural.size());
+                procedural.push_back(synapses.procedural[k]);
+            }
+        }
+        proceduralOffsets.assign(neuronCount + 1, 0);
+        for (int source = 0; source < neuronCount; source++) {
+            for (size_t k = synapses.proceduralOffsets[source]; k < synapses.proceduralOffsets[source + 1]; k++) {
+                if (keptIndex[synapses.proceduralIndex[k]] >= 0) {
+                    proceduralIndex.push_back(static_cast<uint32_t>(keptIndex[synapses.proceduralIndex[k]]));
+                }
+            }
+            proceduralOffsets[source + 1] = proceduralIndex.size();
+        }
+    }
+
+    // the part of every row that lands in this partition, counted first so nothing is over-allocated
+    offsets.assign(neuronCount + 1, 0);
+    if (synapses.isCompact()) {
+        // dequantized into the full format of the slice, which is a fraction of the matrix
+        for (int source = 0; source < neuronCount; source++) {
+            size_t rowCount = 0;
+            forEachSynapse(synapses, source, [&](int target, Scalar, int) { rowCount += target >= lo && target < hi; });
+            offsets[source + 1] = offsets[source] + rowCount;
+        }
+        targets.resize(offsets[neuronCount]);
+        weights.resize(offsets[neuronCount]);
+        delays.resize(offsets[neuronCount]);
+        for (int source = 0; source < neuronCount; source++) {
+            size_t k = offsets[source];
+            forEachSynapse(synapses, source, [&](int target, Scalar weight, int delay) {
+                if (target >= lo && target < hi) {
+                    targets[k] = target - lo;
+                    weights[k] = weight;
+                    delays[k] = static_cast<uint16_t>(delay);
+                    k++;
+                }
+            });
+        }
+        return;
+    }
+    const int* allTargets = synapses.targets.data();
+    for (int source = 0; source < neuronCount; source++) {
+        const int* rowBegin = allTargets + synapses.offsets[source];
+        const int* rowEnd = allTargets + synapses.offsets[source + 1];
+        offsets[source + 1] = offsets[source] + (std::lower_bound(rowBegin, rowEnd, hi) - std::lower_bound(rowBegin, rowEnd, lo));
+    }
+    targets.resize(offsets[neuronCount]);
+    weights.resize(offsets[neuronCount]);
+    delays.resize(offsets[neuronCount]);
+    for (int source = 0; source < neuronCount; source++) {
+        const int* rowBegin = allTargets + synapses.offsets[source];
+        const int* rowEnd = allTargets + synapses.offsets[source + 1];
+        size_t s = std::lower_bound(rowBegin, rowEnd, lo) - allTargets;
+        for (size_t k = offsets[source]; k < offsets[source + 1]; k++, s++) {
+            targets[k] = allTargets[s] - lo;
+            weights[k] = synapses.weights[s];
+            delays[k] = synapses.delays[s];
+        }
+    }
+}
+
+template<typename Scalar>
+int BasicPartitionedSNN<Scalar>::Worker::integrate(Scalar dt, Scalar* external, int* fired) {
+    Scalar* input = I.data() + (step % maxDelay) * count;
+    for (int k = 0; k < count; k++) {
+        input[k] += external[lo + k];
+        external[lo + k] = Scalar(0);
+    }
+    if (!inputGenerator.empty()) {
+        inputGenerator.prepare(dt);
+        inputGenerator.addCurrents(step, lo, hi, input);
+    }
+    int firedCount = 0;
+    for (const NeuronInfo& run : runs) {
+        firedCount += integrateKernel(v.data(), u.data(), input, run.startIndex, run.count,
+                                      neuronParamTypes[run.typeId], dt, fired + firedCount);
+    }
+    for (int f = 0; f < firedCount; f++) {
+        fired[f] += lo;
+    }
+    std::fill(input, input + count, Scalar(0));
+    return firedCount;
+}
+
+template<typename Scalar>
+void BasicPartitionedSNN<Scalar>::Worker::deliver(const int* spikes, const int* counts, const std::vector<int>& bounds) {
+    for (int d = 1; d <= maxDelay; d++) {
+        delaySlots[d] = I.data() + ((step + d) % maxDelay) * count;
+    }
+    // partitions in order, so the spikes arrive in ascending order as in BasicSNN
+    for (size_t p = 0; p + 1 < bounds.size(); p++) {
+        const int* fired = spikes + bounds[p];
+        for (int f = 0; f < counts[p]; f++) {
+            const int neuron = fired[f];
+            for (size_t s = offsets[neuron]; s < offsets[neuron + 1]; s++) {
+                delaySlots[delays[s]][targets[s]] += weights[s];
+            }
+            if (procedural.empty()) {
+                continue;
+            }
+            for (size_t k = proceduralOffsets[neuron]; k < proceduralOffsets[neuron + 1]; k++) {
+                const ProceduralProjection& projection = procedural[proceduralIndex[k]];
+                Scalar* slot = delaySlots[projection.delay];
+                forEachProceduralSynapse(projection, neuron, lo, hi, [&](int target, double weight) {
+                    slot[target - lo] += static_cast<Scalar>(weight);
+                });
+            }
+        }
+    }
+    step++;
+}
+
+// Frees the stored synapses of a topology owned by the simulation once the Worker of the process
+// has taken its slice; maxDelay is kept. Each process frees its own copy, the forked workers
+// included, which would otherwise keep the whole matrix mapped.
+template<typename Scalar>
+static void releaseSynapses(BasicNetworkTopology<Scalar>& topology) {
+    const int maxDelay = topology.synapses.maxDelay;
+    topology.synapses = BasicSynapseMatrix<Scalar>();
+    topology.synapses.maxDelay = maxDelay;
+}
+
+// Control block at the start of the shared mapping.
+template<typename Scalar>
+struct BasicPartitionedSNN<Scalar>::SharedState {
+    enum Command : uint32_t { Step, Stop };
+
+    explicit SharedState(int processes) : stepStart(processes), spikesPublished(processes) {}
+
+    ProcessBarrier stepStart;       // the command for the step is published
+    ProcessBarrier spikesPublished; // every partition has written its spikes
+    Command command = Step;
+    double dt = 0;
+    std::atomic<int> failedPartition{-1}; // first worker that reported an exception, its message in error
+    char error[256] = {};
+};
+
+// Offset of the next array of T after size bytes.
+template<typename T>
+static size_t alignFor(size_t size) {
+    return (size + alignof(T) - 1) / alignof(T) * alignof(T);
+}
+
+template<typename Scalar>
+BasicPartitionedSNN<Scalar>::BasicPartitionedSNN(std::shared_ptr<const Topology> sharedTopology, int processes)
+    : topology(std::move(sharedTopology)) {
+    start(processes, nullptr);
+}
+
+template<typename Scalar>
+BasicPartitionedSNN<Scalar>::BasicPartitionedSNN(std::unique_ptr<Topology> ownTopology, int processes) {
+    Topology* owned = ownTopology.get();
+    topology = std::move(ownTopology);
+    start(processes, owned);
+}
+
+template<typename Scalar>
+void BasicPartitionedSNN<Scalar>::start(int processes, Topology* owned) {
+    if (!topology) {
+        throw std::runtime_error("Brak topologii sieci.");
+    }
+#ifndef __linux__
+    (void)processes;
+    (void)owned;
+    throw std::runtime_error("Symulacja wieloprocesowa jest dostepna tylko w systemie Linux.");
+#else
+    if (processes < 1) {
+        throw std::runtime_error("Liczba procesow musi byc dodatnia.");
+    }
+    if (topology->isPlastic()) {
+        throw std::runtime_error("Symulacja wieloprocesowa nie obsluguje plastycznosci synaps.");
+    }
+    bounds = planPartitionBounds(topology->rootGroup, topology->totalNeuronCount, processes);
+    firedNeurons.resize(topology->totalNeuronCount);
+    mapSharedState();
+    try {
+        startWorkers(owned);
+        localWorker = std::make_unique<Worker>(*topology, bounds[0], bounds[1]);
+        if (owned) {
+            releaseSynapses(*owned);
+        }
+    } catch (...) {
+        shared->stepStart.abort();
+        release();
+        throw;
+    }
+#endif
+}
+
+template<typename Scalar>
+void BasicPartitionedSNN<Scalar>::mapSharedState() {
+#ifdef __linux__
+    const int processes = getProcessCount();
+    const size_t neuronCount = static_cast<size_t>(topology->totalNeuronCount);
+    const size_t countsOffset = alignFor<int>(sizeof(SharedState));
+    const size_t inputOffset = alignFor<Scalar>(countsOffset + sizeof(int) * processes);
+    const size_t spikesOffset = alignFor<int>(inputOffset + sizeof(Scalar) * neuronCount);
+    mappingSize = spikesOffset + sizeof(int) * neuronCount;
+
+    // anonymous and shared, inherited by the forked workers; the pages start zeroed
+    mapping = ::mmap(nullptr, mappingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (mapping == MAP_FAILED) {
+        mapping = nullptr;
+        throw std::runtime_error("Nie mozna utworzyc pamieci wspoldzielonej dla " + std::to_string(processes) + " procesow.");
+    }
+    char* base = static_cast<char*>(mapping);
+    shared = new (base) SharedState(processes);
+    exchangedCounts = reinterpret_cast<int*>(base + countsOffset);
+    externalInput = reinterpret_cast<Scalar*>(base + inputOffset);
+    exchangedSpikes = reinterpret_cast<int*>(base + spikesOffset);
+#endif
+}
+
+template<typename Scalar>
+void BasicPartitionedSNN<Scalar>::startWorkers(Topology* owned) {
+#ifdef __linux__
+    const pid_t parent = ::getpid();
+    for (int partition = 1; partition < getProcessCount(); partition++) {
+        const pid_t pid = ::fork();
+        if (pid == 0) {
+            // a worker must not outlive the simulation it belongs to
+            ::prctl(PR_SET_PDEATHSIG, SIGKILL);
+            if (::getppid() != parent) {
+                ::_exit(EXIT_FAILURE);
+            }
+            runWorker(partition, owned);
+        }
+        if (pid < 0) {
+            throw std::runtime_error("Nie mozna uruchomic procesu roboczego: " + std::string(std::strerror(errno)));
+        }
+        workerPids.push_back(pid);
+    }
+#else
+    (void)owned;
+#endif
+}
+
+template<typename Scalar>
+void BasicPartitionedSNN<Scalar>::runWorker(int partition, Topology* owned) {
+#ifdef __linux__
+    // runs in the forked process until told to stop; never returns into the caller's code
+    int status = EXIT_SUCCESS;
+    try {
+        Worker worker(*topology, bounds[partition], bounds[partition + 1]);
+        if (owned) {
+            releaseSynapses(*owned);
+        }
+        int* fired = exchangedSpikes + bounds[partition];
+        while (true) {
+            if (!shared->stepStart.wait()) {
+                status = EXIT_FAILURE;
+                break;
+            }
+            if (shared->command == SharedState::Stop) {
+                break;
+            }
+            exchangedCounts[partition] = worker.integrate(static_cast<Scalar>(shared->dt), externalInput, fired);
+            if (!shared->spikesPublished.wait()) {
+                status = EXIT_FAILURE;
+                break;
+            }
+            worker.deliver(exchangedSpikes, exchangedCounts, bounds);
+        }
+    } catch (const std::exception& e) {
+        // the first failure is reported, the barriers release everyone else
+        int none = -1;
+        if (shared->failedPartition.compare_exchange_strong(none, partition)) {
+            std::strncpy(shared->error, e.what(), sizeof(shared->error) - 1);
+        }
+        shared->stepStart.abort();
+        shared->spikesPublished.abort();
+        status = EXIT_FAILURE;
+    }
+    ::_exit(status);
+#else
+    (void)partition;
+    (void)owned;
+    std::abort();
+#endif
+}
+
+template<typename Scalar>
+void BasicPartitionedSNN<Scalar>::pollWorkers() {
+#ifdef __linux__
+    for (int& pid : workerPids) {
+        int status = 0;
+        if (pid > 0 && ::waitpid(pid, &status, WNOHANG) == pid) {
+            pid = -1; // reaped
+            shared->stepStart.abort();
+            shared->spikesPublished.abort();
+        }
+    }
+#endif
+}
+
+template<typename Scalar>
+void BasicPartitionedSNN<Scalar>::stopWorkers() {
+#ifdef __linux__
+    if (!shared->stepStart.isAborted()) {
+        shared->command = SharedState::Stop;
+        shared->stepStart.wait([this]() { pollWorkers(); });
+    }
+    for (int& pid : workerPids) {
+        if (pid > 0) {
+            if (shared->stepStart.isAborted()) {
+                ::kill(pid, SIGKILL);
+            }
+            ::waitpid(pid, nullptr, 0);
+            pid = -1;
+        }
+    }
+#endif
+}
+
+template<typename Scalar>
+void BasicPartitionedSNN<Scalar>::throwWorkerFailure() {
+    std::string message;
+    const int partition = shared->failedPartition.load();
+    if (partition >= 0) {
+        message = "Proces roboczy partycji " + std::to_string(partition) + " zglosil blad: " + shared->error;
+    } else {
+        message = "Proces roboczy zakonczyl sie nieoczekiwanie.";
+    }
+    stopWorkers();
+    throw std::runtime_error(message);
+}
+
+template<typename Scalar>
+BasicPartitionedSNN<Scalar>::~BasicPartitionedSNN() {
+    release();
+}
+
+template<typename Scalar>
+void BasicPartitionedSNN<Scalar>::release() {
+#ifdef __linux__
+    if (mapping) {
+        stopWorkers();
+        shared->~SharedState();
+        ::munmap(mapping, mappingSize);
+        mapping = nullptr;
+        shared = nullptr;
+    }
+#endif
+}
+
+template<typename Scalar>
+void BasicPartitionedSNN<Scalar>::injectCurrent(int neuron, double current) {
+    if (neuron < 0 || neuron >= topology->totalNeuronCount) {
+        throw std::runtime_error("Neuron " + std::to_string(neuron) + " jest poza siecia.");
+    }
+    externalInput[neuron] += static_cast<Scalar>(current);
+}
+
+template<typename Scalar>
+void BasicPartitionedSNN<Scalar>::step(double dt) {
+    const auto poll = [this]() { pollWorkers(); };
+    // the workers read the command only after this barrier and are done with the previous step
+    shared->command = SharedState::Step;
+    shared->dt = dt;
+    if (!shared->stepStart.wait(poll)) {
+        throwWorkerFailure();
+    }
+    exchangedCounts[0] = localWorker->integrate(static_cast<Scalar>(dt), externalInput, exchangedSpikes + bounds[0]);
+    if (!shared->spikesPublished.wait(poll)) {
+        throwWorkerFailure();
+    }
+
+    firedCount = 0;
+    for (int p = 0; p < getProcessCount(); p++) {
+        const int* first = exchangedSpikes + bounds[p];
+        std::copy(first, first + exchangedCounts[p], firedNeurons.data() + firedCount);
+        firedCount += exchangedCounts[p];
+    }
+    localWorker->deliver(exchangedSpikes, exchangedCounts, bounds);
+    currentStep++;
+}
+
+template class BasicPartitionedSNN<float>;
+template class BasicPartitionedSNN<double>;
@@ -0,0 +1,94 @@
+#ifndef PARTITIONED_SNN_HPP
+#define PARTITIONED_SNN_HPP
+
+#include "SNN.hpp"
+#include <memory>
+#include <string>
+#include <vector>
+
+// Bounds of 'parts' contiguous neuron ranges of roughly equal size: part p is
+// [bounds[p], bounds[p + 1]). A bound is placed on the start of a group when one lies within a
+// quarter of a part of the ideal position, preferring the outermost group, whose neurons are the
+// most likely to be connected with each other; otherwise the range is cut inside a group.
+std::vector<int> planPartitionBounds(const GroupInfo& root, int totalNeuronCount, int parts);
+
+/**
+ * @brief One network simulated by several processes on one machine (Linux only).
+ *
+ * The neurons are split into contiguous partitions (see planPartitionBounds), one per process.
+ * The constructor forks a worker process for every partition but the first, which the calling
+ * process simulates itself. A worker keeps only the synapses onto its own neurons, taken from the
+ * topology after the fork, and the state of its neurons. A topology handed over as a unique_ptr is
+ * owned by the simulation alone: once the partitions have taken their slices, every process frees
+ * its stored synapses, so the full matrix is not kept anywhere (getTopology then has none). A
+ * shared topology is left unchanged. In every step each process integrates its neurons and
+ * publishes the indices of those that fired in a shared memory mapping; after a barrier every
+ * process reads the spikes of all partitions and delivers them to its own neurons.
+ * A step therefore has two barriers and exchanges only spike indices, and the result is the same
+ * as that of BasicSNN with one thread per partition.
+ *
+ * Each process runs single-threaded. STDP, recorders, probes and checkpoints are not supported.
+ * If a worker fails or dies, step throws std::runtime_error and the other workers are stopped. The
+ * object should be created before the calling process starts other threads, as fork copies only the
+ * calling thread.
+ */
+template<typename Scalar>
+class BasicPartitionedSNN {
+public:
+    using Topology = BasicNetworkTopology<Scalar>;
+
+    // Throw std::runtime_error if the processes cannot be created or the network is plastic.
+    BasicPartitionedSNN(std::shared_ptr<const Topology> topology, int processes);
+    BasicPartitionedSNN(std::unique_ptr<Topology> topology, int processes); // frees the synapses once sliced
+    BasicPartitionedSNN(const BasicPartitionedSNN&) = delete;
+    BasicPartitionedSNN& operator=(const BasicPartitionedSNN&) = delete;
+    ~BasicPartitionedSNN(); // stops the workers and waits for them to exit
+
+    void step(double dt); // Advance the simulation by dt milliseconds
+    void injectCurrent(int neuron, double current); // added to the input of the next step
+
+    int getProcessCount() const { return static_cast<int>(bounds.size()) - 1; }
+    const std::vector<int>& getPartitionBounds() const { return bounds; }
+    int getNeuronCount() const { return topology->totalNeuronCount; }
+    const int* getFiredNeurons() const { return firedNeurons.data(); } // ascending
+    int getFiredCount() const { return firedCount; }
+    long long getCurrentStep() const { return currentStep; }
+    const GroupInfo& getRootGroup() const { return topology->rootGroup; }
+    const std::shared_ptr<const Topology>& getTopology() const { return topology; }
+
+private:
+    struct SharedState;
+    class Worker;
+
+    std::shared_ptr<const Topology> topology;
+    std::vector<int> bounds;
+    void* mapping = nullptr; // SharedState followed by the exchange arrays
+    size_t mappingSize = 0;
+    SharedState* shared = nullptr;
+    Scalar* externalInput = nullptr; // totalNeuronCount currents, consumed by the next step
+    int* exchangedSpikes = nullptr;  // totalNeuronCount, partition p writes from bounds[p]
+    int* exchangedCounts = nullptr;  // number of spikes written by each partition
+    std::vector<int> workerPids;     // of partitions 1..
+    std::unique_ptr<Worker> localWorker; // partition 0
+    std::vector<int> firedNeurons;
+    int firedCount = 0;
+    long long currentStep = 0;
+
+    // owned is the topology when it was handed over as a unique_ptr, otherwise null
+    void start(int processes, Topology* owned);
+    void mapSharedState();
+    void startWorkers(Topology* owned);
+    void stopWorkers();
+    void release(); // stops the workers and unmaps the shared state
+    void pollWorkers(); // aborts the barriers if a worker has exited
+    [[noreturn]] void throwWorkerFailure();
+    [[noreturn]] void runWorker(int partition, Topology* owned); // body of a forked worker process
+};
+
+// explicitly instantiated in PartitionedSNN.cpp
+extern template class BasicPartitionedSNN<float>;
+extern template class BasicPartitionedSNN<double>;
+
+using PartitionedSNN = BasicPartitionedSNN<SNNScalar>;
+
+#endif // PARTITIONED_SNN_HPP
@@ -0,0 +1,72 @@
+#ifndef PROCEDURAL_SYNAPSES_HPP
+#define PROCEDURAL_SYNAPSES_HPP
+
+#include "SNN.hpp"
+#include "CounterRng.hpp"
+#include <algorithm>
+#include <cmath>
+
+// Calls fn(target, weight) for the synapses of source in the projection whose target lies in
+// [lo, hi), in ascending target order. The row is regenerated with the same draws as in
+// NetworkTopologyLoader::createConnectionsBetweenGroups, so it equals the stored row the rule
+// would have produced. The stream cannot be entered in the middle, except for all_to_all with a
+// fixed number of draws per weight, so the row is walked from its start up to hi.
+template<typename Fn>
+void forEachProceduralSynapse(const ProceduralProjection& projection, int source, int lo, int hi, Fn&& fn) {
+    const std::vector<int>& targets = projection.targets;
+    const long long targetCount = static_cast<long long>(targets.size());
+    CounterRng rng(projection.seed, CounterRng::streamId(projection.ruleIndex, projection.pairIndex, source));
+
+    if (!projection.probabilistic) {
+        long long position = 0;
+        const int words = projection.weights.wordsPerDraw();
+        if (words >= 0 && lo > 0) {
+            // every target before ours took the same number of words, except the source itself
+            position = std::lower_bound(targets.begin(), targets.end(), lo) - targets.begin();
+            long long drawn = position;
+            if (projection.excludeSelf && std::binary_search(targets.begin(), targets.begin() + position, source)) {
+                drawn--;
+            }
+            rng.skip(static_cast<uint64_t>(drawn) * words);
+        }
+        for (; position < targetCount && targets[position] < hi; position++) {
+            const int target = targets[position];
+            if (projection.excludeSelf && target == source) {
+                continue;
+            }
+            const double weight = projection.weights.generate(rng);
+            if (target >= lo) {
+                fn(target, weight);
+            }
+        }
+        return;
+    }
+
+    if (projection.probability == 0.0) {
+        return;
+    }
+    // geometric skip sampling, as in the loader
+    const double logNoConnection = std::log1p(-projection.probability);
+    long long position = -1;
+    while (true) {
+        if (projection.probability < 1.0) {
+            const double gap = std::floor(std::log(1.0 - rng.nextDouble()) / logNoConnection);
+            position += 1 + static_cast<long long>(std::min(gap, static_cast<double>(targetCount)));
+        } else {
+            position++;
+        }
+        if (position >= targetCount || targets[position] >= hi) {
+            return;
+        }
+        const int target = targets[position];
+        if (projection.excludeSelf && target == source) {
+            continue;
+        }
+        const double weight = projection.weights.generate(rng);
+        if (target >= lo) {
+            fn(target, weight);
+        }
+    }
+}
+
+#endif // PROCEDURAL_SYNAPSES_HPP
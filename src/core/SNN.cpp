@@ -1,60 +1,776 @@
 #include "SNN.hpp"
+#include "CompactSynapses.hpp"
 #include "NetworkTopologyLoader.hpp"
-#include <iostream>
-#include <iomanip>
-#include <thread>
-#include <chrono>
-#define NOMINMAX
-#include <windows.h> // For GetAsyncKeyState
-
-SNN::SNN(const std::string &filename) {
+#include "NetworkCache.hpp"
+#include "IzhikevichKernels.hpp"
+#include "InputGenerator.hpp"
+#include "ProceduralSynapses.hpp"
+#include "ThreadPool.hpp"
+#include "Checkpoint.hpp"
+#include "MappedFile.hpp"
+#include "Hash.hpp"
+#include "SpikeRecorder.hpp"
+#include "StateProbe.hpp"
+#include "StepMetrics.hpp"
+#include <algorithm>
+#include <cmath>
+#include <iterator>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+
+const GroupInfo* findGroupByFullName(const GroupInfo& root, const std::string& fullName) {
+    if (root.fullName == fullName) {
+        return &root;
+    }
+    for (const GroupInfo& subgroup : root.subgroups) {
+        // descend only into the subgroup that is a prefix of the searched name
+        if (fullName.compare(0, subgroup.fullName.size(), subgroup.fullName) == 0) {
+            if (const GroupInfo* found = findGroupByFullName(subgroup, fullName)) {
+                return found;
+            }
+        }
+    }
+    return nullptr;
+}
+
+// Wildcard segment "[i]", see NetworkTopologyLoader::isWildcard.
+static bool isWildcardSegment(const std::string& segment) {
+    return segment.size() >= 3 && segment.front() == '[' && segment.back() == ']' &&
+           std::all_of(segment.begin() + 1, segment.end() - 1, [](char c) { return c >= '0' && c <= '9'; });
+}
+
+static void matchGroupSegments(const GroupInfo& group, const std::vector<std::string>& segments, size_t index,
+                               std::map<std::string, std::string>& wildcardValues, std::vector<NeuronRange>& ranges) {
+    if (index == segments.size()) {
+        if (group.totalCount > 0) {
+            ranges.push_back({group.startIndex, group.totalCount});
+        }
+        return;
+    }
+    const std::string& segment = segments[index];
+    if (!isWildcardSegment(segment)) {
+        for (const GroupInfo& subgroup : group.subgroups) {
+            if (subgroup.name == segment) {
+                matchGroupSegments(subgroup, segments, index + 1, wildcardValues, ranges);
+            }
+        }
+        return;
+    }
+    const auto bound = wildcardValues.find(segment);
+    for (const GroupInfo& subgroup : group.subgroups) {
+        if (bound != wildcardValues.end()) {
+            if (subgroup.name == bound->second) {
+                matchGroupSegments(subgroup, segments, index + 1, wildcardValues, ranges);
+            }
+        } else {
+            wildcardValues[segment] = subgroup.name;
+            matchGroupSegments(subgroup, segments, index + 1, wildcardValues, ranges);
+            wildcardValues.erase(segment);
+        }
+    }
+}
+
+std::vector<NeuronRange> resolveGroupPattern(const GroupInfo& root, const std::string& pattern) {
+    std::string path = pattern;
+    if (path == root.fullName) {
+        path.clear();
+    } else if (path.compare(0, root.fullName.size() + 1, root.fullName + ".") == 0) {
+        path = path.substr(root.fullName.size() + 1);
+    }
+    std::vector<std::string> segments;
+    std::stringstream ss(path);
+    std::string token;
+    while (std::getline(ss, token, '.')) {
+        segments.push_back(token);
+    }
+
+    std::vector<NeuronRange> ranges;
+    std::map<std::string, std::string> wildcardValues;
+    matchGroupSegments(root, segments, 0, wildcardValues, ranges);
+
+    // a group matched through several paths or nested in another matched group is counted once
+    std::sort(ranges.begin(), ranges.end(), [](const NeuronRange& x, const NeuronRange& y) { return x.start < y.start; });
+    std::vector<NeuronRange> merged;
+    for (const NeuronRange& range : ranges) {
+        if (!merged.empty() && range.start <= merged.back().start + merged.back().count) {
+            merged.back().count = std::max(merged.back().count, range.start + range.count - merged.back().start);
+        } else {
+            merged.push_back(range);
+        }
+    }
+    return merged;
+}
+
+void collectNeuronRuns(const GroupInfo& group, std::vector<NeuronInfo>& runs) {
+    for (const auto& subgroup : group.subgroups) {
+        collectNeuronRuns(subgroup, runs);
+    }
+    // leaf groups are laid out in order, so neighbouring runs of the same type can be merged
+    for (const auto& nInfo : group.neuronInfos) {
+        if (!runs.empty() && runs.back().typeId == nInfo.typeId &&
+            runs.back().startIndex + runs.back().count == nInfo.startIndex) {
+            runs.back().count += nInfo.count;
+        } else {
+            runs.push_back(nInfo);
+        }
+    }
+}
+
+template<typename Scalar>
+BasicSNN<Scalar>::BasicSNN(const std::string &filename)
     // Use NetworkTopologyLoader to load configuration from YAML
-    NetworkTopologyLoader loader;
-    NetworkTopologyLoader::ConfigData config = loader.loadFromYaml(filename);
-    
-    // Transfer loaded data to SNN member variables
-    neuronParamTypes = std::move(config.neuronParamTypes);
-    rootGroup = std::move(config.rootGroup);
-    totalNeuronCount = config.totalNeuronCount;
-    neuronToTypeId = std::move(config.globalNeuronTypeIds);
-    v = std::move(config.initialV);
-    u = std::move(config.initialU);
-    synapticTargets = std::move(config.synapticTargets);
-    synapticWeights = std::move(config.synapticWeights);
-    
-    // Initialize input current vector
-    I.resize(totalNeuronCount, 0.0);
-}
-
-void SNN::step(double dt) {
-    // update membrane potentials and recovery variables
-    for (int i = 0; i < totalNeuronCount; i++) {
-        // u' = a(bv - u)
-        // v' = 0.04v^2 + 5v + 140 - u + I
-        // it is crucial to update u before v to achieve numerical stability
-        int typeId = neuronToTypeId[i];
-        u[i] += dt * (neuronParamTypes[typeId].a * (neuronParamTypes[typeId].b * v[i] - u[i]));
-        v[i] += dt * (0.04 * v[i] * v[i] + 5 * v[i] + 143 - u[i] + I[i]);
-    }
-
-    // reset input current
-    std::fill(I.begin(), I.end(), 0.0);
-
-    // handle spikes and propagate
-    for (int i = 0; i < totalNeuronCount; i++) {
-        int typeId = neuronToTypeId[i];
-        // if v >= 30 mV
-        //  v = c, u = u + d
-        if (v[i] >= 30.0) {
-            v[i] = neuronParamTypes[typeId].c;
-            u[i] += neuronParamTypes[typeId].d;
-
-            for (int j = 0; j < synapticTargets[i].size(); j++) {
-                int targetIdx = synapticTargets[i][j];
-                double weight = synapticWeights[i][j];
-                #pragma omp atomic
-                I[targetIdx] += weight;
+    : BasicSNN(NetworkTopologyLoader().loadFromYaml<Scalar>(filename)) {
+}
+
+template<typename Scalar>
+BasicSNN<Scalar>::BasicSNN(const std::string &filename, const std::string &cacheFile)
+    : BasicSNN(NetworkCache::loadOrBuild<Scalar>(filename, cacheFile)) {
+}
+
+template<typename Scalar>
+std::shared_ptr<const BasicNetworkTopology<Scalar>> BasicNetworkTopology<Scalar>::create(NetworkConfigData<Scalar>&& config) {
+    return createUnique(std::move(config));
+}
+
+template<typename Scalar>
+std::unique_ptr<BasicNetworkTopology<Scalar>> BasicNetworkTopology<Scalar>::createUnique(NetworkConfigData<Scalar>&& config) {
+    auto topology = std::make_unique<BasicNetworkTopology>();
+    topology->neuronParamTypes = std::move(config.neuronParamTypes);
+    topology->neuronTypeToIdMap = std::move(config.neuronTypeToIdMap);
+    topology->totalNeuronCount = config.totalNeuronCount;
+    topology->neuronToTypeId = std::move(config.globalNeuronTypeIds);
+    topology->rootGroup = std::move(config.rootGroup);
+    topology->synapses = std::move(config.synapses);
+    topology->initialV = std::move(config.initialV);
+    topology->initialU = std::move(config.initialU);
+    topology->inputs = std::move(config.inputs);
+    topology->simulation = config.simulation;
+    topology->loadTimings = std::move(config.loadTimings);
+    collectNeuronRuns(topology->rootGroup, topology->neuronRuns);
+    if (topology->simulation.weightBits != 0) {
+        compactSynapseMatrix(topology->synapses, topology->simulation.weightBits);
+    }
+
+    if (topology->isPlastic()) {
+        // counting sort of the plastic synapses by target; sources are visited in ascending order
+        const BasicSynapseMatrix<Scalar>& synapses = topology->synapses;
+        const int neuronCount = topology->totalNeuronCount;
+        std::vector<size_t>& offsets = topology->incomingOffsets;
+        offsets.assign(neuronCount + 1, 0);
+        for (size_t s = 0; s < synapses.targets.size(); s++) {
+            if (synapses.plasticity[s] != 0) {
+                offsets[synapses.targets[s] + 1]++;
+            }
+        }
+        for (int i = 0; i < neuronCount; i++) {
+            offsets[i + 1] += offsets[i];
+        }
+        topology->incomingSynapses.resize(offsets[neuronCount]);
+        topology->incomingSources.resize(offsets[neuronCount]);
+        std::vector<size_t> next(offsets.begin(), offsets.end() - 1);
+        for (int source = 0; source < neuronCount; source++) {
+            for (size_t s = synapses.offsets[source]; s < synapses.offsets[source + 1]; s++) {
+                if (synapses.plasticity[s] != 0) {
+                    const size_t k = next[synapses.targets[s]]++;
+                    topology->incomingSynapses[k] = s;
+                    topology->incomingSources[k] = source;
+                }
             }
         }
     }
-}
\ No newline at end of file
+    return topology;
+}
+
+template<typename Scalar>
+std::shared_ptr<const BasicNetworkTopology<Scalar>> BasicNetworkTopology<Scalar>::load(const std::string& filename) {
+    return create(NetworkTopologyLoader().loadFromYaml<Scalar>(filename));
+}
+
+template<typename Scalar>
+BasicSNN<Scalar>::BasicSNN(NetworkConfigData<Scalar>&& config)
+    : BasicSNN(BasicNetworkTopology<Scalar>::create(std::move(config))) {
+}
+
+template<typename Scalar>
+BasicSNN<Scalar>::BasicSNN(std::shared_ptr<const BasicNetworkTopology<Scalar>> sharedTopology)
+    : BasicSNN(sharedTopology, sharedTopology ? sharedTopology->simulation.threads : 1) {
+}
+
+template<typename Scalar>
+BasicSNN<Scalar>::BasicSNN(std::shared_ptr<const BasicNetworkTopology<Scalar>> sharedTopology, int threads)
+    : topology(std::move(sharedTopology)) {
+    if (!topology) {
+        throw std::runtime_error("Brak topologii sieci.");
+    }
+    totalNeuronCount = topology->totalNeuronCount;
+    v = topology->initialV;
+    u = topology->initialU;
+
+    // Initialize the input current ring, one slot per step of delay
+    I.resize(static_cast<size_t>(topology->synapses.maxDelay) * totalNeuronCount, Scalar(0));
+    delaySlots.resize(topology->synapses.maxDelay + 1, nullptr);
+    firedNeurons.resize(totalNeuronCount);
+
+    integrateKernel = IzhikevichKernels::selectIntegrateKernel<Scalar>();
+    if (!topology->inputs.empty()) {
+        inputGenerator = std::make_unique<InputGenerator<Scalar>>(topology->inputs, topology->simulation.seed);
+    }
+
+    weights = topology->synapses.weights.data();
+    if (topology->isPlastic()) {
+        learnedWeights = topology->synapses.weights;
+        weights = learnedWeights.data();
+        const size_t traceCount = topology->synapses.stdpRules.size() * static_cast<size_t>(totalNeuronCount);
+        preTraces.assign(traceCount, Scalar(0));
+        postTraces.assign(traceCount, Scalar(0));
+        lastSpikeTimes.assign(totalNeuronCount, 0.0);
+    }
+
+    integrateTask = [this](int partition) { integratePartition(partition); };
+    if (topology->isPlastic()) {
+        deliverTask = [this](int partition) { deliverPlasticPartition(partition); };
+    } else if (topology->synapses.isCompact()) {
+        deliverTask = [this](int partition) { deliverCompactPartition(partition); };
+    } else {
+        deliverTask = [this](int partition) { deliverPartition(partition); };
+    }
+    setThreadCount(threads);
+}
+
+template<typename Scalar>
+BasicSNN<Scalar>::~BasicSNN() = default;
+
+template<typename Scalar>
+void BasicSNN<Scalar>::setThreadCount(int threads) {
+    threadPool = std::make_unique<ThreadPool>(threads);
+    const int partitions = threadPool->size();
+
+    // equal shares of neurons, with bounds aligned to 8 neurons to limit false sharing
+    // of v, u and I cache lines between neighbouring partitions
+    partitionBounds.assign(partitions + 1, totalNeuronCount);
+    partitionBounds[0] = 0;
+    for (int p = 1; p < partitions; p++) {
+        int bound = static_cast<int>(static_cast<long long>(totalNeuronCount) * p / partitions);
+        bound = std::min(totalNeuronCount, (bound + 7) / 8 * 8);
+        partitionBounds[p] = std::max(bound, partitionBounds[p - 1]);
+    }
+
+    partitionRuns.assign(partitions, {});
+    for (int p = 0; p < partitions; p++) {
+        const int lo = partitionBounds[p];
+        const int hi = partitionBounds[p + 1];
+        for (const NeuronInfo& run : topology->neuronRuns) {
+            const int start = std::max(lo, run.startIndex);
+            const int end = std::min(hi, run.startIndex + run.count);
+            if (start < end) {
+                partitionRuns[p].push_back({run.typeId, end - start, start});
+            }
+        }
+    }
+    partitionFiredCounts.assign(partitions, 0);
+    partitionFiredStarts.assign(partitions, 0);
+    if (spikeRecorder) {
+        spikeRecorder->setChannelCount(partitions);
+    }
+    if (metrics) {
+        metrics->setPartitionCount(partitions);
+    }
+}
+
+template<typename Scalar>
+void BasicSNN<Scalar>::setInputStream(uint32_t stream) {
+    inputStream = stream;
+    if (inputGenerator) {
+        inputGenerator->setStream(stream);
+    }
+}
+
+template<typename Scalar>
+void BasicSNN<Scalar>::setMetrics(StepMetrics* stepMetrics) {
+    if (stepMetrics) {
+        stepMetrics->setPartitionCount(threadPool->size());
+        stepMetrics->setLoadTimings(topology->loadTimings);
+    }
+    metrics = stepMetrics;
+}
+
+template<typename Scalar>
+void BasicSNN<Scalar>::setSpikeRecorder(SpikeRecorder* recorder) {
+    if (recorder) {
+        if (recorder->getNeuronCount() != totalNeuronCount) {
+            throw std::runtime_error("Rejestrator impulsow utworzono dla innej liczby neuronow niz siec.");
+        }
+        recorder->setChannelCount(threadPool->size());
+    }
+    spikeRecorder = recorder;
+}
+
+template<typename Scalar>
+int BasicSNN<Scalar>::addProbe(const std::string& groupFullName, int interval, size_t capacity) {
+    const GroupInfo* group = findGroupByFullName(topology->rootGroup, groupFullName);
+    if (group == nullptr) {
+        throw std::runtime_error("Nie znaleziono grupy '" + groupFullName + "' dla sondy stanu.");
+    }
+    std::vector<int> neurons(group->totalCount);
+    for (int k = 0; k < group->totalCount; k++) {
+        neurons[k] = group->startIndex + k;
+    }
+    return addProbe(neurons, interval, capacity);
+}
+
+template<typename Scalar>
+int BasicSNN<Scalar>::addProbe(const std::vector<int>& neurons, int interval, size_t capacity) {
+    for (int neuron : neurons) {
+        if (neuron < 0 || neuron >= totalNeuronCount) {
+            throw std::runtime_error("Neuron " + std::to_string(neuron) + " sondy stanu jest poza siecia.");
+        }
+    }
+    probes.push_back(std::make_unique<StateProbe>(neurons, interval, capacity));
+    return static_cast<int>(probes.size()) - 1;
+}
+
+template<typename Scalar>
+int BasicSNN<Scalar>::addInputGroup(const std::string& pattern) {
+    std::vector<NeuronRange> ranges = resolveGroupPattern(topology->rootGroup, pattern);
+    if (ranges.empty()) {
+        throw std::runtime_error("Wzorzec '" + pattern + "' nie pasuje do zadnej grupy neuronow.");
+    }
+    int size = 0;
+    for (const NeuronRange& range : ranges) {
+        size += range.count;
+    }
+    inputGroups.push_back(std::move(ranges));
+    inputGroupSizes.push_back(size);
+    return static_cast<int>(inputGroups.size()) - 1;
+}
+
+template<typename Scalar>
+void BasicSNN<Scalar>::injectCurrent(int neuron, double current) {
+    if (neuron < 0 || neuron >= totalNeuronCount) {
+        throw std::runtime_error("Neuron " + std::to_string(neuron) + " jest poza siecia.");
+    }
+    currentInput()[neuron] += static_cast<Scalar>(current);
+}
+
+template<typename Scalar>
+void BasicSNN<Scalar>::injectGroupCurrent(int groupId, double current) {
+    const Scalar value = static_cast<Scalar>(current);
+    Scalar* input = currentInput();
+    for (const NeuronRange& range : inputGroups[groupId]) {
+        Scalar* destination = input + range.start;
+        for (int k = 0; k < range.count; k++) {
+            destination[k] += value;
+        }
+    }
+}
+
+template<typename Scalar>
+void BasicSNN<Scalar>::injectGroupCurrents(int groupId, const Scalar* currents, size_t count) {
+    if (count != static_cast<size_t>(inputGroupSizes[groupId])) {
+        throw std::runtime_error("Liczba pradow (" + std::to_string(count) + ") nie zgadza sie z rozmiarem grupy wejsciowej (" +
+                                 std::to_string(inputGroupSizes[groupId]) + ").");
+    }
+    Scalar* input = currentInput();
+    for (const NeuronRange& range : inputGroups[groupId]) {
+        Scalar* destination = input + range.start;
+        for (int k = 0; k < range.count; k++) {
+            destination[k] += currents[k];
+        }
+        currents += range.count;
+    }
+}
+
+template<typename T>
+static uint64_t hashVector(const std::vector<T>& values, uint64_t hash) {
+    return fnv1a64(values.data(), values.size() * sizeof(T), hash);
+}
+
+// Hash of the stored synapses, compact or not. The weights of a plastic network are left out,
+// its checkpoints carry the learned ones.
+template<typename Scalar>
+static uint64_t hashSynapses(const BasicSynapseMatrix<Scalar>& synapses, bool withWeights) {
+    const CompactSynapses<Scalar>& compact = synapses.compact;
+    uint64_t hash = fnv1a64(synapses.offsets.data(), synapses.offsets.size() * sizeof(size_t));
+    hash = hashVector(synapses.targets, hash);
+    hash = hashVector(synapses.delays, hash);
+    hash = hashVector(compact.delays8, hash);
+    hash = hashVector(compact.rowSegments, hash);
+    hash = hashVector(compact.segmentStarts, hash);
+    hash = hashVector(compact.segmentBases, hash);
+    hash = hashVector(compact.targetOffsets, hash);
+    if (withWeights) {
+        hash = hashVector(synapses.weights, hash);
+        hash = hashVector(compact.rowScales, hash);
+        hash = hashVector(compact.weights8, hash);
+        hash = hashVector(compact.weights16, hash);
+    }
+    return hash;
+}
+
+// Identifies the network a checkpoint belongs to.
+template<typename Scalar>
+static CheckpointHeader checkpointHeader(const BasicNetworkTopology<Scalar>& topology, uint64_t synapseHash) {
+    CheckpointHeader header = {};
+    std::copy(std::begin(CheckpointWriter::FILE_MAGIC), std::end(CheckpointWriter::FILE_MAGIC), header.magic);
+    header.version = CheckpointWriter::FORMAT_VERSION;
+    header.scalarSize = sizeof(Scalar);
+    header.neuronCount = topology.totalNeuronCount;
+    header.synapseCount = topology.synapses.synapseCount();
+    header.maxDelay = topology.synapses.maxDelay;
+    header.stdpRuleCount = static_cast<uint32_t>(topology.synapses.stdpRules.size());
+    header.seed = topology.simulation.seed;
+    header.synapseHash = synapseHash;
+    return header;
+}
+
+template<typename Scalar>
+void BasicSNN<Scalar>::saveCheckpoint(const std::string& path, bool async) {
+    if (!checkpointWriter) {
+        checkpointWriter = std::make_unique<CheckpointWriter>();
+    }
+    if (synapseHash == 0) {
+        synapseHash = hashSynapses(topology->synapses, !topology->isPlastic());
+    }
+    BinaryBufferWriter& writer = checkpointWriter->buffer();
+    writer.write(checkpointHeader<Scalar>(*topology, synapseHash));
+    writer.write<int64_t>(currentStep);
+    writer.write<double>(time);
+    writer.write<uint32_t>(inputStream);
+    writer.write<int64_t>(firedCount);
+    writer.writeArray(firedNeurons.data(), firedCount);
+    writer.writeVector(v);
+    writer.writeVector(u);
+    writer.writeVector(I);
+    if (topology->isPlastic()) {
+        writer.writeVector(learnedWeights);
+        writer.writeVector(preTraces);
+        writer.writeVector(postTraces);
+        writer.writeVector(lastSpikeTimes);
+    }
+    checkpointWriter->commit(path, async);
+}
+
+template<typename Scalar>
+void BasicSNN<Scalar>::waitForCheckpoint() {
+    if (checkpointWriter) {
+        checkpointWriter->wait();
+    }
+}
+
+// Reads a vector that must have the size of the one it replaces.
+template<typename T>
+static void readCheckpointVector(BinaryReader& reader, std::vector<T>& values, size_t expectedSize) {
+    reader.readVector(values);
+    if (values.size() != expectedSize) {
+        throw std::runtime_error("Nieoczekiwany rozmiar danych w punkcie kontrolnym.");
+    }
+}
+
+template<typename Scalar>
+void BasicSNN<Scalar>::loadCheckpoint(const std::string& path) {
+    MappedFile file(path);
+    BinaryReader reader(file.data(), CheckpointWriter::verify(file.data(), file.size(), path));
+
+    const CheckpointHeader header = reader.read<CheckpointHeader>();
+    if (synapseHash == 0) {
+        synapseHash = hashSynapses(topology->synapses, !topology->isPlastic());
+    }
+    const CheckpointHeader expected = checkpointHeader<Scalar>(*topology, synapseHash);
+    if (!std::equal(std::begin(expected.magic), std::end(expected.magic), header.magic) ||
+        header.version != expected.version || header.scalarSize != expected.scalarSize) {
+        throw std::runtime_error("Plik " + path + " nie jest punktem kontrolnym w obslugiwanej wersji.");
+    }
+    if (header.neuronCount != expected.neuronCount || header.synapseCount != expected.synapseCount ||
+        header.maxDelay != expected.maxDelay || header.stdpRuleCount != expected.stdpRuleCount ||
+        header.seed != expected.seed || header.synapseHash != expected.synapseHash) {
+        throw std::runtime_error("Punkt kontrolny " + path + " pochodzi z innej sieci.");
+    }
+
+    // read everything before touching the state, a failure leaves it unchanged
+    const long long step = reader.read<int64_t>();
+    const double checkpointTime = reader.read<double>();
+    const uint32_t stream = reader.read<uint32_t>();
+    const int64_t count = reader.read<int64_t>();
+    if (count < 0 || count > totalNeuronCount) {
+        throw std::runtime_error("Nieoczekiwany rozmiar danych w punkcie kontrolnym.");
+    }
+    std::vector<int> fired(firedNeurons.size());
+    reader.readArray(fired.data(), static_cast<size_t>(count));
+    std::vector<Scalar> newV, newU, newI, newWeights, newPreTraces, newPostTraces;
+    std::vector<double> newLastSpikeTimes;
+    readCheckpointVector(reader, newV, v.size());
+    readCheckpointVector(reader, newU, u.size());
+    readCheckpointVector(reader, newI, I.size());
+    if (topology->isPlastic()) {
+        readCheckpointVector(reader, newWeights, learnedWeights.size());
+        readCheckpointVector(reader, newPreTraces, preTraces.size());
+        readCheckpointVector(reader, newPostTraces, postTraces.size());
+        readCheckpointVector(reader, newLastSpikeTimes, lastSpikeTimes.size());
+    }
+
+    currentStep = step;
+    time = checkpointTime;
+    setInputStream(stream);
+    firedCount = static_cast<int>(count);
+    firedNeurons.swap(fired);
+    v.swap(newV);
+    u.swap(newU);
+    I.swap(newI);
+    if (topology->isPlastic()) {
+        learnedWeights.swap(newWeights);
+        weights = learnedWeights.data();
+        preTraces.swap(newPreTraces);
+        postTraces.swap(newPostTraces);
+        lastSpikeTimes.swap(newLastSpikeTimes);
+    }
+}
+
+template<typename Scalar>
+int BasicSNN<Scalar>::getThreadCount() const {
+    return threadPool->size();
+}
+
+
+// Timestamp for the metrics, only taken when they are compiled in and attached.
+static StepMetrics::Timestamp metricsTimestamp(const StepMetrics* metrics) {
+    return (SNN_METRICS_COMPILED && metrics) ? StepMetrics::now() : StepMetrics::Timestamp{};
+}
+
+// Adds the time since 'start' to the phase and restarts 'start' for the next phase.
+static void endMetricsPhase(StepMetrics* metrics, StepMetrics::Phase phase, StepMetrics::Timestamp& start) {
+    if (SNN_METRICS_COMPILED && metrics) {
+        const StepMetrics::Timestamp end = StepMetrics::now();
+        metrics->addPhase(phase, start, end);
+        start = end;
+    }
+}
+
+template<typename Scalar>
+void BasicSNN<Scalar>::step(double dt) {
+    const StepMetrics::Timestamp stepStart = metricsTimestamp(metrics);
+    StepMetrics::Timestamp phaseStart = stepStart;
+    stepDt = static_cast<Scalar>(dt);
+    stepInput = currentInput();
+
+    // slots receiving the spikes of this step, by delay
+    const int maxDelay = topology->synapses.maxDelay;
+    for (int d = 1; d <= maxDelay; d++) {
+        delaySlots[d] = I.data() + ((currentStep + d) % maxDelay) * totalNeuronCount;
+    }
+    if (inputGenerator) {
+        inputGenerator->prepare(stepDt); // as the Scalar dt, like PartitionedSNN
+    }
+
+    threadPool->run(integrateTask);
+    endMetricsPhase(metrics, StepMetrics::Integrate, phaseStart);
+
+    if (spikeRecorder) {
+        spikeRecorder->commitStep(currentStep);
+    }
+    for (const auto& probe : probes) {
+        if (probe->isDue(currentStep)) {
+            probe->sample(currentStep, v.data(), u.data());
+        }
+    }
+    endMetricsPhase(metrics, StepMetrics::Record, phaseStart);
+
+    // gather the per-partition fired lists into one compact list
+    firedCount = 0;
+    for (size_t p = 0; p < partitionFiredCounts.size(); p++) {
+        const int* first = firedNeurons.data() + partitionBounds[p];
+        std::copy(first, first + partitionFiredCounts[p], firedNeurons.data() + firedCount);
+        partitionFiredStarts[p] = firedCount;
+        firedCount += partitionFiredCounts[p];
+    }
+    endMetricsPhase(metrics, StepMetrics::GatherSpikes, phaseStart);
+
+    time += dt;
+    threadPool->run(deliverTask);
+    if (topology->isPlastic()) {
+        updateTraces();
+    }
+    endMetricsPhase(metrics, StepMetrics::Deliver, phaseStart);
+
+    currentStep++;
+    if (SNN_METRICS_COMPILED && metrics) {
+        metrics->endStep(stepStart, firedCount);
+    }
+}
+
+template<typename Scalar>
+void BasicSNN<Scalar>::integratePartition(int partition) {
+    StepMetrics::Timestamp phaseStart = metricsTimestamp(metrics);
+    if (inputGenerator) {
+        const int lo = partitionBounds[partition];
+        inputGenerator->addCurrents(currentStep, lo, partitionBounds[partition + 1], stepInput + lo);
+        if (SNN_METRICS_COMPILED && metrics) {
+            const StepMetrics::Timestamp end = StepMetrics::now();
+            metrics->addPartitionPhase(partition, StepMetrics::InputGeneration, phaseStart, end);
+            phaseStart = end;
+        }
+    }
+    // update membrane potentials and recovery variables, one same-type run at a time
+    int* fired = firedNeurons.data() + partitionBounds[partition];
+    int count = 0;
+    for (const NeuronInfo& run : partitionRuns[partition]) {
+        count += integrateKernel(v.data(), u.data(), stepInput, run.startIndex, run.count,
+                                 topology->neuronParamTypes[run.typeId], stepDt, fired + count);
+    }
+    partitionFiredCounts[partition] = count;
+    if (spikeRecorder) {
+        spikeRecorder->record(partition, currentStep, fired, count);
+    }
+    if (SNN_METRICS_COMPILED && metrics) {
+        const StepMetrics::Timestamp end = StepMetrics::now();
+        metrics->addPartitionPhase(partition, StepMetrics::IntegrateKernel, phaseStart, end);
+        phaseStart = end;
+    }
+
+    // this slot has been consumed, it becomes the slot for spikes delayed by maxDelay steps
+    std::fill(stepInput + partitionBounds[partition], stepInput + partitionBounds[partition + 1], Scalar(0));
+    if (SNN_METRICS_COMPILED && metrics) {
+        metrics->addPartitionPhase(partition, StepMetrics::InputReset, phaseStart, StepMetrics::now());
+    }
+}
+
+template<typename Scalar>
+void BasicSNN<Scalar>::deliverPartition(int partition) {
+    // propagate spikes into the slots of the steps they arrive in, restricted to our targets
+    const BasicSynapseMatrix<Scalar>& synapses = topology->synapses;
+    const int lo = partitionBounds[partition];
+    const int hi = partitionBounds[partition + 1];
+    const int* targets = synapses.targets.data();
+    const bool procedural = !synapses.procedural.empty();
+    uint64_t events = 0;
+    for (int f = 0; f < firedCount; f++) {
+        const int neuron = firedNeurons[f];
+        const int* rowBegin = targets + synapses.offsets[neuron];
+        const int* rowEnd = targets + synapses.offsets[neuron + 1];
+        const int* first = lo > 0 ? std::lower_bound(rowBegin, rowEnd, lo) : rowBegin;
+        const int* target = first;
+        for (; target != rowEnd && *target < hi; ++target) {
+            const size_t s = target - targets;
+            delaySlots[synapses.delays[s]][*target] += weights[s];
+        }
+        events += target - first;
+        if (procedural) {
+            events += deliverProcedural(neuron, lo, hi);
+        }
+    }
+    if (SNN_METRICS_COMPILED && metrics) {
+        metrics->addPartitionEvents(partition, events);
+    }
+}
+
+template<typename Scalar>
+void BasicSNN<Scalar>::deliverCompactPartition(int partition) {
+    const BasicSynapseMatrix<Scalar>& synapses = topology->synapses;
+    const int lo = partitionBounds[partition];
+    const int hi = partitionBounds[partition + 1];
+    const bool procedural = !synapses.procedural.empty();
+    uint64_t events = 0;
+    for (int f = 0; f < firedCount; f++) {
+        const int neuron = firedNeurons[f];
+        events += deliverCompactRow(synapses, neuron, lo, hi, delaySlots.data());
+        if (procedural) {
+            events += deliverProcedural(neuron, lo, hi);
+        }
+    }
+    if (SNN_METRICS_COMPILED && metrics) {
+        metrics->addPartitionEvents(partition, events);
+    }
+}
+
+template<typename Scalar>
+uint64_t BasicSNN<Scalar>::deliverProcedural(int neuron, int lo, int hi) {
+    const BasicSynapseMatrix<Scalar>& synapses = topology->synapses;
+    uint64_t events = 0;
+    for (size_t k = synapses.proceduralOffsets[neuron]; k < synapses.proceduralOffsets[neuron + 1]; k++) {
+        const ProceduralProjection& projection = synapses.procedural[synapses.proceduralIndex[k]];
+        Scalar* slot = delaySlots[projection.delay];
+        forEachProceduralSynapse(projection, neuron, lo, hi, [&](int target, double weight) {
+            slot[target] += static_cast<Scalar>(weight);
+            events++;
+        });
+    }
+    return events;
+}
+
+template<typename Scalar>
+void BasicSNN<Scalar>::deliverPlasticPartition(int partition) {
+    // Like deliverPartition, and every synapse touched here has its target in this partition, so
+    // the weight updates never race. Traces are read as they were before this step's spikes.
+    const BasicSynapseMatrix<Scalar>& synapses = topology->synapses;
+    const std::vector<StdpParams>& rules = synapses.stdpRules;
+    const size_t neuronCount = static_cast<size_t>(totalNeuronCount);
+    const int lo = partitionBounds[partition];
+    const int hi = partitionBounds[partition + 1];
+    const int* targets = synapses.targets.data();
+    Scalar* w = learnedWeights.data();
+    const bool procedural = !synapses.procedural.empty();
+    uint64_t events = 0;
+
+    // pre-synaptic spikes: deliver with the current weight, then depress by the post-synaptic trace
+    for (int f = 0; f < firedCount; f++) {
+        const int neuron = firedNeurons[f];
+        const int* rowBegin = targets + synapses.offsets[neuron];
+        const int* rowEnd = targets + synapses.offsets[neuron + 1];
+        const int* first = lo > 0 ? std::lower_bound(rowBegin, rowEnd, lo) : rowBegin;
+        const int* target = first;
+        for (; target != rowEnd && *target < hi; ++target) {
+            const size_t s = target - targets;
+            delaySlots[synapses.delays[s]][*target] += w[s];
+            if (const uint16_t rule = synapses.plasticity[s]) {
+                const StdpParams& params = rules[rule - 1];
+                const double trace = postTraces[(rule - 1) * neuronCount + *target] *
+                                     std::exp((lastSpikeTimes[*target] - time) / params.tauMinus);
+                w[s] = static_cast<Scalar>(std::max(params.wMin, w[s] - params.aMinus * trace));
+            }
+        }
+        events += target - first;
+        if (procedural) {
+            events += deliverProcedural(neuron, lo, hi);
+        }
+    }
+
+    // post-synaptic spikes of this partition: potentiate the incoming synapses by the pre-synaptic trace
+    const int* fired = firedNeurons.data() + partitionFiredStarts[partition];
+    for (int f = 0; f < partitionFiredCounts[partition]; f++) {
+        const int neuron = fired[f];
+        for (size_t k = topology->incomingOffsets[neuron]; k < topology->incomingOffsets[neuron + 1]; k++) {
+            const size_t s = topology->incomingSynapses[k];
+            const int source = topology->incomingSources[k];
+            const uint16_t rule = synapses.plasticity[s];
+            const StdpParams& params = rules[rule - 1];
+            const double trace = preTraces[(rule - 1) * neuronCount + source] *
+                                 std::exp((lastSpikeTimes[source] - time) / params.tauPlus);
+            w[s] = static_cast<Scalar>(std::min(params.wMax, w[s] + params.aPlus * trace));
+        }
+    }
+    if (SNN_METRICS_COMPILED && metrics) {
+        metrics->addPartitionEvents(partition, events);
+    }
+}
+
+template<typename Scalar>
+void BasicSNN<Scalar>::updateTraces() {
+    const std::vector<StdpParams>& rules = topology->synapses.stdpRules;
+    const size_t neuronCount = static_cast<size_t>(totalNeuronCount);
+    for (int f = 0; f < firedCount; f++) {
+        const int neuron = firedNeurons[f];
+        const double elapsed = time - lastSpikeTimes[neuron];
+        for (size_t r = 0; r < rules.size(); r++) {
+            Scalar& pre = preTraces[r * neuronCount + neuron];
+            Scalar& post = postTraces[r * neuronCount + neuron];
+            pre = static_cast<Scalar>(pre * std::exp(-elapsed / rules[r].tauPlus) + 1.0);
+            post = static_cast<Scalar>(post * std::exp(-elapsed / rules[r].tauMinus) + 1.0);
+        }
+        lastSpikeTimes[neuron] = time;
+    }
+}
+
+template struct BasicNetworkTopology<float>;
+template struct BasicNetworkTopology<double>;
+template class BasicSNN<float>;
+template class BasicSNN<double>;
@@ -4,6 +4,18 @@
 #include <vector>
 #include <string>
 #include <unordered_map>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include "WeightGenerator.hpp"
+
+// Scalar type of the default SNN alias, float when built with SNN_SINGLE_PRECISION.
+// Both BasicSNN<float> and BasicSNN<double> are always available.
+#ifdef SNN_SINGLE_PRECISION
+using SNNScalar = float;
+#else
+using SNNScalar = double;
+#endif
 
 struct IzhikevichParams {
     double a, b, c, d;
@@ -26,30 +38,332 @@ struct GroupInfo {
     std::vector<NeuronInfo> neuronInfos; // types and counts of neurons in this group
     int startIndex;        // starting index in the global neuron arrays
     int totalCount;        // total number of neurons in this group (sum of counts in neuronInfos)
+    std::string externalInput; // channel name from 'external_input', empty if the group has none
+    std::string actionOutput;  // channel name from 'action_output', empty if the group has none
+};
+
+// Group with the given full name (e.g. "root.Cortex.Layer1") in the tree under root, nullptr if none.
+const GroupInfo* findGroupByFullName(const GroupInfo& root, const std::string& fullName);
+
+// Contiguous range [start, start + count) of global neuron indices.
+struct NeuronRange {
+    int start;
+    int count;
+};
+
+// Neuron ranges of the groups matching pattern, sorted and with adjacent ranges merged.
+// The pattern is a group path relative to the root, as in the 'from'/'to' fields of the connection
+// rules, including the [i] wildcards (a wildcard used twice must match the same name both times);
+// a leading "root." is accepted as well. Empty if nothing matches.
+std::vector<NeuronRange> resolveGroupPattern(const GroupInfo& root, const std::string& pattern);
+
+// Appends the leaf neuron runs of the tree under group in index order, merging neighbouring runs
+// of the same type, so that the result covers all neurons with as few same-type runs as possible.
+void collectNeuronRuns(const GroupInfo& group, std::vector<NeuronInfo>& runs);
+
+// Pair-based spike-timing-dependent plasticity of the synapses of one connection rule (its
+// 'plasticity' entry). Every spike leaves an exponentially decaying trace; a post-synaptic spike
+// adds aPlus times the pre-synaptic trace to the weight, a pre-synaptic spike subtracts aMinus
+// times the post-synaptic trace. Weights stay within [wMin, wMax]. Times in ms.
+struct StdpParams {
+    double aPlus = 0.01;
+    double aMinus = 0.012;
+    double tauPlus = 20.0;  // time constant of the pre-synaptic trace
+    double tauMinus = 20.0; // time constant of the post-synaptic trace
+    double wMin = 0.0;
+    double wMax = 1.0;
+};
+
+// Synapses of one matched group pair of a rule marked 'procedural'. They are not stored: the row of
+// a source is regenerated from the source's random stream every time it spikes, with the same
+// draws the loader would have used to store it (see ProceduralSynapses.hpp).
+struct ProceduralProjection {
+    bool probabilistic = false; // otherwise all_to_all
+    double probability = 1.0;
+    WeightGenerator weights = WeightGenerator::createFixed(0.0);
+    uint64_t seed = 0;
+    uint32_t ruleIndex = 0;     // together with pairIndex and the source selects the stream
+    uint32_t pairIndex = 0;
+    uint16_t delay = 1;
+    bool excludeSelf = false;
+    std::vector<int> targets;   // candidate targets in ascending order
+};
+
+// Background input of one entry of the 'inputs' section, added to the input current of every
+// neuron of its groups at every step (see InputGenerator.hpp). Noise adds a Gaussian current of
+// the given mean and standard deviation; Poisson adds weight for every spike of 'sources'
+// independent Poisson spike trains of the given rate.
+struct InputSource {
+    enum class Type : uint8_t { Noise, Poisson };
+    Type type = Type::Noise;
+    std::vector<NeuronRange> ranges; // neurons of the groups
+    double mean = 0.0;   // noise, current of one step
+    double stddev = 0.0;
+    double rate = 0.0;   // poisson, spikes per second of one source
+    int sources = 1;
+    double weight = 0.0; // poisson, current of one input spike
+    int interval = 1;    // steps covered by one draw
+};
+
+// Compact storage of the weights and targets of a BasicSynapseMatrix ('weight_format', see
+// CompactSynapses.hpp). Synapse s of row i has the weight weights8[s] * rowScales[i] (or weights16).
+// When targetOffsets is not empty, row i is split into the segments [rowSegments[i], rowSegments[i + 1]),
+// segment k covers the synapses [segmentStarts[k], segmentStarts[k + 1]) and the target of synapse s
+// is segmentBases[k] + targetOffsets[s]; otherwise the targets stay in BasicSynapseMatrix::targets.
+// The delays are moved into delays8 when maxDelay fits in a byte.
+template<typename Scalar>
+struct CompactSynapses {
+    int weightBits = 0; // 8 or 16, 0 when the matrix is not compact
+    std::vector<Scalar> rowScales;
+    std::vector<int8_t> weights8;
+    std::vector<int16_t> weights16;
+    std::vector<uint8_t> delays8;
+    std::vector<size_t> rowSegments;   // totalNeuronCount + 1 entries
+    std::vector<size_t> segmentStarts; // segment count + 1 entries
+    std::vector<int> segmentBases;
+    std::vector<uint16_t> targetOffsets;
+};
+
+// Synapses in compressed sparse row (CSR) layout.
+// Outgoing synapses of neuron i occupy [offsets[i], offsets[i + 1]) in targets/weights/delays,
+// sorted by target index.
+template<typename Scalar>
+struct BasicSynapseMatrix {
+    std::vector<size_t> offsets; // totalNeuronCount + 1 entries
+    std::vector<int> targets;    // empty when compact.targetOffsets is used
+    std::vector<Scalar> weights; // empty when compact.weightBits != 0
+    std::vector<uint16_t> delays; // axonal delay in simulation steps (>= 1), empty when compact.delays8 is used
+    int maxDelay = 1;             // largest value in delays
+
+    // Empty when no rule is plastic. Otherwise stdpRules[plasticity[s] - 1] applies to synapse s,
+    // plasticity[s] == 0 marks a static synapse.
+    std::vector<uint16_t> plasticity;
+    std::vector<StdpParams> stdpRules;
+
+    // Empty when no rule is procedural. Otherwise neuron i is a source of the projections
+    // procedural[proceduralIndex[k]] for k in [proceduralOffsets[i], proceduralOffsets[i + 1]).
+    std::vector<ProceduralProjection> procedural;
+    std::vector<size_t> proceduralOffsets;
+    std::vector<uint32_t> proceduralIndex;
+
+    CompactSynapses<Scalar> compact;
+
+    size_t synapseCount() const { return offsets.empty() ? 0 : offsets.back(); } // stored, not procedural
+    bool isCompact() const { return compact.weightBits != 0; }
+};
+
+using SynapseMatrix = BasicSynapseMatrix<SNNScalar>;
+
+// Runtime options from the optional 'simulation' section of the configuration
+struct SimulationOptions {
+    int threads = 1; // worker threads used by SNN::step and network generation, 0 = one per hardware thread
+    uint64_t seed = 0;    // seed of all random streams, drawn from std::random_device when not configured
+    bool hasSeed = false; // whether the seed came from the configuration
+    int weightBits = 0; // 'weight_format': 0 = full precision, 16 or 8 = quantized (CompactSynapses)
+};
+
+// Wall-clock durations of the phases of a network load from YAML, in seconds.
+// All zero when the network came from NetworkCache.
+struct NetworkLoadTimings {
+    struct Rule {
+        int index;          // position in the 'connections' list
+        std::string from;
+        std::string to;
+        std::string type;   // rule type, e.g. "probabilistic"
+        double seconds;
+        size_t synapses;    // created by the rule, before duplicates are merged
+    };
+    double parseSeconds = 0;      // YAML parsing, neuron types and groups
+    double generationSeconds = 0; // connection rules, including the row sort and duplicate merge
+    double matrixSeconds = 0;     // flattening the rows into the CSR matrix
+    std::vector<Rule> rules;
 };
 
-class SNN {
+template<typename Scalar> struct NetworkConfigData;
+
+// Immutable part of a network: neuron types, groups and synapses. Shared through shared_ptr by any
+// number of simulations (BasicSNN agents, BasicBatchedSNN), each of which keeps its own state.
+template<typename Scalar>
+struct BasicNetworkTopology {
+    std::vector<IzhikevichParams> neuronParamTypes; // indexed by typeId from neuronToTypeId
+    std::unordered_map<std::string, int> neuronTypeToIdMap;
+    int totalNeuronCount = 0;
+    std::vector<int> neuronToTypeId;   // mapping neuron index -> neuron type id
+    std::vector<NeuronInfo> neuronRuns; // contiguous ranges of same-type neurons covering all neurons
+    GroupInfo rootGroup;               // the top-level group of neurons
+    BasicSynapseMatrix<Scalar> synapses;
+    // Transposed index of the plastic synapses, empty when there are none: the plastic synapses onto
+    // neuron i are incomingSynapses[incomingOffsets[i] .. incomingOffsets[i + 1]) (positions in
+    // synapses.targets/weights) coming from incomingSources[...], in ascending source order.
+    std::vector<size_t> incomingOffsets;
+    std::vector<size_t> incomingSynapses;
+    std::vector<int> incomingSources;
+    std::vector<Scalar> initialV;
+    std::vector<Scalar> initialU;
+    std::vector<InputSource> inputs; // from the 'inputs' section
+    SimulationOptions simulation;
+    NetworkLoadTimings loadTimings;
+
+    static std::shared_ptr<const BasicNetworkTopology> create(NetworkConfigData<Scalar>&& config);
+    // create for a single owner that may consume parts of the topology (BasicPartitionedSNN)
+    static std::unique_ptr<BasicNetworkTopology> createUnique(NetworkConfigData<Scalar>&& config);
+    static std::shared_ptr<const BasicNetworkTopology> load(const std::string& filename); // via NetworkTopologyLoader
+
+    bool isPlastic() const { return !synapses.plasticity.empty(); }
+};
+
+using NetworkTopology = BasicNetworkTopology<SNNScalar>;
+
+class ThreadPool;
+class CheckpointWriter;
+class SpikeRecorder;
+class StateProbe;
+class StepMetrics;
+template<typename Scalar> class InputGenerator;
+
+// Simulation core, generic over the scalar type of the neuron state and synaptic weights.
+// Izhikevich dynamics at dt of 0.5-1 ms do not need double precision, float halves the
+// memory traffic and doubles the SIMD width.
+template<typename Scalar>
+class BasicSNN {
 private:
-    // not used after initialization
-    GroupInfo rootGroup; // the top-level group of neurons
+    std::shared_ptr<const BasicNetworkTopology<Scalar>> topology; // groups, neuron types and synapses
 
     // used during simulation
-    std::vector<IzhikevichParams> neuronParamTypes; // Indexed by typeId from neuronToTypeId
     int totalNeuronCount = 0;
-    std::vector<double> v; // Membrane potentials
-    std::vector<double> u; // Recovery variables
-    std::vector<double> I; // Input currents
-    std::vector<int> neuronToTypeId; // mapping neuron index -> neuron type id
+    std::vector<Scalar> v; // Membrane potentials
+    std::vector<Scalar> u; // Recovery variables
+
+    // Input currents as a circular delay buffer: maxDelay slots of totalNeuronCount currents,
+    // slot (currentStep % maxDelay) is the current integrated in the current step.
+    std::vector<Scalar> I;
+    long long currentStep = 0;
+    std::vector<int> firedNeurons; // neurons that spiked in the last step, first firedCount entries are valid
+    int firedCount = 0;
+    std::vector<Scalar*> delaySlots; // delaySlots[d] = slot receiving spikes delayed by d steps
+
+    Scalar* currentInput() { return I.data() + (currentStep % topology->synapses.maxDelay) * totalNeuronCount; }
+    // integration kernel chosen by CPU features, see IzhikevichKernels::IntegrateFn
+    int (*integrateKernel)(Scalar*, Scalar*, const Scalar*, int, int, const IzhikevichParams&, Scalar, int*) = nullptr;
+
+    // Multithreading: the neuron index space is split into one contiguous partition per thread.
+    // A thread integrates the neurons of its partition and then delivers spikes only to targets
+    // inside it (rows are sorted by target), so no two threads ever write the same current.
+    std::unique_ptr<ThreadPool> threadPool;
+    std::vector<int> partitionBounds;                   // partition p is [bounds[p], bounds[p + 1])
+    std::vector<std::vector<NeuronInfo>> partitionRuns; // neuronRuns clipped to each partition
+    std::vector<int> partitionFiredCounts;              // fired neurons of p are written from bounds[p]
+    std::function<void(int)> integrateTask;
+    std::function<void(int)> deliverTask;
+    Scalar stepDt = 0;
+    Scalar* stepInput = nullptr;
+    std::unique_ptr<InputGenerator<Scalar>> inputGenerator; // only when the topology has inputs
+    uint32_t inputStream = 0;
+
+    // STDP, used only when the topology has plastic synapses. The topology is shared, so every
+    // simulation learns on its own copy of the weights. Traces are kept per plasticity rule and
+    // neuron as their value right after the last spike of the neuron and are decayed on read, so a
+    // step costs O(spikes * fan-out + spikes * plastic fan-in) instead of O(synapses).
+    std::vector<Scalar> learnedWeights;
+    const Scalar* weights = nullptr;     // learnedWeights or the weights of the topology
+    std::vector<Scalar> preTraces;       // [rule][neuron], decays with tauPlus
+    std::vector<Scalar> postTraces;      // [rule][neuron], decays with tauMinus
+    std::vector<double> lastSpikeTimes;  // ms
+    double time = 0;                     // simulated ms at the end of the current step
+    std::vector<int> partitionFiredStarts; // first entry of partition p in the gathered fired list
+
+    void integratePartition(int partition);
+    void deliverPartition(int partition);
+    void deliverCompactPartition(int partition); // synapses.compact, dequantized while delivering
+    void deliverPlasticPartition(int partition);
+    uint64_t deliverProcedural(int neuron, int lo, int hi); // returns the delivered synapse events
+    void updateTraces();
 
-    std::vector<std::vector<int>> synapticTargets;
-    std::vector<std::vector<double>> synapticWeights;
+    SpikeRecorder* spikeRecorder = nullptr; // not owned
+    std::vector<std::unique_ptr<StateProbe>> probes;
+    StepMetrics* metrics = nullptr; // not owned
+    std::unique_ptr<CheckpointWriter> checkpointWriter; // created by the first saveCheckpoint
+    uint64_t synapseHash = 0; // identifies the synapses in checkpoints, 0 until first needed
+    std::vector<std::vector<NeuronRange>> inputGroups; // by input group id, see addInputGroup
+    std::vector<int> inputGroupSizes;
 
 public:
     void step(double dt); // Advance the simulation by dt milliseconds
-    explicit SNN(const std::string& filename);
-    SNN(const SNN&) = delete;               // Disable copy constructor
-    SNN& operator=(const SNN&) = delete;    // Disable copy assignment
-    ~SNN() = default;
+    explicit BasicSNN(const std::string& filename);
+    BasicSNN(const std::string& filename, const std::string& cacheFile); // see NetworkCache
+    explicit BasicSNN(NetworkConfigData<Scalar>&& config);
+    // New state on a topology that may be shared with other simulations, threads from its options.
+    explicit BasicSNN(std::shared_ptr<const BasicNetworkTopology<Scalar>> topology);
+    BasicSNN(std::shared_ptr<const BasicNetworkTopology<Scalar>> topology, int threads);
+
+    void setThreadCount(int threads); // 0 = one per hardware thread
+    int getThreadCount() const;
+
+    // Spikes of every following step go to recorder, which must stay alive until detached with nullptr.
+    void setSpikeRecorder(SpikeRecorder* recorder);
+
+    // Per-phase instrumentation of step (needs SNN_METRICS at compile time); nullptr switches it off.
+    // The metrics object must stay alive until detached.
+    void setMetrics(StepMetrics* stepMetrics);
+
+    // Random stream of the 'inputs' section, 0 by default. Simulations of one topology with different
+    // streams receive independent background input. Stored in checkpoints.
+    void setInputStream(uint32_t stream);
+
+    const NetworkLoadTimings& getLoadTimings() const { return topology->loadTimings; }
+
+    // Writes the dynamic state (v, u, the pending input currents, the step counter, the last
+    // spikes, the input stream and, for a plastic network, the weights and traces) to one
+    // checksummed file. With async the state is copied into a buffer and written by a background
+    // thread while stepping continues; waitForCheckpoint reports its errors. Throws std::runtime_error.
+    void saveCheckpoint(const std::string& path, bool async = false);
+    void waitForCheckpoint();
+    // Restores a checkpoint saved by a simulation of the same network; throws std::runtime_error
+    // for a corrupt file or one of another network, leaving the state unchanged.
+    void loadCheckpoint(const std::string& path);
+
+    // Samples v and u of the neurons every interval steps into a ring of capacity samples.
+    // Returns the probe id for getProbe; throws std::runtime_error for an unknown group or neuron.
+    int addProbe(const std::string& groupFullName, int interval, size_t capacity);
+    int addProbe(const std::vector<int>& neurons, int interval, size_t capacity);
+    const StateProbe& getProbe(int probeId) const { return *probes[probeId]; }
+    StateProbe& getProbe(int probeId) { return *probes[probeId]; }
+    int getProbeCount() const { return static_cast<int>(probes.size()); }
+
+    // External input current. Group patterns are resolved once into neuron ranges (see
+    // resolveGroupPattern), so injecting into a group costs O(group size) with no name lookups.
+    // Currents are added to the input of the next step and are consumed by it.
+    int addInputGroup(const std::string& pattern); // throws std::runtime_error if no group matches
+    int getInputGroupSize(int groupId) const { return inputGroupSizes[groupId]; }
+    const std::vector<NeuronRange>& getInputGroupRanges(int groupId) const { return inputGroups[groupId]; }
+    void injectCurrent(int neuron, double current);
+    void injectGroupCurrent(int groupId, double current); // the same current into every neuron of the group
+    // currents[k] into the k-th neuron of the group (ranges in ascending order), count must equal the group size
+    void injectGroupCurrents(int groupId, const Scalar* currents, size_t count);
+
+    // Current synaptic weights in the order of getTopology()->synapses, changed by STDP if the network is plastic.
+    // nullptr when the weights are compact (synapses.compact).
+    const Scalar* getWeights() const { return weights; }
+
+    const GroupInfo& getRootGroup() const { return topology->rootGroup; }
+    const std::shared_ptr<const BasicNetworkTopology<Scalar>>& getTopology() const { return topology; }
+    int getNeuronCount() const { return totalNeuronCount; }
+    const int* getFiredNeurons() const { return firedNeurons.data(); }
+    int getFiredCount() const { return firedCount; }
+    long long getCurrentStep() const { return currentStep; }
+    BasicSNN(const BasicSNN&) = delete;               // Disable copy constructor
+    BasicSNN& operator=(const BasicSNN&) = delete;    // Disable copy assignment
+    ~BasicSNN();
 };
 
+// explicitly instantiated in SNN.cpp
+extern template struct BasicNetworkTopology<float>;
+extern template struct BasicNetworkTopology<double>;
+extern template class BasicSNN<float>;
+extern template class BasicSNN<double>;
+
+using SNN = BasicSNN<SNNScalar>;
+using SNNFloat = BasicSNN<float>;
+using SNNDouble = BasicSNN<double>;
+
 #endif // SNN_CORE_HPP
\ No newline at end of file
@@ -1,11 +1,64 @@
 #include "SNN.hpp"
+#include "MouseRunner.hpp"
+#include "MultiMouseRunner.hpp"
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
 #include "SNNParseException.hpp"
 
-int main() {
+// Usage: snn_simulator [config.yaml] [simulated seconds] [--fast]
+// Runs the network in closed loop with the mouse environment and prints the timing as JSON.
+// --fast runs the steps back to back instead of pacing them to the wall clock.
+int main(int argc, char** argv) {
+    std::string configPath = "../../data/SNNConfig.yaml";
+    double seconds = 10.0;
+    bool fast = false;
+    int positional = 0;
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--fast") == 0) {
+            fast = true;
+        } else if (positional == 0) {
+            configPath = argv[i];
+            positional++;
+        } else {
+            seconds = std::atof(argv[i]);
+        }
+    }
+
     try
     {
-        SNN snn("../../data/SNNConfig.yaml");
+        auto topology = NetworkTopology::load(configPath);
+        MouseRunnerConfig config = MouseRunnerConfig::loadFromYaml(configPath);
+        if (fast) {
+            config.realTime = false;
+        }
+        SchedulerStats stats;
+        if (config.agents > 1) {
+            // every agent single-threaded, the 'threads' option is the number of threads running agents
+            MultiMouseRunner runner(topology, config, config.agents, topology->simulation.threads);
+            stats = runner.run(seconds);
+            const MouseEnvironment& environment = runner.getEnvironment();
+            std::cout << "{\"scheduler\":" << stats.toJson()
+                      << ",\"agents\":" << runner.getAgentCount()
+                      << ",\"threads\":" << runner.getThreadCount()
+                      << ",\"agent_steps_per_second\":" << (stats.wallSeconds > 0 ? stats.ticks * runner.getAgentCount() / stats.wallSeconds : 0)
+                      << ",\"food_eaten\":" << environment.getTotalFoodEaten() << "}\n";
+        } else {
+            SNN snn(topology);
+            MouseRunner runner(snn, config);
+            stats = runner.run(seconds);
+            const MouseEnvironment& environment = runner.getEnvironment();
+            std::cout << "{\"scheduler\":" << stats.toJson()
+                      << ",\"mouse\":{\"x\":" << environment.getX()
+                      << ",\"y\":" << environment.getY()
+                      << ",\"distance\":" << environment.getDistanceTravelled()
+                      << ",\"food_eaten\":" << environment.getFoodEaten()
+                      << ",\"wall_contacts\":" << environment.getWallContacts() << "}}\n";
+        }
+        if (stats.p99Latency > config.dt * 1000.0) {
+            std::cerr << "Siec nie nadaza za czasem rzeczywistym: 1% krokow trwa co najmniej " << stats.p99Latency
+                      << " us, dluzej niz okres " << config.dt * 1000.0 << " us.\n";
+        }
     }
     catch (const SNNParseException& e) {
         std::cerr << "--- BLAD KONFIGURACJI MODELU ---\n";
@@ -20,6 +73,6 @@ int main() {
         std::cerr << "-------------------------------\n";
         return EXIT_FAILURE;
     }
-    
+
     return 0;
-}
\ No newline at end of file
+}
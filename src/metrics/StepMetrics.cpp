@@ -0,0 +1,270 @@
+#include "StepMetrics.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+
+static uint64_t elapsedNanoseconds(const StepMetrics::Timestamp& start, const StepMetrics::Timestamp& end) {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(end.time - start.time).count());
+}
+
+void StepMetrics::setPartitionCount(int partitionCount) {
+    std::lock_guard<std::mutex> lock(mutex);
+    // keep the totals of the partitions being replaced
+    for (const auto& partition : partitions) {
+        for (int phase = 0; phase < PartitionPhaseCount; phase++) {
+            partitionNanoseconds[phase].add(partition->nanoseconds[phase].get());
+            partitionCycles[phase].add(partition->cycles[phase].get());
+        }
+    }
+    partitions.clear();
+    for (int p = 0; p < partitionCount; p++) {
+        partitions.push_back(std::make_unique<PartitionCounters>());
+    }
+}
+
+void StepMetrics::addPhase(Phase phase, const Timestamp& start, const Timestamp& end) {
+    phaseNanoseconds[phase].add(elapsedNanoseconds(start, end));
+    phaseCycles[phase].add(end.cycles - start.cycles);
+}
+
+void StepMetrics::addPartitionPhase(int partition, PartitionPhase phase, const Timestamp& start, const Timestamp& end) {
+    partitions[partition]->nanoseconds[phase].add(elapsedNanoseconds(start, end));
+    partitions[partition]->cycles[phase].add(end.cycles - start.cycles);
+}
+
+void StepMetrics::addPartitionEvents(int partition, uint64_t events) {
+    partitions[partition]->synapticEvents.set(events);
+}
+
+void StepMetrics::endStep(const Timestamp& stepStart, int stepSpikes) {
+    uint64_t stepEvents = 0;
+    for (const auto& partition : partitions) {
+        stepEvents += partition->synapticEvents.get();
+    }
+    const uint64_t nanoseconds = elapsedNanoseconds(stepStart, now());
+    steps.add(1);
+    spikes.add(stepSpikes);
+    synapticEvents.add(stepEvents);
+    lastStepSpikes.set(stepSpikes);
+    lastStepSynapticEvents.set(stepEvents);
+    stepNanoseconds.add(nanoseconds);
+    maxStepNanoseconds.set(std::max(maxStepNanoseconds.get(), nanoseconds));
+}
+
+void StepMetrics::setLoadTimings(const NetworkLoadTimings& timings) {
+    std::lock_guard<std::mutex> lock(mutex);
+    load = timings;
+}
+
+StepMetrics::Snapshot StepMetrics::snapshot() const {
+    Snapshot result;
+    result.steps = steps.get();
+    result.spikes = spikes.get();
+    result.synapticEvents = synapticEvents.get();
+    result.lastStepSpikes = lastStepSpikes.get();
+    result.lastStepSynapticEvents = lastStepSynapticEvents.get();
+    result.stepSeconds = stepNanoseconds.get() * 1e-9;
+    result.maxStepSeconds = maxStepNanoseconds.get() * 1e-9;
+    for (int phase = 0; phase < StepPhaseCount; phase++) {
+        result.phaseSeconds[phase] = phaseNanoseconds[phase].get() * 1e-9;
+        result.phaseCycles[phase] = phaseCycles[phase].get();
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    for (int phase = 0; phase < PartitionPhaseCount; phase++) {
+        uint64_t nanoseconds = partitionNanoseconds[phase].get();
+        uint64_t cycles = partitionCycles[phase].get();
+        for (const auto& partition : partitions) {
+            nanoseconds += partition->nanoseconds[phase].get();
+            cycles += partition->cycles[phase].get();
+        }
+        result.partitionPhaseSeconds[phase] = nanoseconds * 1e-9;
+        result.partitionPhaseCycles[phase] = cycles;
+    }
+    result.load = load;
+    return result;
+}
+
+const char* StepMetrics::phaseName(Phase phase) {
+    switch (phase) {
+        case Integrate: return "integrate";
+        case GatherSpikes: return "gather_spikes";
+        case Deliver: return "deliver";
+        case Record: return "record";
+        default: return "unknown";
+    }
+}
+
+const char* StepMetrics::partitionPhaseName(PartitionPhase phase) {
+    switch (phase) {
+        case IntegrateKernel: return "integrate_kernel";
+        case InputReset: return "input_reset";
+        case InputGeneration: return "input_generation";
+        default: return "unknown";
+    }
+}
+
+static std::string escaped(const std::string& text) {
+    std::string result;
+    for (char c : text) {
+        if (c == '"' || c == '\\') {
+            result += '\\';
+        }
+        result += c;
+    }
+    return result;
+}
+
+std::string StepMetrics::toJson(const Snapshot& snapshot) {
+    std::ostringstream json;
+    json.precision(9);
+    json << "{\n"
+         << "  \"steps\": " << snapshot.steps << ",\n"
+         << "  \"spikes\": " << snapshot.spikes << ",\n"
+         << "  \"synaptic_events\": " << snapshot.synapticEvents << ",\n"
+         << "  \"last_step_spikes\": " << snapshot.lastStepSpikes << ",\n"
+         << "  \"last_step_synaptic_events\": " << snapshot.lastStepSynapticEvents << ",\n"
+         << "  \"step_seconds\": " << snapshot.stepSeconds << ",\n"
+         << "  \"max_step_seconds\": " << snapshot.maxStepSeconds << ",\n"
+         << "  \"phases\": {";
+    for (int phase = 0; phase < StepPhaseCount; phase++) {
+        json << (phase == 0 ? "\n" : ",\n") << "    \"" << phaseName(static_cast<Phase>(phase)) << "\": {\"seconds\": "
+             << snapshot.phaseSeconds[phase] << ", \"cycles\": " << snapshot.phaseCycles[phase] << "}";
+    }
+    json << "\n  },\n  \"partition_phases\": {";
+    for (int phase = 0; phase < PartitionPhaseCount; phase++) {
+        json << (phase == 0 ? "\n" : ",\n") << "    \"" << partitionPhaseName(static_cast<PartitionPhase>(phase))
+             << "\": {\"thread_seconds\": " << snapshot.partitionPhaseSeconds[phase]
+             << ", \"cycles\": " << snapshot.partitionPhaseCycles[phase] << "}";
+    }
+    json << "\n  },\n  \"load\": {\n"
+         << "    \"parse_seconds\": " << snapshot.load.parseSeconds << ",\n"
+         << "    \"generation_seconds\": " << snapshot.load.generationSeconds << ",\n"
+         << "    \"matrix_seconds\": " << snapshot.load.matrixSeconds << ",\n"
+         << "    \"rules\": [";
+    for (size_t r = 0; r < snapshot.load.rules.size(); r++) {
+        const NetworkLoadTimings::Rule& rule = snapshot.load.rules[r];
+        json << (r == 0 ? "\n" : ",\n") << "      {\"index\": " << rule.index << ", \"from\": \"" << escaped(rule.from)
+             << "\", \"to\": \"" << escaped(rule.to) << "\", \"type\": \"" << escaped(rule.type)
+             << "\", \"seconds\": " << rule.seconds << ", \"synapses\": " << rule.synapses << "}";
+    }
+    json << "\n    ]\n  }\n}\n";
+    return json.str();
+}
+
+std::string StepMetrics::toPrometheus(const Snapshot& snapshot) {
+    std::ostringstream text;
+    text.precision(9);
+    auto metric = [&text](const char* name, const char* type, const char* help) {
+        text << "# HELP " << name << " " << help << "\n# TYPE " << name << " " << type << "\n";
+    };
+    metric("snn_steps_total", "counter", "Simulation steps.");
+    text << "snn_steps_total " << snapshot.steps << "\n";
+    metric("snn_spikes_total", "counter", "Spikes emitted.");
+    text << "snn_spikes_total " << snapshot.spikes << "\n";
+    metric("snn_synaptic_events_total", "counter", "Synapses activated by spikes.");
+    text << "snn_synaptic_events_total " << snapshot.synapticEvents << "\n";
+    metric("snn_last_step_spikes", "gauge", "Spikes in the last step.");
+    text << "snn_last_step_spikes " << snapshot.lastStepSpikes << "\n";
+    metric("snn_last_step_synaptic_events", "gauge", "Synapses activated in the last step.");
+    text << "snn_last_step_synaptic_events " << snapshot.lastStepSynapticEvents << "\n";
+    metric("snn_step_seconds_total", "counter", "Wall time spent in SNN::step.");
+    text << "snn_step_seconds_total " << snapshot.stepSeconds << "\n";
+    metric("snn_step_seconds_max", "gauge", "Longest single step.");
+    text << "snn_step_seconds_max " << snapshot.maxStepSeconds << "\n";
+
+    metric("snn_phase_seconds_total", "counter", "Wall time per phase of SNN::step.");
+    for (int phase = 0; phase < StepPhaseCount; phase++) {
+        text << "snn_phase_seconds_total{phase=\"" << phaseName(static_cast<Phase>(phase)) << "\"} " << snapshot.phaseSeconds[phase] << "\n";
+    }
+    metric("snn_phase_cycles_total", "counter", "CPU cycles per phase of SNN::step.");
+    for (int phase = 0; phase < StepPhaseCount; phase++) {
+        text << "snn_phase_cycles_total{phase=\"" << phaseName(static_cast<Phase>(phase)) << "\"} " << snapshot.phaseCycles[phase] << "\n";
+    }
+    metric("snn_partition_phase_seconds_total", "counter", "Thread time per partition phase, summed over threads.");
+    for (int phase = 0; phase < PartitionPhaseCount; phase++) {
+        text << "snn_partition_phase_seconds_total{phase=\"" << partitionPhaseName(static_cast<PartitionPhase>(phase)) << "\"} "
+             << snapshot.partitionPhaseSeconds[phase] << "\n";
+    }
+    metric("snn_partition_phase_cycles_total", "counter", "CPU cycles per partition phase, summed over threads.");
+    for (int phase = 0; phase < PartitionPhaseCount; phase++) {
+        text << "snn_partition_phase_cycles_total{phase=\"" << partitionPhaseName(static_cast<PartitionPhase>(phase)) << "\"} "
+             << snapshot.partitionPhaseCycles[phase] << "\n";
+    }
+
+    metric("snn_load_phase_seconds", "gauge", "Duration of the network load phases.");
+    text << "snn_load_phase_seconds{phase=\"parse\"} " << snapshot.load.parseSeconds << "\n"
+         << "snn_load_phase_seconds{phase=\"generation\"} " << snapshot.load.generationSeconds << "\n"
+         << "snn_load_phase_seconds{phase=\"matrix\"} " << snapshot.load.matrixSeconds << "\n";
+    metric("snn_load_rule_seconds", "gauge", "Generation time per connection rule.");
+    for (const NetworkLoadTimings::Rule& rule : snapshot.load.rules) {
+        text << "snn_load_rule_seconds{rule=\"" << rule.index << "\",from=\"" << escaped(rule.from) << "\",to=\"" << escaped(rule.to)
+             << "\",type=\"" << escaped(rule.type) << "\"} " << rule.seconds << "\n";
+    }
+    metric("snn_load_rule_synapses", "gauge", "Synapses created per connection rule.");
+    for (const NetworkLoadTimings::Rule& rule : snapshot.load.rules) {
+        text << "snn_load_rule_synapses{rule=\"" << rule.index << "\",from=\"" << escaped(rule.from) << "\",to=\"" << escaped(rule.to)
+             << "\",type=\"" << escaped(rule.type) << "\"} " << rule.synapses << "\n";
+    }
+    return text.str();
+}
+
+MetricsExporter::MetricsExporter(const StepMetrics& metrics, const std::string& path, Format format, int intervalMs)
+    : metrics(metrics), path(path), format(format), intervalMs(std::max(1, intervalMs)) {
+    thread = std::thread(&MetricsExporter::run, this);
+}
+
+MetricsExporter::~MetricsExporter() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    thread.join();
+    try {
+        flush();
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Blad zapisu metryk: " << e.what() << "\n";
+    }
+}
+
+void MetricsExporter::flush() {
+    const StepMetrics::Snapshot snapshot = metrics.snapshot();
+    const std::string content = format == Json ? StepMetrics::toJson(snapshot) : StepMetrics::toPrometheus(snapshot);
+    // write to a temporary file first so that a reader never sees a partially written one
+    const std::string tempPath = path + ".tmp";
+    {
+        std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+        out << content;
+        if (!out) {
+            throw std::runtime_error("Nie mozna zapisac pliku " + tempPath);
+        }
+    }
+#ifdef _WIN32
+    std::remove(path.c_str()); // rename does not replace an existing file on Windows
+#endif
+    if (std::rename(tempPath.c_str(), path.c_str()) != 0) {
+        throw std::runtime_error("Nie mozna zapisac pliku " + path);
+    }
+}
+
+void MetricsExporter::run() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (!stopping) {
+        if (wake.wait_for(lock, std::chrono::milliseconds(intervalMs), [this] { return stopping; })) {
+            break;
+        }
+        lock.unlock();
+        try {
+            flush();
+        }
+        catch (const std::exception& e) {
+            std::cerr << "Blad zapisu metryk: " << e.what() << "\n";
+        }
+        lock.lock();
+    }
+}
@@ -0,0 +1,153 @@
+#ifndef STEP_METRICS_HPP
+#define STEP_METRICS_HPP
+
+#include "SNN.hpp"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+// Instrumentation is compiled in when SNN_METRICS is defined (CMake option SNN_ENABLE_METRICS)
+// and is active only while a StepMetrics object is attached with BasicSNN::setMetrics.
+#ifdef SNN_METRICS
+constexpr bool SNN_METRICS_COMPILED = true;
+#else
+constexpr bool SNN_METRICS_COMPILED = false;
+#endif
+
+/**
+ * @brief Per-phase counters of BasicSNN::step, plus the load timings of the network.
+ *
+ * Step-level phases are wall time measured on the calling thread; the partition phases are
+ * measured on every worker thread and summed (thread time). Counters are only ever written by
+ * the simulation and are read with relaxed atomics, so a MetricsExporter can snapshot them at
+ * any time without stopping the simulation.
+ */
+class StepMetrics {
+public:
+    enum Phase {
+        Integrate,     // integration task, wall time (includes spike detection, the input reset and the inputs)
+        GatherSpikes,  // compaction of the per-partition fired lists
+        Deliver,       // fan-out of the spikes into the delay slots, wall time
+        Record,        // spike recorder and state probes
+        StepPhaseCount
+    };
+    enum PartitionPhase {
+        IntegrateKernel, // Izhikevich update and threshold test of the partition's neurons
+        InputReset,      // zeroing the consumed input slot of the partition
+        InputGeneration, // noise and Poisson input of the 'inputs' section (InputGenerator)
+        PartitionPhaseCount
+    };
+
+    struct Timestamp {
+        uint64_t cycles;
+        std::chrono::steady_clock::time_point time;
+    };
+
+    // cycle counter of the CPU (TSC on x86), 0 where not available
+    static uint64_t readCycleCounter() {
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+        return __rdtsc();
+#elif defined(__x86_64__) || defined(__i386__)
+        return __rdtsc();
+#else
+        return 0;
+#endif
+    }
+    static Timestamp now() { return {readCycleCounter(), std::chrono::steady_clock::now()}; }
+
+    // called by BasicSNN
+    void setPartitionCount(int partitions);
+    void addPhase(Phase phase, const Timestamp& start, const Timestamp& end);
+    void addPartitionPhase(int partition, PartitionPhase phase, const Timestamp& start, const Timestamp& end);
+    void addPartitionEvents(int partition, uint64_t synapticEvents);
+    void endStep(const Timestamp& stepStart, int spikes);
+    void setLoadTimings(const NetworkLoadTimings& timings);
+
+    struct Snapshot {
+        uint64_t steps = 0;
+        uint64_t spikes = 0;
+        uint64_t synapticEvents = 0;
+        uint64_t lastStepSpikes = 0;
+        uint64_t lastStepSynapticEvents = 0;
+        double stepSeconds = 0;
+        double maxStepSeconds = 0;
+        double phaseSeconds[StepPhaseCount] = {};
+        uint64_t phaseCycles[StepPhaseCount] = {};
+        double partitionPhaseSeconds[PartitionPhaseCount] = {};
+        uint64_t partitionPhaseCycles[PartitionPhaseCount] = {};
+        NetworkLoadTimings load;
+    };
+    Snapshot snapshot() const;
+
+    static std::string toJson(const Snapshot& snapshot);
+    static std::string toPrometheus(const Snapshot& snapshot);
+    static const char* phaseName(Phase phase);
+    static const char* partitionPhaseName(PartitionPhase phase);
+
+private:
+    // relaxed single-writer counter, read concurrently by the exporter
+    struct Counter {
+        std::atomic<uint64_t> value{0};
+        void add(uint64_t amount) { value.store(value.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed); }
+        void set(uint64_t amount) { value.store(amount, std::memory_order_relaxed); }
+        uint64_t get() const { return value.load(std::memory_order_relaxed); }
+    };
+    struct alignas(64) PartitionCounters {
+        Counter nanoseconds[PartitionPhaseCount];
+        Counter cycles[PartitionPhaseCount];
+        Counter synapticEvents; // of the current step, collected by endStep
+    };
+
+    Counter steps, spikes, synapticEvents, lastStepSpikes, lastStepSynapticEvents;
+    Counter stepNanoseconds, maxStepNanoseconds;
+    Counter phaseNanoseconds[StepPhaseCount];
+    Counter phaseCycles[StepPhaseCount];
+    Counter partitionNanoseconds[PartitionPhaseCount]; // of partitions replaced by setPartitionCount
+    Counter partitionCycles[PartitionPhaseCount];
+    std::vector<std::unique_ptr<PartitionCounters>> partitions;
+
+    mutable std::mutex mutex; // guards partitions and load against setPartitionCount and setLoadTimings
+    NetworkLoadTimings load;
+};
+
+/**
+ * @brief Periodically writes a StepMetrics snapshot to a file (JSON or Prometheus text format)
+ * from a background thread. The file is replaced atomically, so a scraper never sees a partial one.
+ */
+class MetricsExporter {
+public:
+    enum Format { Json, Prometheus };
+
+    MetricsExporter(const StepMetrics& metrics, const std::string& path, Format format, int intervalMs = 1000);
+    MetricsExporter(const MetricsExporter&) = delete;
+    MetricsExporter& operator=(const MetricsExporter&) = delete;
+    ~MetricsExporter(); // stops the thread and writes the file a last time
+
+    void flush(); // writes the file now, throws std::runtime_error on failure
+
+private:
+    const StepMetrics& metrics;
+    std::string path;
+    Format format;
+    int intervalMs;
+    std::thread thread;
+    std::mutex mutex;
+    std::condition_variable wake;
+    bool stopping = false;
+
+    void run();
+};
+
+#endif // STEP_METRICS_HPP
@@ -0,0 +1,79 @@
+#include "Checkpoint.hpp"
+#include "FileReplace.hpp"
+#include "Hash.hpp"
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+const char CheckpointWriter::FILE_MAGIC[8] = {'S', 'N', 'N', 'C', 'K', 'P', 'T', '\0'};
+
+CheckpointWriter::~CheckpointWriter() {
+    if (writer.joinable()) {
+        writer.join();
+    }
+}
+
+BinaryBufferWriter& CheckpointWriter::buffer() {
+    buffers[current].clear();
+    return buffers[current];
+}
+
+void CheckpointWriter::commit(const std::string& path, bool async) {
+    wait(); // the other buffer is free only once its write has finished, and it may target the same file
+    if (!async) {
+        writeFile(path, buffers[current].data());
+        return;
+    }
+    const std::vector<char>& image = buffers[current].data();
+    writer = std::thread([this, path, &image]() {
+        try {
+            writeFile(path, image);
+        }
+        catch (...) {
+            writeError = std::current_exception();
+        }
+    });
+    current = 1 - current;
+}
+
+void CheckpointWriter::wait() {
+    if (writer.joinable()) {
+        writer.join();
+    }
+    if (writeError) {
+        std::exception_ptr error = writeError;
+        writeError = nullptr;
+        std::rethrow_exception(error);
+    }
+}
+
+void CheckpointWriter::writeFile(const std::string& path, const std::vector<char>& image) {
+    const uint64_t checksum = fnv1a64(image.data(), image.size());
+    const std::string tempPath = path + ".tmp";
+    {
+        std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+        if (!out) {
+            throw std::runtime_error("Nie mozna otworzyc pliku do zapisu: " + tempPath);
+        }
+        out.write(image.data(), static_cast<std::streamsize>(image.size()));
+        out.write(reinterpret_cast<const char*>(&checksum), sizeof(checksum));
+        out.flush();
+        if (!out) {
+            throw std::runtime_error("Blad zapisu punktu kontrolnego " + tempPath);
+        }
+    }
+    replaceFile(tempPath, path);
+}
+
+size_t CheckpointWriter::verify(const void* data, size_t size, const std::string& path) {
+    uint64_t stored;
+    if (size < sizeof(CheckpointHeader) + sizeof(stored)) {
+        throw std::runtime_error("Plik " + path + " nie jest punktem kontrolnym.");
+    }
+    const size_t imageSize = size - sizeof(stored);
+    std::memcpy(&stored, static_cast<const char*>(data) + imageSize, sizeof(stored));
+    if (fnv1a64(data, imageSize) != stored) {
+        throw std::runtime_error("Punkt kontrolny " + path + " jest uszkodzony (niezgodna suma kontrolna).");
+    }
+    return imageSize;
+}
@@ -0,0 +1,70 @@
+#ifndef CHECKPOINT_HPP
+#define CHECKPOINT_HPP
+
+#include "BinaryIO.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <string>
+#include <thread>
+#include <vector>
+
+/*
+ * Checkpoint file (.ckpt) layout, native byte order:
+ *   CheckpointHeader, then the simulation state as written by BasicSNN::saveCheckpoint
+ *   uint64 FNV-1a checksum of everything before it
+ * The header describes the network the state belongs to; a checkpoint is restored only into a
+ * simulation of the same network.
+ */
+struct CheckpointHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t scalarSize;
+    int64_t neuronCount;
+    uint64_t synapseCount;
+    int32_t maxDelay;
+    uint32_t stdpRuleCount;
+    uint64_t seed;        // simulation.seed, also of the procedural synapses and the inputs
+    uint64_t synapseHash; // of the stored synapses, their weights only when none is plastic
+};
+
+/**
+ * @brief Writes checkpoint images, optionally on a background thread, with two buffers.
+ *
+ * The caller serializes the state into buffer() and hands it over with commit(). An asynchronous
+ * commit swaps the buffers and returns at once, so the next checkpoint is assembled while the
+ * previous one is being checksummed and written; commit() only waits if that write is still
+ * running. Files are written to a temporary name and moved over the old one (replaceFile), so a
+ * crash or a power loss leaves either the old or the new checkpoint, never none or a truncated one.
+ */
+class CheckpointWriter {
+public:
+    static constexpr uint32_t FORMAT_VERSION = 4;
+    static const char FILE_MAGIC[8];
+
+    CheckpointWriter() = default;
+    CheckpointWriter(const CheckpointWriter&) = delete;
+    CheckpointWriter& operator=(const CheckpointWriter&) = delete;
+    ~CheckpointWriter(); // waits for the background write, errors are dropped
+
+    // Cleared buffer for the next image, never the one a background write is reading.
+    BinaryBufferWriter& buffer();
+    // Writes the image in buffer() to path. Throws std::runtime_error on failure when not async.
+    void commit(const std::string& path, bool async);
+    // Waits for the background write and rethrows its error, if any.
+    void wait();
+    bool isWriting() const { return writer.joinable(); }
+
+    // Checks the trailing checksum; returns the size of the image without it. Throws std::runtime_error.
+    static size_t verify(const void* data, size_t size, const std::string& path);
+
+private:
+    BinaryBufferWriter buffers[2];
+    int current = 0; // buffer being filled, the other one may be written in the background
+    std::thread writer;
+    std::exception_ptr writeError;
+
+    static void writeFile(const std::string& path, const std::vector<char>& image);
+};
+
+#endif // CHECKPOINT_HPP
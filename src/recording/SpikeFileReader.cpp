@@ -0,0 +1,78 @@
+#include "SpikeFileReader.hpp"
+#include "BinaryIO.hpp"
+#include "Varint.hpp"
+#include <algorithm>
+#include <stdexcept>
+
+SpikeFileReader::SpikeFileReader(const std::string& path) : file(path) {
+    const uint8_t* bytes = static_cast<const uint8_t*>(file.data());
+    if (file.size() < sizeof(SpikeFileHeader) + sizeof(SpikeFileTrailer)) {
+        throw std::runtime_error("Plik " + path + " nie jest plikiem impulsow.");
+    }
+    BinaryReader reader(bytes, file.size());
+    const SpikeFileHeader header = reader.read<SpikeFileHeader>();
+    if (!std::equal(std::begin(header.magic), std::end(header.magic), SpikeRecorder::FILE_MAGIC) ||
+        header.version != SpikeRecorder::FORMAT_VERSION) {
+        throw std::runtime_error("Plik " + path + " nie jest plikiem impulsow w obslugiwanej wersji.");
+    }
+    neuronCount = header.neuronCount;
+    for (uint32_t r = 0; r < header.recordedRangeCount; r++) {
+        const int start = reader.read<int32_t>();
+        const int count = reader.read<int32_t>();
+        recordedRanges.emplace_back(start, count);
+    }
+
+    // the trailer is only written when the recording was closed properly
+    BinaryReader trailerReader(bytes + file.size() - sizeof(SpikeFileTrailer), sizeof(SpikeFileTrailer));
+    const SpikeFileTrailer trailer = trailerReader.read<SpikeFileTrailer>();
+    if (!std::equal(std::begin(trailer.magic), std::end(trailer.magic), SpikeRecorder::FILE_MAGIC) ||
+        trailer.indexOffset > file.size() ||
+        trailer.chunkCount > (file.size() - trailer.indexOffset) / sizeof(SpikeChunkIndexEntry)) {
+        throw std::runtime_error("Plik impulsow " + path + " nie ma indeksu (nagranie nie zostalo zamkniete).");
+    }
+    BinaryReader indexReader(bytes + trailer.indexOffset, file.size() - trailer.indexOffset);
+    index.resize(trailer.chunkCount);
+    for (SpikeChunkIndexEntry& entry : index) {
+        entry = indexReader.read<SpikeChunkIndexEntry>();
+        if (entry.offset > trailer.indexOffset || entry.size > trailer.indexOffset - entry.offset) {
+            throw std::runtime_error("Uszkodzony indeks pliku impulsow " + path);
+        }
+    }
+}
+
+unsigned long long SpikeFileReader::getEventCount() const {
+    unsigned long long events = 0;
+    for (const SpikeChunkIndexEntry& entry : index) {
+        events += entry.eventCount;
+    }
+    return events;
+}
+
+std::vector<SpikeEvent> SpikeFileReader::readWindow(long long fromStep, long long toStep) const {
+    std::vector<SpikeEvent> events;
+    const uint8_t* bytes = static_cast<const uint8_t*>(file.data());
+    // chunks are written in step order, skip the ones ending before the window
+    auto first = std::lower_bound(index.begin(), index.end(), fromStep,
+                                  [](const SpikeChunkIndexEntry& entry, long long step) { return entry.lastStep < step; });
+    for (auto entry = first; entry != index.end() && entry->firstStep < toStep; ++entry) {
+        const uint8_t* chunk = bytes + entry->offset;
+        size_t position = 0;
+        long long step = entry->firstStep;
+        while (position < entry->size) {
+            step += static_cast<long long>(readVarint(chunk, entry->size, position));
+            const uint64_t count = readVarint(chunk, entry->size, position);
+            const bool inWindow = step >= fromStep && step < toStep;
+            int neuron = 0;
+            for (uint64_t k = 0; k < count; k++) {
+                neuron += static_cast<int>(readVarint(chunk, entry->size, position));
+                if (inWindow) {
+                    events.push_back({step, neuron});
+                }
+            }
+            if (step >= toStep) {
+                break;
+            }
+        }
+    }
+    return events;
+}
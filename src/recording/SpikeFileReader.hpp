@@ -0,0 +1,38 @@
+#ifndef SPIKE_FILE_READER_HPP
+#define SPIKE_FILE_READER_HPP
+
+#include "SpikeRecorder.hpp"
+#include "MappedFile.hpp"
+#include <string>
+#include <utility>
+#include <vector>
+
+struct SpikeEvent {
+    long long step;
+    int neuron;
+};
+
+/**
+ * @brief Reads spike raster files written by SpikeRecorder. The file is memory-mapped and only
+ * the chunks overlapping the requested window are decoded.
+ */
+class SpikeFileReader {
+private:
+    MappedFile file;
+    int neuronCount = 0;
+    std::vector<std::pair<int, int>> recordedRanges; // (start, count)
+    std::vector<SpikeChunkIndexEntry> index;
+
+public:
+    explicit SpikeFileReader(const std::string& path); // throws std::runtime_error on a missing or damaged file
+
+    int getNeuronCount() const { return neuronCount; }
+    const std::vector<std::pair<int, int>>& getRecordedRanges() const { return recordedRanges; }
+    const std::vector<SpikeChunkIndexEntry>& getIndex() const { return index; }
+    unsigned long long getEventCount() const;
+
+    // Events with fromStep <= step < toStep, ordered by step and then by neuron.
+    std::vector<SpikeEvent> readWindow(long long fromStep, long long toStep) const;
+};
+
+#endif // SPIKE_FILE_READER_HPP
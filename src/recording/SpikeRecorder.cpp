@@ -0,0 +1,288 @@
+#include "SpikeRecorder.hpp"
+#include "Varint.hpp"
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <iostream>
+#include <stdexcept>
+
+const char SpikeRecorder::FILE_MAGIC[8] = {'S', 'N', 'N', 'S', 'P', 'I', 'K', 'E'};
+
+SpikeRecorder::SpikeRecorder(const std::string& path, int neuronCount, const SpikeRecorderOptions& options)
+    : path(path), neuronCount(neuronCount), options(options),
+      writer(std::make_unique<BinaryWriter>(path)) {
+    if (neuronCount < 0 || this->options.chunkSteps <= 0 || this->options.bufferWords < 4) {
+        throw std::runtime_error("Niepoprawne parametry rejestratora impulsow dla pliku " + path);
+    }
+}
+
+SpikeRecorder::~SpikeRecorder() {
+    try {
+        close();
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Blad zamykania pliku impulsow " << path << ": " << e.what() << "\n";
+    }
+}
+
+void SpikeRecorder::recordGroup(const GroupInfo& rootGroup, const std::string& fullName) {
+    const GroupInfo* group = findGroupByFullName(rootGroup, fullName);
+    if (group == nullptr) {
+        throw std::runtime_error("Nie znaleziono grupy '" + fullName + "' do rejestracji impulsow.");
+    }
+    recordRange(group->startIndex, group->totalCount);
+}
+
+void SpikeRecorder::recordRange(int start, int count) {
+    if (started) {
+        throw std::runtime_error("Grupy rejestrowanych neuronow trzeba wybrac przed rozpoczeciem rejestracji.");
+    }
+    if (start < 0 || count < 0 || start + count > neuronCount) {
+        throw std::runtime_error("Zakres neuronow poza siecia w rejestratorze impulsow.");
+    }
+    if (selected.empty()) {
+        selected.assign(neuronCount, 0);
+    }
+    std::fill(selected.begin() + start, selected.begin() + start + count, uint8_t(1));
+}
+
+void SpikeRecorder::setChannelCount(int channelCount) {
+    if (closed) {
+        throw std::runtime_error("Rejestrator impulsow " + path + " zostal juz zamkniety.");
+    }
+    if (started) {
+        // nothing may be left in the old buffers, all recorded steps have been committed
+        waitUntilDrained();
+    }
+
+    std::lock_guard<std::mutex> lock(channelMutex);
+    for (const auto& channel : channels) {
+        retiredDropped += channel->dropped.load();
+    }
+    size_t capacity = 1;
+    while (capacity < options.bufferWords) {
+        capacity <<= 1;
+    }
+    channels.clear();
+    for (int c = 0; c < channelCount; c++) {
+        auto channel = std::make_unique<Channel>();
+        channel->words.assign(capacity, 0);
+        channel->mask = capacity - 1;
+        channels.push_back(std::move(channel));
+    }
+
+    if (!started) {
+        writeHeader();
+        started = true;
+        writerThread = std::thread(&SpikeRecorder::writerLoop, this);
+    }
+}
+
+// The selection is final once recording starts, the header lists it as ranges.
+void SpikeRecorder::writeHeader() {
+    std::vector<std::pair<int32_t, int32_t>> ranges;
+    if (selected.empty()) {
+        ranges.emplace_back(0, neuronCount);
+    }
+    for (int i = 0; i < static_cast<int>(selected.size()); i++) {
+        if (!selected[i]) {
+            continue;
+        }
+        if (!ranges.empty() && ranges.back().first + ranges.back().second == i) {
+            ranges.back().second++;
+        } else {
+            ranges.emplace_back(i, 1);
+        }
+    }
+    SpikeFileHeader header{};
+    std::copy(std::begin(FILE_MAGIC), std::end(FILE_MAGIC), header.magic);
+    header.version = FORMAT_VERSION;
+    header.neuronCount = neuronCount;
+    header.recordedRangeCount = static_cast<uint32_t>(ranges.size());
+    writer->write(header);
+    for (const auto& range : ranges) {
+        writer->write<int32_t>(range.first);
+        writer->write<int32_t>(range.second);
+    }
+}
+
+void SpikeRecorder::record(int channelIndex, long long step, const int* neurons, int count) {
+    Channel& channel = *channels[channelIndex];
+    const size_t head = channel.head.load(std::memory_order_relaxed);
+    const size_t tail = channel.tail.load(std::memory_order_acquire);
+    // room for the unfiltered block, so the check does not depend on the selection
+    if (3 + static_cast<size_t>(count) > channel.words.size() - (head - tail)) {
+        channel.dropped.fetch_add(count, std::memory_order_relaxed);
+        return;
+    }
+
+    uint32_t* words = channel.words.data();
+    const size_t mask = channel.mask;
+    size_t position = head + 3;
+    if (selected.empty()) {
+        for (int k = 0; k < count; k++) {
+            words[position++ & mask] = static_cast<uint32_t>(neurons[k]);
+        }
+    } else {
+        for (int k = 0; k < count; k++) {
+            if (selected[neurons[k]]) {
+                words[position++ & mask] = static_cast<uint32_t>(neurons[k]);
+            }
+        }
+    }
+    const uint32_t recorded = static_cast<uint32_t>(position - head - 3);
+    if (recorded == 0) {
+        return;
+    }
+    words[head & mask] = static_cast<uint32_t>(static_cast<unsigned long long>(step));
+    words[(head + 1) & mask] = static_cast<uint32_t>(static_cast<unsigned long long>(step) >> 32);
+    words[(head + 2) & mask] = recorded;
+    channel.head.store(position, std::memory_order_release);
+}
+
+void SpikeRecorder::commitStep(long long step) {
+    committedStep.store(step, std::memory_order_release);
+}
+
+unsigned long long SpikeRecorder::getDroppedEvents() const {
+    std::lock_guard<std::mutex> lock(channelMutex);
+    unsigned long long dropped = retiredDropped;
+    for (const auto& channel : channels) {
+        dropped += channel->dropped.load();
+    }
+    return dropped;
+}
+
+void SpikeRecorder::waitUntilDrained() {
+    while (true) {
+        bool drained = true;
+        {
+            std::lock_guard<std::mutex> lock(channelMutex);
+            for (const auto& channel : channels) {
+                drained = drained && channel->tail.load() == channel->head.load();
+            }
+        }
+        if (drained) {
+            return;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+}
+
+void SpikeRecorder::writerLoop() {
+    while (!stopping.load(std::memory_order_acquire)) {
+        if (!drainCommitted()) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+    drainCommitted();
+}
+
+bool SpikeRecorder::drainCommitted() {
+    std::lock_guard<std::mutex> lock(channelMutex);
+    const long long committed = committedStep.load(std::memory_order_acquire);
+    bool drainedAny = false;
+    while (true) {
+        // oldest committed step still waiting in any buffer
+        long long step = LLONG_MAX;
+        for (const auto& channel : channels) {
+            const size_t tail = channel->tail.load(std::memory_order_relaxed);
+            if (tail == channel->head.load(std::memory_order_acquire)) {
+                continue;
+            }
+            const uint32_t* words = channel->words.data();
+            const long long blockStep = static_cast<long long>(words[tail & channel->mask] |
+                                                               static_cast<unsigned long long>(words[(tail + 1) & channel->mask]) << 32);
+            if (blockStep <= committed) {
+                step = std::min(step, blockStep);
+            }
+        }
+        if (step == LLONG_MAX) {
+            return drainedAny;
+        }
+
+        // channels cover ascending partitions, so their blocks concatenate in neuron order
+        stepNeurons.clear();
+        for (const auto& channel : channels) {
+            size_t tail = channel->tail.load(std::memory_order_relaxed);
+            const size_t mask = channel->mask;
+            const uint32_t* words = channel->words.data();
+            while (tail != channel->head.load(std::memory_order_acquire)) {
+                const long long blockStep = static_cast<long long>(words[tail & mask] |
+                                                                   static_cast<unsigned long long>(words[(tail + 1) & mask]) << 32);
+                if (blockStep != step) {
+                    break;
+                }
+                const uint32_t count = words[(tail + 2) & mask];
+                for (uint32_t k = 0; k < count; k++) {
+                    stepNeurons.push_back(static_cast<int>(words[(tail + 3 + k) & mask]));
+                }
+                tail += 3 + count;
+            }
+            channel->tail.store(tail, std::memory_order_release);
+        }
+        if (!std::is_sorted(stepNeurons.begin(), stepNeurons.end())) {
+            std::sort(stepNeurons.begin(), stepNeurons.end());
+        }
+        encodeStep(step);
+        drainedAny = true;
+    }
+}
+
+void SpikeRecorder::encodeStep(long long step) {
+    if (!chunk.empty() && (step - currentChunk.firstStep >= options.chunkSteps || chunk.size() >= options.chunkBytes)) {
+        finishChunk();
+    }
+    if (chunk.empty()) {
+        currentChunk = SpikeChunkIndexEntry{};
+        currentChunk.firstStep = step;
+        previousStep = step;
+    }
+    appendVarint(chunk, static_cast<uint64_t>(step - previousStep));
+    appendVarint(chunk, stepNeurons.size());
+    int previousNeuron = 0;
+    for (int neuron : stepNeurons) {
+        appendVarint(chunk, static_cast<uint64_t>(neuron - previousNeuron));
+        previousNeuron = neuron;
+    }
+    previousStep = step;
+    currentChunk.lastStep = step;
+    currentChunk.eventCount += stepNeurons.size();
+    recordedEvents.fetch_add(stepNeurons.size(), std::memory_order_relaxed);
+}
+
+void SpikeRecorder::finishChunk() {
+    if (chunk.empty()) {
+        return;
+    }
+    currentChunk.offset = writer->tell();
+    currentChunk.size = chunk.size();
+    writer->writeBytes(chunk.data(), chunk.size());
+    index.push_back(currentChunk);
+    chunk.clear();
+}
+
+void SpikeRecorder::close() {
+    if (closed) {
+        return;
+    }
+    closed = true;
+    if (started) {
+        stopping.store(true, std::memory_order_release);
+        writerThread.join();
+    } else {
+        // never attached, still leave a valid file without spikes
+        writeHeader();
+    }
+    finishChunk();
+
+    SpikeFileTrailer trailer{};
+    trailer.indexOffset = writer->tell();
+    trailer.chunkCount = index.size();
+    for (const SpikeChunkIndexEntry& entry : index) {
+        writer->write(entry);
+    }
+    std::copy(std::begin(FILE_MAGIC), std::end(FILE_MAGIC), trailer.magic);
+    writer->write(trailer);
+    writer->close();
+}
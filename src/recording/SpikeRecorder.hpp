@@ -0,0 +1,132 @@
+#ifndef SPIKE_RECORDER_HPP
+#define SPIKE_RECORDER_HPP
+
+#include "SNN.hpp"
+#include "BinaryIO.hpp"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+/*
+ * Spike raster file (.spk) layout, all integers little-endian:
+ *   SpikeFileHeader, then recordedRangeCount pairs of int32 (start, count)
+ *   chunks of records: varint(step - previous step) varint(count) count x varint(neuron - previous neuron)
+ *       (the first record of a chunk is relative to the chunk's firstStep, neurons start from 0)
+ *   chunkCount x SpikeChunkIndexEntry
+ *   SpikeFileTrailer
+ * Steps without recorded spikes have no record. Chunks are decoded independently, so a time
+ * window is read by looking up the overlapping chunks in the index.
+ */
+struct SpikeFileHeader {
+    char magic[8];
+    uint32_t version;
+    int32_t neuronCount;
+    uint32_t recordedRangeCount;
+    uint32_t reserved;
+};
+
+struct SpikeChunkIndexEntry {
+    int64_t firstStep;
+    int64_t lastStep;
+    uint64_t offset; // from the beginning of the file
+    uint64_t size;   // in bytes
+    uint64_t eventCount;
+};
+
+struct SpikeFileTrailer {
+    uint64_t indexOffset;
+    uint64_t chunkCount;
+    char magic[8];
+};
+
+struct SpikeRecorderOptions {
+    size_t bufferWords = size_t(1) << 20; // capacity of each per-thread buffer, rounded up to a power of two
+    int chunkSteps = 1000;                // steps covered by one indexed chunk at most
+    size_t chunkBytes = size_t(1) << 20;  // a chunk is also closed once its encoded size reaches this
+};
+
+/**
+ * @brief Records (step, neuron) spike events of selected groups to a delta-encoded binary file.
+ *
+ * The simulation threads append the spikes of their partition to their own single-producer
+ * ring buffer and never wait: when a buffer is full, that step's events of the partition are
+ * dropped and counted (getDroppedEvents). A background thread merges the buffers step by step,
+ * encodes and writes the file, and writes the index when the recorder is closed.
+ *
+ * Attach with BasicSNN::setSpikeRecorder. Groups are selected before the recorder is attached;
+ * with no selection all neurons are recorded.
+ */
+class SpikeRecorder {
+public:
+    static constexpr uint32_t FORMAT_VERSION = 1;
+    static const char FILE_MAGIC[8];
+
+    SpikeRecorder(const std::string& path, int neuronCount, const SpikeRecorderOptions& options = SpikeRecorderOptions());
+    SpikeRecorder(const SpikeRecorder&) = delete;
+    SpikeRecorder& operator=(const SpikeRecorder&) = delete;
+    ~SpikeRecorder(); // closes the file
+
+    // Selects a group by its full name, e.g. "root.Cortex.Layer1"; throws std::runtime_error if it does not exist.
+    void recordGroup(const GroupInfo& rootGroup, const std::string& fullName);
+    void recordRange(int start, int count);
+
+    // Writes the remaining events and the index. Called by the destructor if not called before.
+    void close();
+
+    int getNeuronCount() const { return neuronCount; }
+    unsigned long long getRecordedEvents() const { return recordedEvents.load(); }
+    unsigned long long getDroppedEvents() const;
+
+    // Interface for BasicSNN: one buffer per partition, filled while integrating.
+    void setChannelCount(int channels); // starts recording on the first call
+    void record(int channel, long long step, const int* neurons, int count);
+    void commitStep(long long step);    // all channels have recorded 'step'
+
+private:
+    // single-producer single-consumer ring of 32-bit words: blocks of (step lo, step hi, count, neurons...)
+    struct Channel {
+        std::vector<uint32_t> words;
+        size_t mask = 0;
+        alignas(64) std::atomic<size_t> head{0};  // written by the producer
+        alignas(64) std::atomic<size_t> tail{0};  // written by the writer thread
+        alignas(64) std::atomic<unsigned long long> dropped{0};
+    };
+
+    std::string path;
+    int neuronCount;
+    SpikeRecorderOptions options;
+    std::vector<uint8_t> selected; // per neuron, empty = all neurons
+    std::vector<std::unique_ptr<Channel>> channels;
+    unsigned long long retiredDropped = 0; // dropped events of channels replaced by setChannelCount
+
+    std::thread writerThread;
+    mutable std::mutex channelMutex; // held by the writer while draining and by setChannelCount
+    std::atomic<long long> committedStep{-1};
+    std::atomic<bool> stopping{false};
+    std::atomic<unsigned long long> recordedEvents{0};
+    bool started = false;
+    bool closed = false;
+
+    // writer thread state
+    std::unique_ptr<BinaryWriter> writer;
+    std::vector<SpikeChunkIndexEntry> index;
+    std::vector<uint8_t> chunk;
+    SpikeChunkIndexEntry currentChunk{};
+    long long previousStep = 0;
+    std::vector<int> stepNeurons;
+
+    void writeHeader();
+    void writerLoop();
+    bool drainCommitted();
+    void encodeStep(long long step);
+    void finishChunk();
+    void waitUntilDrained();
+};
+
+#endif // SPIKE_RECORDER_HPP
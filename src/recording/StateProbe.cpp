@@ -0,0 +1,73 @@
+#include "StateProbe.hpp"
+#include "BinaryIO.hpp"
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <stdexcept>
+#include <utility>
+
+static const char PROBE_MAGIC[8] = {'S', 'N', 'N', 'P', 'R', 'O', 'B', 'E'};
+
+StateProbe::StateProbe(std::vector<int> neurons, int interval, size_t capacity)
+    : neurons(std::move(neurons)), interval(interval), capacity(capacity) {
+    if (interval < 1 || capacity < 1) {
+        throw std::runtime_error("Sonda stanu wymaga interwalu i pojemnosci co najmniej 1.");
+    }
+    steps.assign(capacity, 0);
+    values.assign(capacity * 2 * this->neurons.size(), 0.0);
+}
+
+void StateProbe::clear() {
+    nextSlot = 0;
+    sampleCount = 0;
+}
+
+void StateProbe::writeCsv(const std::string& path) const {
+    std::ofstream out(path);
+    if (!out) {
+        throw std::runtime_error("Nie mozna otworzyc pliku do zapisu: " + path);
+    }
+    out << "step";
+    for (int neuron : neurons) {
+        out << ",v_" << neuron;
+    }
+    for (int neuron : neurons) {
+        out << ",u_" << neuron;
+    }
+    out << "\n";
+    char number[32];
+    for (size_t s = 0; s < sampleCount; s++) {
+        out << getSampleStep(s);
+        const double* sampleValues = getV(s);
+        for (size_t k = 0; k < 2 * neurons.size(); k++) {
+            std::snprintf(number, sizeof(number), ",%.9g", sampleValues[k]);
+            out << number;
+        }
+        out << "\n";
+    }
+    if (!out) {
+        throw std::runtime_error("Blad zapisu pliku " + path);
+    }
+}
+
+void StateProbe::writeBinary(const std::string& path) const {
+    BinaryWriter writer(path);
+    writer.writeBytes(PROBE_MAGIC, sizeof(PROBE_MAGIC));
+    writer.write<uint32_t>(FORMAT_VERSION);
+    writer.write<int32_t>(interval);
+    writer.write<uint64_t>(neurons.size());
+    writer.write<uint64_t>(sampleCount);
+    writer.writeArray(neurons.data(), neurons.size());
+
+    // unroll the ring so that the file is in step order
+    std::vector<int64_t> orderedSteps(sampleCount);
+    for (size_t s = 0; s < sampleCount; s++) {
+        orderedSteps[s] = getSampleStep(s);
+    }
+    writer.writeArray(orderedSteps.data(), orderedSteps.size());
+    writer.align(8);
+    for (size_t s = 0; s < sampleCount; s++) {
+        writer.writeBytes(getV(s), sizeof(double) * 2 * neurons.size());
+    }
+    writer.close();
+}
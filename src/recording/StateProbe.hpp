@@ -0,0 +1,66 @@
+#ifndef STATE_PROBE_HPP
+#define STATE_PROBE_HPP
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Decimated v/u traces of a fixed set of neurons, kept in a preallocated ring of samples.
+ *
+ * Every interval steps BasicSNN copies v and u of the probed neurons into the next slot; once
+ * capacity samples are stored the oldest one is overwritten. Sampling costs time proportional to
+ * the number of probed neurons and never allocates.
+ */
+class StateProbe {
+private:
+    std::vector<int> neurons;
+    int interval;
+    size_t capacity;
+    std::vector<long long> steps;  // [capacity]
+    std::vector<double> values;    // [capacity][v of every neuron, then u of every neuron]
+    size_t nextSlot = 0;
+    size_t sampleCount = 0;
+
+    size_t slotOf(size_t sample) const { return (nextSlot + capacity - sampleCount + sample) % capacity; }
+
+public:
+    StateProbe(std::vector<int> neurons, int interval, size_t capacity); // throws std::runtime_error on interval or capacity < 1
+
+    bool isDue(long long step) const { return step % interval == 0; }
+
+    template<typename Scalar>
+    void sample(long long step, const Scalar* v, const Scalar* u) {
+        const size_t neuronCount = neurons.size();
+        double* out = values.data() + nextSlot * 2 * neuronCount;
+        for (size_t k = 0; k < neuronCount; k++) {
+            out[k] = static_cast<double>(v[neurons[k]]);
+            out[neuronCount + k] = static_cast<double>(u[neurons[k]]);
+        }
+        steps[nextSlot] = step;
+        nextSlot = (nextSlot + 1) % capacity;
+        if (sampleCount < capacity) {
+            sampleCount++;
+        }
+    }
+
+    const std::vector<int>& getNeurons() const { return neurons; }
+    int getInterval() const { return interval; }
+    size_t getCapacity() const { return capacity; }
+    size_t getSampleCount() const { return sampleCount; }
+
+    // sample 0 is the oldest one still stored
+    long long getSampleStep(size_t sample) const { return steps[slotOf(sample)]; }
+    const double* getV(size_t sample) const { return values.data() + slotOf(sample) * 2 * neurons.size(); }
+    const double* getU(size_t sample) const { return getV(sample) + neurons.size(); }
+    void clear();
+
+    // One row per sample: step, v of every neuron, u of every neuron.
+    void writeCsv(const std::string& path) const;
+    // Header, neuron indices, sample steps and the sample values in the order of getV/getU.
+    void writeBinary(const std::string& path) const;
+
+    static constexpr unsigned FORMAT_VERSION = 1;
+};
+
+#endif // STATE_PROBE_HPP
@@ -0,0 +1,83 @@
+#include "FixedStepScheduler.hpp"
+#include <algorithm>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+
+FixedStepScheduler::FixedStepScheduler(double periodMs, bool realTime)
+    : periodMs(periodMs), realTime(realTime) {
+    if (!(periodMs > 0)) {
+        throw std::runtime_error("Okres harmonogramu musi byc dodatni.");
+    }
+}
+
+// value at fraction q of the sorted latencies
+static double percentile(std::vector<float>& values, double q) {
+    if (values.empty()) {
+        return 0;
+    }
+    const size_t k = std::min(values.size() - 1, static_cast<size_t>(q * values.size()));
+    std::nth_element(values.begin(), values.begin() + k, values.end());
+    return values[k];
+}
+
+SchedulerStats FixedStepScheduler::run(long long tickCount, const std::function<void()>& tick) {
+    using Clock = std::chrono::steady_clock;
+    const auto period = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double, std::milli>(periodMs));
+    stopping.store(false, std::memory_order_relaxed);
+    latencies.clear();
+    latencies.reserve(static_cast<size_t>(std::max(0LL, std::min(tickCount, 1LL << 24))));
+
+    SchedulerStats stats;
+    double latencySum = 0;
+    const Clock::time_point start = Clock::now();
+    Clock::time_point deadline = start + period;
+    while (stats.ticks < tickCount && !stopping.load(std::memory_order_relaxed)) {
+        const Clock::time_point tickStart = Clock::now();
+        tick();
+        const Clock::time_point tickEnd = Clock::now();
+
+        const float latency = std::chrono::duration<float, std::micro>(tickEnd - tickStart).count();
+        latencies.push_back(latency);
+        latencySum += latency;
+        stats.ticks++;
+        if (tickEnd > deadline) {
+            stats.deadlineMisses++;
+            if (realTime && tickEnd > deadline + period) {
+                deadline = tickEnd; // no catch-up burst, the time line restarts after the late tick
+            }
+        } else if (realTime) {
+            std::this_thread::sleep_until(deadline);
+        }
+        deadline += period;
+    }
+
+    stats.wallSeconds = std::chrono::duration<double>(Clock::now() - start).count();
+    stats.simulatedSeconds = stats.ticks * periodMs / 1000.0;
+    stats.realTimeRatio = stats.wallSeconds > 0 ? stats.simulatedSeconds / stats.wallSeconds : 0;
+    if (stats.ticks > 0) {
+        stats.meanLatency = latencySum / stats.ticks;
+        stats.maxLatency = *std::max_element(latencies.begin(), latencies.end());
+        stats.p50Latency = percentile(latencies, 0.50);
+        stats.p90Latency = percentile(latencies, 0.90);
+        stats.p99Latency = percentile(latencies, 0.99);
+        stats.utilization = stats.meanLatency / (periodMs * 1000.0);
+    }
+    return stats;
+}
+
+std::string SchedulerStats::toJson() const {
+    std::ostringstream out;
+    out << "{\"ticks\":" << ticks
+        << ",\"deadline_misses\":" << deadlineMisses
+        << ",\"simulated_seconds\":" << simulatedSeconds
+        << ",\"wall_seconds\":" << wallSeconds
+        << ",\"real_time_ratio\":" << realTimeRatio
+        << ",\"utilization\":" << utilization
+        << ",\"latency_us\":{\"mean\":" << meanLatency
+        << ",\"p50\":" << p50Latency
+        << ",\"p90\":" << p90Latency
+        << ",\"p99\":" << p99Latency
+        << ",\"max\":" << maxLatency << "}}";
+    return out.str();
+}
@@ -0,0 +1,54 @@
+#ifndef FIXED_STEP_SCHEDULER_HPP
+#define FIXED_STEP_SCHEDULER_HPP
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <string>
+#include <vector>
+
+// Timing of a FixedStepScheduler run, latencies in microseconds.
+struct SchedulerStats {
+    long long ticks = 0;
+    long long deadlineMisses = 0; // ticks that finished after their deadline
+    double simulatedSeconds = 0;  // ticks * period
+    double wallSeconds = 0;
+    double realTimeRatio = 0;     // simulated / wall time, about 1 when paced, the achievable speed-up when free-running
+    double utilization = 0;       // mean tick latency / period, below 1 means the ticks fit into the period
+    double meanLatency = 0;       // duration of a tick
+    double p50Latency = 0;
+    double p90Latency = 0;
+    double p99Latency = 0;
+    double maxLatency = 0;
+
+    std::string toJson() const;
+};
+
+/**
+ * @brief Runs a tick function at a fixed period and measures whether it keeps up.
+ *
+ * Tick k has the deadline start + (k + 1) * period. In real-time mode the scheduler sleeps until
+ * the deadline after a tick that finished early and starts the next one at once after a late tick.
+ * A tick late by more than a whole period moves the time line to its end, so a stall is reported
+ * as misses instead of being caught up with a burst of ticks. In free-running mode the ticks run
+ * back to back and the deadlines are only measured.
+ */
+class FixedStepScheduler {
+public:
+    FixedStepScheduler(double periodMs, bool realTime);
+
+    // Runs tickCount ticks (or until stop), the statistics cover this run only.
+    SchedulerStats run(long long tickCount, const std::function<void()>& tick);
+    void stop() { stopping.store(true, std::memory_order_relaxed); } // safe from another thread
+
+    double getPeriodMs() const { return periodMs; }
+    bool isRealTime() const { return realTime; }
+
+private:
+    double periodMs;
+    bool realTime;
+    std::atomic<bool> stopping{false};
+    std::vector<float> latencies;
+};
+
+#endif // FIXED_STEP_SCHEDULER_HPP
@@ -0,0 +1,163 @@
+#include "MouseEnvironment.hpp"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+
+static const double PI = 3.14159265358979323846;
+
+static const char* const SENSOR_NAMES[MouseEnvironment::SensorCount] = {
+    "wall_left", "wall_front", "wall_right", "food_left", "food_right"
+};
+
+// angle in (-pi, pi]
+static double wrapAngle(double angle) {
+    angle = std::fmod(angle + PI, 2 * PI);
+    if (angle <= 0) {
+        angle += 2 * PI;
+    }
+    return angle - PI;
+}
+
+MouseEnvironment::MouseEnvironment(const MouseEnvironmentOptions& options, int mouseCount)
+    : options(options), rng(options.seed, 0) {
+    const double margin = options.mouseRadius + options.foodRadius;
+    if (options.arenaWidth <= 2 * margin || options.arenaHeight <= 2 * margin ||
+        options.mouseRadius <= 0 || options.wheelBase <= 0 || options.whiskerRange <= 0 || options.foodScale <= 0) {
+        throw std::runtime_error("Niepoprawne wymiary areny lub myszy w konfiguracji srodowiska.");
+    }
+    if (mouseCount < 1 || options.foodCount < 0) {
+        throw std::runtime_error("Niepoprawna liczba myszy lub kawalkow jedzenia w konfiguracji srodowiska.");
+    }
+    mice.resize(mouseCount);
+    mice[0].x = options.arenaWidth / 2;
+    mice[0].y = options.arenaHeight / 2;
+    mice[0].heading = 0;
+    for (int m = 1; m < mouseCount; m++) {
+        mice[m].x = rng.nextUniform(options.mouseRadius, options.arenaWidth - options.mouseRadius);
+        mice[m].y = rng.nextUniform(options.mouseRadius, options.arenaHeight - options.mouseRadius);
+        mice[m].heading = rng.nextUniform(-PI, PI);
+    }
+    food.resize(options.foodCount);
+    for (Food& piece : food) {
+        placeFood(piece);
+    }
+}
+
+void MouseEnvironment::move(int index, double leftWheel, double rightWheel, double dt) {
+    Mouse& mouse = mice[index];
+    leftWheel = std::max(-options.maxSpeed, std::min(options.maxSpeed, leftWheel));
+    rightWheel = std::max(-options.maxSpeed, std::min(options.maxSpeed, rightWheel));
+    const double speed = (leftWheel + rightWheel) / 2;
+    mouse.heading = wrapAngle(mouse.heading + (rightWheel - leftWheel) / options.wheelBase * dt);
+
+    // walls stop the motion across them, the mouse slides along
+    const double r = options.mouseRadius;
+    const double nx = std::max(r, std::min(options.arenaWidth - r, mouse.x + speed * std::cos(mouse.heading) * dt));
+    const double ny = std::max(r, std::min(options.arenaHeight - r, mouse.y + speed * std::sin(mouse.heading) * dt));
+    mouse.distance += std::hypot(nx - mouse.x, ny - mouse.y);
+    mouse.x = nx;
+    mouse.y = ny;
+    if (nx <= r || nx >= options.arenaWidth - r || ny <= r || ny >= options.arenaHeight - r) {
+        mouse.wallContacts++;
+    }
+}
+
+void MouseEnvironment::collectFood() {
+    const double reach = options.mouseRadius + options.foodRadius;
+    for (Mouse& mouse : mice) {
+        for (Food& piece : food) {
+            if (std::hypot(piece.x - mouse.x, piece.y - mouse.y) <= reach) {
+                mouse.foodEaten++;
+                placeFood(piece);
+            }
+        }
+    }
+}
+
+void MouseEnvironment::update(double leftWheel, double rightWheel, double dt) {
+    move(0, leftWheel, rightWheel, dt);
+    collectFood();
+}
+
+long long MouseEnvironment::getTotalFoodEaten() const {
+    long long total = 0;
+    for (const Mouse& mouse : mice) {
+        total += mouse.foodEaten;
+    }
+    return total;
+}
+
+double MouseEnvironment::sense(Sensor sensor, int mouse) const {
+    const Mouse& m = mice[mouse];
+    switch (sensor) {
+        case WallLeft: return wallProximity(m, PI / 4);
+        case WallFront: return wallProximity(m, 0);
+        case WallRight: return wallProximity(m, -PI / 4);
+        case FoodLeft: return foodSensor(m, 1);
+        case FoodRight: return foodSensor(m, -1);
+        default: return 0;
+    }
+}
+
+// 1 at contact, falling linearly to 0 at whiskerRange from the body
+double MouseEnvironment::wallProximity(const Mouse& mouse, double angle) const {
+    const double dx = std::cos(mouse.heading + angle);
+    const double dy = std::sin(mouse.heading + angle);
+    double hit = std::numeric_limits<double>::infinity();
+    if (dx > 0) hit = std::min(hit, (options.arenaWidth - mouse.x) / dx);
+    if (dx < 0) hit = std::min(hit, -mouse.x / dx);
+    if (dy > 0) hit = std::min(hit, (options.arenaHeight - mouse.y) / dy);
+    if (dy < 0) hit = std::min(hit, -mouse.y / dy);
+    const double gap = std::max(0.0, hit - options.mouseRadius);
+    return std::max(0.0, 1.0 - gap / options.whiskerRange);
+}
+
+// side is 1 for the left sensor and -1 for the right one, each looks 45 degrees to its side;
+// only the nearest piece of food is seen
+double MouseEnvironment::foodSensor(const Mouse& mouse, double side) const {
+    const Food* nearest = nullptr;
+    double nearestDistance = std::numeric_limits<double>::infinity();
+    for (const Food& piece : food) {
+        const double distance = std::hypot(piece.x - mouse.x, piece.y - mouse.y);
+        if (distance < nearestDistance) {
+            nearestDistance = distance;
+            nearest = &piece;
+        }
+    }
+    if (nearest == nullptr) {
+        return 0;
+    }
+    const double bearing = wrapAngle(std::atan2(nearest->y - mouse.y, nearest->x - mouse.x) - mouse.heading);
+    const double closeness = options.foodScale / (options.foodScale + nearestDistance);
+    return closeness * std::max(0.0, std::cos(bearing - side * PI / 4));
+}
+
+void MouseEnvironment::placeFood(Food& piece) {
+    const double margin = options.mouseRadius + options.foodRadius;
+    // a few attempts to keep the new food away from the mice, the last one is taken regardless
+    for (int attempt = 0; attempt < 8; attempt++) {
+        piece.x = rng.nextUniform(margin, options.arenaWidth - margin);
+        piece.y = rng.nextUniform(margin, options.arenaHeight - margin);
+        bool clear = true;
+        for (const Mouse& mouse : mice) {
+            clear = clear && std::hypot(piece.x - mouse.x, piece.y - mouse.y) > 4 * margin;
+        }
+        if (clear) {
+            break;
+        }
+    }
+}
+
+MouseEnvironment::Sensor MouseEnvironment::sensorFromName(const std::string& name) {
+    for (int s = 0; s < SensorCount; s++) {
+        if (name == SENSOR_NAMES[s]) {
+            return static_cast<Sensor>(s);
+        }
+    }
+    return SensorCount;
+}
+
+const char* MouseEnvironment::sensorName(Sensor sensor) {
+    return sensor < SensorCount ? SENSOR_NAMES[sensor] : "unknown";
+}
@@ -0,0 +1,96 @@
+#ifndef MOUSE_ENVIRONMENT_HPP
+#define MOUSE_ENVIRONMENT_HPP
+
+#include "CounterRng.hpp"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Geometry and physics constants of the environment, from the 'environment' section.
+// Lengths are in cm, speeds in cm/s.
+struct MouseEnvironmentOptions {
+    double arenaWidth = 100.0;
+    double arenaHeight = 100.0;
+    double mouseRadius = 3.0;
+    double wheelBase = 4.0;      // distance between the wheels, turns the wheel speed difference into rotation
+    double maxSpeed = 30.0;      // limit of each wheel
+    double whiskerRange = 15.0;  // distance at which the wall sensors start to respond
+    double foodRadius = 2.0;
+    double foodScale = 30.0;     // distance at which the food sensors give half of their maximum
+    int foodCount = 1;           // pieces of food in the arena at any time
+    uint64_t seed = 1;           // food and start placement
+};
+
+/**
+ * @brief Headless 2D arena with differential-drive mice and pieces of food.
+ *
+ * The arena is an axis-aligned rectangle [0, width] x [0, height] with solid walls. A mouse is a
+ * disc driven by a left and a right wheel; it slides along a wall it runs into. Mice do not collide
+ * with each other. Whenever a mouse reaches a piece of food, the food is eaten and placed at a new
+ * random position.
+ *
+ * move() and sense() of different mice may run concurrently; collectFood() changes the shared
+ * food and runs alone, after all mice have moved.
+ */
+class MouseEnvironment {
+public:
+    // Values of the sensors in [0, 1]
+    enum Sensor {
+        WallLeft,   // proximity of the wall along the whisker at 45 degrees to the left
+        WallFront,
+        WallRight,
+        FoodLeft,   // closeness of the nearest food, weighted by how far to the left it is
+        FoodRight,
+        SensorCount
+    };
+
+    struct Mouse {
+        double x, y;
+        double heading;  // radians, counter-clockwise from the x axis
+        double distance = 0;
+        long long foodEaten = 0;
+        long long wallContacts = 0; // moves that ended touching a wall
+    };
+    struct Food {
+        double x, y;
+    };
+
+    // The first mouse starts in the centre facing +x, the others at random positions and headings.
+    explicit MouseEnvironment(const MouseEnvironmentOptions& options = MouseEnvironmentOptions(), int mouseCount = 1);
+
+    // Moves one mouse by dt seconds with the given wheel speeds.
+    void move(int mouse, double leftWheel, double rightWheel, double dt);
+    // Mice touching food eat it, in index order, so a contested piece goes to the lowest index.
+    void collectFood();
+    // Single-mouse step: move and collectFood.
+    void update(double leftWheel, double rightWheel, double dt);
+    double sense(Sensor sensor, int mouse = 0) const;
+
+    int getMouseCount() const { return static_cast<int>(mice.size()); }
+    const Mouse& getMouse(int mouse) const { return mice[mouse]; }
+    const std::vector<Food>& getFood() const { return food; }
+    long long getTotalFoodEaten() const;
+    double getX() const { return mice[0].x; }
+    double getY() const { return mice[0].y; }
+    double getHeading() const { return mice[0].heading; }
+    long long getFoodEaten() const { return mice[0].foodEaten; }
+    long long getWallContacts() const { return mice[0].wallContacts; }
+    double getDistanceTravelled() const { return mice[0].distance; }
+    const MouseEnvironmentOptions& getOptions() const { return options; }
+
+    // Sensor by name ("wall_left", "food_right", ...), SensorCount if unknown.
+    static Sensor sensorFromName(const std::string& name);
+    static const char* sensorName(Sensor sensor);
+
+private:
+    MouseEnvironmentOptions options;
+    CounterRng rng;
+    std::vector<Mouse> mice;
+    std::vector<Food> food;
+
+    double wallProximity(const Mouse& mouse, double angle) const;
+    double foodSensor(const Mouse& mouse, double side) const;
+    void placeFood(Food& piece);
+};
+
+#endif // MOUSE_ENVIRONMENT_HPP
@@ -0,0 +1,269 @@
+#include "MouseRunner.hpp"
+#include "SNNParseException.hpp"
+#include <yaml-cpp/yaml.h>
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <set>
+#include <stdexcept>
+
+template<typename T>
+static T getOptional(const YAML::Node& parent, const std::string& key, T defaultValue, const std::string& contextPath) {
+    if (!parent[key]) {
+        return defaultValue;
+    }
+    try {
+        return parent[key].as<T>();
+    } catch (const YAML::TypedBadConversion<T>& e) {
+        throw SNNParseException("Nieprawidlowy typ danych dla klucza '" + key + "' w '" + contextPath + "'. Komunikat YAML: " + e.what(), parent[key]);
+    }
+}
+
+static std::string getRequiredString(const YAML::Node& parent, const std::string& key, const std::string& contextPath) {
+    if (!parent[key]) {
+        throw SNNParseException("Brak wymaganego klucza '" + key + "' w '" + contextPath + "'", parent);
+    }
+    return getOptional<std::string>(parent, key, "", contextPath);
+}
+
+static YAML::Node requireMapOrNull(const YAML::Node& node, const std::string& contextPath) {
+    if (node && !node.IsMap()) {
+        throw SNNParseException("Oczekiwano mapy dla '" + contextPath + "'.", node);
+    }
+    return node;
+}
+
+MouseRunnerConfig MouseRunnerConfig::loadFromYaml(const std::string& filename) {
+    MouseRunnerConfig config;
+    YAML::Node root;
+    try {
+        root = YAML::LoadFile(filename);
+    } catch (const YAML::Exception& e) {
+        throw SNNParseException("Nie mozna wczytac pliku " + filename + ": " + e.what());
+    }
+    const YAML::Node environment = requireMapOrNull(root["environment"], "environment");
+    if (!environment) {
+        return config;
+    }
+
+    config.dt = getOptional<double>(environment, "dt", config.dt, "environment");
+    config.realTime = getOptional<bool>(environment, "real_time", config.realTime, "environment");
+    config.agents = getOptional<int>(environment, "agents", config.agents, "environment");
+    if (config.agents < 1) {
+        throw SNNParseException("'agents' musi byc dodatnie w sekcji 'environment'.", environment["agents"]);
+    }
+    if (!(config.dt > 0)) {
+        throw SNNParseException("'dt' musi byc dodatnie w sekcji 'environment'.", environment["dt"]);
+    }
+
+    MouseEnvironmentOptions& options = config.environment;
+    options.seed = getOptional<uint64_t>(environment, "seed", options.seed, "environment");
+    const YAML::Node arena = requireMapOrNull(environment["arena"], "environment.arena");
+    if (arena) {
+        options.arenaWidth = getOptional<double>(arena, "width", options.arenaWidth, "environment.arena");
+        options.arenaHeight = getOptional<double>(arena, "height", options.arenaHeight, "environment.arena");
+    }
+    const YAML::Node mouse = requireMapOrNull(environment["mouse"], "environment.mouse");
+    if (mouse) {
+        options.mouseRadius = getOptional<double>(mouse, "radius", options.mouseRadius, "environment.mouse");
+        options.wheelBase = getOptional<double>(mouse, "wheel_base", options.wheelBase, "environment.mouse");
+        options.maxSpeed = getOptional<double>(mouse, "max_speed", options.maxSpeed, "environment.mouse");
+        options.whiskerRange = getOptional<double>(mouse, "whisker_range", options.whiskerRange, "environment.mouse");
+    }
+    const YAML::Node food = requireMapOrNull(environment["food"], "environment.food");
+    if (food) {
+        options.foodRadius = getOptional<double>(food, "radius", options.foodRadius, "environment.food");
+        options.foodScale = getOptional<double>(food, "scale", options.foodScale, "environment.food");
+        options.foodCount = getOptional<int>(food, "count", options.foodCount, "environment.food");
+    }
+
+    if (const YAML::Node inputs = environment["inputs"]) {
+        if (!inputs.IsSequence()) {
+            throw SNNParseException("Oczekiwano sekwencji dla 'environment.inputs'.", inputs);
+        }
+        for (const YAML::Node& node : inputs) {
+            const std::string context = "environment.inputs";
+            SensorBinding binding;
+            binding.channel = getRequiredString(node, "channel", context);
+            const std::string sensor = getRequiredString(node, "sensor", context);
+            binding.sensor = MouseEnvironment::sensorFromName(sensor);
+            if (binding.sensor == MouseEnvironment::SensorCount) {
+                throw SNNParseException("Nieznany czujnik '" + sensor + "' (dozwolone: wall_left, wall_front, wall_right, food_left, food_right).", node["sensor"]);
+            }
+            binding.gain = getOptional<double>(node, "gain", binding.gain, context);
+            binding.bias = getOptional<double>(node, "bias", binding.bias, context);
+            config.inputs.push_back(binding);
+        }
+    }
+    if (const YAML::Node outputs = environment["outputs"]) {
+        if (!outputs.IsSequence()) {
+            throw SNNParseException("Oczekiwano sekwencji dla 'environment.outputs'.", outputs);
+        }
+        for (const YAML::Node& node : outputs) {
+            const std::string context = "environment.outputs";
+            ActionBinding binding;
+            binding.channel = getRequiredString(node, "channel", context);
+            const std::string action = getRequiredString(node, "action", context);
+            bool known = false;
+            binding.action = MouseRunner::actionFromName(action, known);
+            if (!known) {
+                throw SNNParseException("Nieznana akcja '" + action + "' (dozwolone: left_wheel, right_wheel, forward, turn_left, turn_right).", node["action"]);
+            }
+            binding.gain = getOptional<double>(node, "gain", binding.gain, context);
+            binding.timeConstant = getOptional<double>(node, "time_constant", binding.timeConstant, context);
+            if (!(binding.timeConstant > 0)) {
+                throw SNNParseException("'time_constant' musi byc dodatnie w '" + context + "'.", node["time_constant"]);
+            }
+            config.outputs.push_back(binding);
+        }
+    }
+    return config;
+}
+
+MouseAction MouseRunner::actionFromName(const std::string& name, bool& known) {
+    static const std::pair<const char*, MouseAction> actions[] = {
+        {"left_wheel", MouseAction::LeftWheel}, {"right_wheel", MouseAction::RightWheel},
+        {"forward", MouseAction::Forward}, {"turn_left", MouseAction::TurnLeft}, {"turn_right", MouseAction::TurnRight}
+    };
+    for (const auto& action : actions) {
+        if (name == action.first) {
+            known = true;
+            return action.second;
+        }
+    }
+    known = false;
+    return MouseAction::Forward;
+}
+
+// Full names of the groups marked with the channel, either as input or as output.
+static void collectChannelGroups(const GroupInfo& group, const std::string& channel, bool input, std::vector<const GroupInfo*>& out) {
+    if ((input ? group.externalInput : group.actionOutput) == channel) {
+        out.push_back(&group);
+        return; // subgroups are already covered
+    }
+    for (const GroupInfo& subgroup : group.subgroups) {
+        collectChannelGroups(subgroup, channel, input, out);
+    }
+}
+
+static void collectChannelNames(const GroupInfo& group, std::set<std::string>& inputs, std::set<std::string>& outputs) {
+    if (!group.externalInput.empty()) {
+        inputs.insert(group.externalInput);
+    }
+    if (!group.actionOutput.empty()) {
+        outputs.insert(group.actionOutput);
+    }
+    for (const GroupInfo& subgroup : group.subgroups) {
+        collectChannelNames(subgroup, inputs, outputs);
+    }
+}
+
+MouseController::MouseController(SNN& snn, const MouseRunnerConfig& config)
+    : snn(snn), dt(config.dt), halfWheelBase(config.environment.wheelBase / 2) {
+    const GroupInfo& root = snn.getRootGroup();
+    for (const SensorBinding& binding : config.inputs) {
+        std::vector<const GroupInfo*> groups;
+        collectChannelGroups(root, binding.channel, true, groups);
+        if (groups.empty()) {
+            throw std::runtime_error("Zadna grupa nie ma 'external_input: " + binding.channel + "'.");
+        }
+        Input input{binding.sensor, binding.gain, binding.bias, {}};
+        for (const GroupInfo* group : groups) {
+            input.groupIds.push_back(snn.addInputGroup(group->fullName));
+        }
+        inputs.push_back(input);
+    }
+
+    std::vector<NeuronRange> allRanges;
+    for (const ActionBinding& binding : config.outputs) {
+        std::vector<const GroupInfo*> groups;
+        collectChannelGroups(root, binding.channel, false, groups);
+        if (groups.empty()) {
+            throw std::runtime_error("Zadna grupa nie ma 'action_output: " + binding.channel + "'.");
+        }
+        Output output{binding.action, binding.gain, 1.0 - std::exp(-config.dt / binding.timeConstant), 0, {}};
+        for (const GroupInfo* group : groups) {
+            output.ranges.push_back({group->startIndex, group->totalCount});
+            output.neuronCount += group->totalCount;
+        }
+        allRanges.insert(allRanges.end(), output.ranges.begin(), output.ranges.end());
+        outputs.push_back(output);
+    }
+    std::sort(allRanges.begin(), allRanges.end(), [](const NeuronRange& x, const NeuronRange& y) { return x.start < y.start; });
+    for (size_t r = 1; r < allRanges.size(); r++) {
+        if (allRanges[r].start < allRanges[r - 1].start + allRanges[r - 1].count) {
+            throw std::runtime_error("Neuron " + std::to_string(allRanges[r].start) + " nalezy do wiecej niz jednego wyjscia akcji.");
+        }
+    }
+}
+
+void MouseController::reportUnboundChannels(const GroupInfo& root, const MouseRunnerConfig& config) {
+    std::set<std::string> unboundInputs, unboundOutputs;
+    collectChannelNames(root, unboundInputs, unboundOutputs);
+    for (const SensorBinding& binding : config.inputs) {
+        unboundInputs.erase(binding.channel);
+    }
+    for (const ActionBinding& binding : config.outputs) {
+        unboundOutputs.erase(binding.channel);
+    }
+    for (const std::string& channel : unboundInputs) {
+        std::cerr << "Ostrzezenie: wejscie '" << channel << "' nie ma czujnika w sekcji 'environment', grupy nie dostana pradu.\n";
+    }
+    for (const std::string& channel : unboundOutputs) {
+        std::cerr << "Ostrzezenie: wyjscie '" << channel << "' nie ma akcji w sekcji 'environment' i jest ignorowane.\n";
+    }
+}
+
+void MouseController::sense(const MouseEnvironment& environment, int mouse) {
+    for (const Input& input : inputs) {
+        const double current = input.bias + input.gain * environment.sense(input.sensor, mouse);
+        for (int groupId : input.groupIds) {
+            snn.injectGroupCurrent(groupId, current);
+        }
+    }
+}
+
+void MouseController::step() {
+    snn.step(dt);
+
+    // the fired list is in ascending order, so the spikes of a range are counted by two searches
+    const int* firedBegin = snn.getFiredNeurons();
+    const int* firedEnd = firedBegin + snn.getFiredCount();
+    double left = 0, right = 0, forward = 0, turn = 0;
+    for (Output& output : outputs) {
+        long long spikes = 0;
+        for (const NeuronRange& range : output.ranges) {
+            const int* first = std::lower_bound(firedBegin, firedEnd, range.start);
+            spikes += std::lower_bound(first, firedEnd, range.start + range.count) - first;
+        }
+        const double rate = output.neuronCount > 0 ? spikes * 1000.0 / (output.neuronCount * dt) : 0.0;
+        output.rate += (rate - output.rate) * output.smoothing;
+        const double command = output.gain * output.rate;
+        switch (output.action) {
+            case MouseAction::LeftWheel: left += command; break;
+            case MouseAction::RightWheel: right += command; break;
+            case MouseAction::Forward: forward += command; break;
+            case MouseAction::TurnLeft: turn += command; break;
+            case MouseAction::TurnRight: turn -= command; break;
+        }
+    }
+    leftWheel = forward + left - turn * halfWheelBase;
+    rightWheel = forward + right + turn * halfWheelBase;
+}
+
+MouseRunner::MouseRunner(SNN& snn, const MouseRunnerConfig& config)
+    : config(config), environment(config.environment), controller(snn, config), scheduler(config.dt, config.realTime) {
+    MouseController::reportUnboundChannels(snn.getRootGroup(), config);
+}
+
+void MouseRunner::tick() {
+    controller.sense(environment, 0);
+    controller.step();
+    environment.update(controller.getLeftWheel(), controller.getRightWheel(), config.dt / 1000.0);
+    ticks++;
+}
+
+SchedulerStats MouseRunner::run(double simulatedSeconds) {
+    const long long tickCount = static_cast<long long>(std::llround(simulatedSeconds * 1000.0 / config.dt));
+    return scheduler.run(tickCount, [this]() { tick(); });
+}
@@ -0,0 +1,118 @@
+#ifndef MOUSE_RUNNER_HPP
+#define MOUSE_RUNNER_HPP
+
+#include "SNN.hpp"
+#include "MouseEnvironment.hpp"
+#include "FixedStepScheduler.hpp"
+#include <string>
+#include <vector>
+
+// Motor commands a motor group can drive; wheel speeds in cm/s, turn rates in rad/s.
+enum class MouseAction { LeftWheel, RightWheel, Forward, TurnLeft, TurnRight };
+
+// Sensor feeding the groups marked with 'external_input: <channel>': every neuron of the groups
+// receives bias + gain * value of the sensor as input current.
+struct SensorBinding {
+    std::string channel;
+    MouseEnvironment::Sensor sensor;
+    double gain = 10.0;
+    double bias = 0.0;
+};
+
+// Action driven by the groups marked with 'action_output: <channel>': the command is gain times the
+// mean firing rate of the groups (Hz), low-pass filtered with timeConstant (ms).
+struct ActionBinding {
+    std::string channel;
+    MouseAction action;
+    double gain = 0.5;
+    double timeConstant = 50.0;
+};
+
+// Closed-loop setup from the optional 'environment' section of the network configuration.
+struct MouseRunnerConfig {
+    MouseEnvironmentOptions environment;
+    double dt = 1.0;       // ms of simulated time per step
+    bool realTime = true;  // pace the steps to the wall clock, otherwise run as fast as possible
+    int agents = 1;        // mice, each with its own copy of the network state (see MultiMouseRunner)
+    std::vector<SensorBinding> inputs;
+    std::vector<ActionBinding> outputs;
+
+    // Defaults when the file has no 'environment' section; throws SNNParseException for a malformed one.
+    static MouseRunnerConfig loadFromYaml(const std::string& filename);
+};
+
+/**
+ * @brief Connects one network to one mouse of a MouseEnvironment.
+ *
+ * sense() encodes the sensors into the input currents of the sensory groups, step() advances the
+ * network and decodes the spike rates of the motor groups into wheel speeds. Channels are resolved
+ * to neuron ranges once, at construction.
+ */
+class MouseController {
+public:
+    // snn must outlive the controller; throws std::runtime_error for a channel no group is marked with.
+    MouseController(SNN& snn, const MouseRunnerConfig& config);
+
+    void sense(const MouseEnvironment& environment, int mouse);
+    void step();
+    double getLeftWheel() const { return leftWheel; }   // cm/s, from the last step
+    double getRightWheel() const { return rightWheel; }
+    double getActionRate(int output) const { return outputs[output].rate; } // filtered rate, Hz
+    int getOutputCount() const { return static_cast<int>(outputs.size()); }
+    SNN& getNetwork() { return snn; }
+
+    // Warns on std::cerr about channels of the groups that the configuration does not bind.
+    static void reportUnboundChannels(const GroupInfo& root, const MouseRunnerConfig& config);
+
+private:
+    struct Input {
+        MouseEnvironment::Sensor sensor;
+        double gain, bias;
+        std::vector<int> groupIds; // SNN input groups of the channel
+    };
+    struct Output {
+        MouseAction action;
+        double gain;
+        double smoothing;  // 1 - exp(-dt / timeConstant)
+        int neuronCount;
+        std::vector<NeuronRange> ranges;
+        double rate = 0;
+    };
+
+    SNN& snn;
+    double dt;
+    double halfWheelBase;
+    std::vector<Input> inputs;
+    std::vector<Output> outputs;
+    double leftWheel = 0, rightWheel = 0;
+};
+
+/**
+ * @brief Headless closed loop of a network and a single mouse.
+ *
+ * Every tick senses, advances the network by one step and moves the mouse. run() paces the ticks
+ * with a FixedStepScheduler, whose statistics tell whether the network keeps up with real time.
+ */
+class MouseRunner {
+public:
+    MouseRunner(SNN& snn, const MouseRunnerConfig& config);
+
+    void tick(); // one closed-loop step
+    SchedulerStats run(double simulatedSeconds);
+    void stop() { scheduler.stop(); } // ends run() from another thread
+
+    const MouseEnvironment& getEnvironment() const { return environment; }
+    const MouseController& getController() const { return controller; }
+    long long getTickCount() const { return ticks; }
+
+    static MouseAction actionFromName(const std::string& name, bool& known);
+
+private:
+    MouseRunnerConfig config;
+    MouseEnvironment environment;
+    MouseController controller;
+    FixedStepScheduler scheduler;
+    long long ticks = 0;
+};
+
+#endif // MOUSE_RUNNER_HPP
@@ -0,0 +1,40 @@
+#include "MultiMouseRunner.hpp"
+#include <cmath>
+#include <stdexcept>
+
+MultiMouseRunner::MultiMouseRunner(std::shared_ptr<const NetworkTopology> topology, const MouseRunnerConfig& config,
+                                   int agentCount, int threads)
+    : config(config), environment(config.environment, agentCount), pool(threads),
+      scheduler(config.dt, config.realTime) {
+    if (!topology) {
+        throw std::runtime_error("Brak topologii sieci.");
+    }
+    MouseController::reportUnboundChannels(topology->rootGroup, config);
+    agents.reserve(agentCount);
+    controllers.reserve(agentCount);
+    for (int a = 0; a < agentCount; a++) {
+        agents.push_back(std::make_unique<SNN>(topology, 1)); // parallelism comes from the agents
+        agents.back()->setInputStream(static_cast<uint32_t>(a)); // every mouse its own background input
+        controllers.push_back(std::make_unique<MouseController>(*agents.back(), config));
+    }
+    agentTask = [this](int agent) { tickAgent(agent); };
+}
+
+void MultiMouseRunner::tickAgent(int agent) {
+    // a mouse only reads its own position and the food, which stays put until collectFood
+    MouseController& controller = *controllers[agent];
+    controller.sense(environment, agent);
+    controller.step();
+    environment.move(agent, controller.getLeftWheel(), controller.getRightWheel(), config.dt / 1000.0);
+}
+
+void MultiMouseRunner::tick() {
+    pool.parallelFor(getAgentCount(), agentTask);
+    environment.collectFood();
+    ticks++;
+}
+
+SchedulerStats MultiMouseRunner::run(double simulatedSeconds) {
+    const long long tickCount = static_cast<long long>(std::llround(simulatedSeconds * 1000.0 / config.dt));
+    return scheduler.run(tickCount, [this]() { tick(); });
+}
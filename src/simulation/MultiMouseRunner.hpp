@@ -0,0 +1,48 @@
+#ifndef MULTI_MOUSE_RUNNER_HPP
+#define MULTI_MOUSE_RUNNER_HPP
+
+#include "MouseRunner.hpp"
+#include "WorkStealingPool.hpp"
+#include <memory>
+#include <vector>
+
+/**
+ * @brief Many mice in one arena, each driven by its own instance of the same network.
+ *
+ * The agents share one immutable NetworkTopology (loaded once) and keep only their own state, so
+ * memory grows with the neuron count rather than the synapse count per agent. A tick senses, steps
+ * the network and moves the mouse of every agent in parallel on a WorkStealingPool (every agent
+ * runs single-threaded); after the barrier the food is collected in agent order. The result does
+ * not depend on the number of threads.
+ */
+class MultiMouseRunner {
+public:
+    // threads = 0 uses one thread per hardware thread.
+    MultiMouseRunner(std::shared_ptr<const NetworkTopology> topology, const MouseRunnerConfig& config,
+                     int agentCount, int threads);
+
+    void tick();
+    SchedulerStats run(double simulatedSeconds);
+    void stop() { scheduler.stop(); }
+
+    int getAgentCount() const { return static_cast<int>(agents.size()); }
+    SNN& getAgent(int agent) { return *agents[agent]; }
+    const MouseController& getController(int agent) const { return *controllers[agent]; }
+    const MouseEnvironment& getEnvironment() const { return environment; }
+    int getThreadCount() const { return pool.size(); }
+    long long getTickCount() const { return ticks; }
+
+private:
+    MouseRunnerConfig config;
+    MouseEnvironment environment;
+    std::vector<std::unique_ptr<SNN>> agents;
+    std::vector<std::unique_ptr<MouseController>> controllers;
+    WorkStealingPool pool;
+    FixedStepScheduler scheduler;
+    std::function<void(int)> agentTask;
+    long long ticks = 0;
+
+    void tickAgent(int agent);
+};
+
+#endif // MULTI_MOUSE_RUNNER_HPP
@@ -0,0 +1,194 @@
+#ifndef BINARY_IO_HPP
+#define BINARY_IO_HPP
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+/**
+ * @brief Sequential writer of raw little-endian binary records (native layout, no conversion).
+ *
+ * Arrays can be aligned so that a reader working on a memory-mapped file sees naturally
+ * aligned data.
+ */
+class BinaryWriter {
+private:
+    std::ofstream out;
+    uint64_t position = 0;
+
+public:
+    explicit BinaryWriter(const std::string& path) : out(path, std::ios::binary | std::ios::trunc) {
+        if (!out) {
+            throw std::runtime_error("Nie mozna otworzyc pliku do zapisu: " + path);
+        }
+    }
+
+    template<typename T>
+    void write(const T& value) {
+        static_assert(std::is_trivially_copyable<T>::value, "BinaryWriter::write requires a trivially copyable type");
+        writeBytes(&value, sizeof(T));
+    }
+
+    template<typename T>
+    void writeArray(const T* values, size_t count) {
+        static_assert(std::is_trivially_copyable<T>::value, "BinaryWriter::writeArray requires a trivially copyable type");
+        align(8);
+        writeBytes(values, sizeof(T) * count);
+    }
+
+    template<typename T>
+    void writeVector(const std::vector<T>& values) {
+        write<uint64_t>(values.size());
+        writeArray(values.data(), values.size());
+    }
+
+    void writeString(const std::string& value) {
+        write<uint32_t>(static_cast<uint32_t>(value.size()));
+        writeBytes(value.data(), value.size());
+    }
+
+    void writeBytes(const void* bytes, size_t size) {
+        out.write(static_cast<const char*>(bytes), static_cast<std::streamsize>(size));
+        position += size;
+    }
+
+    void align(size_t alignment) {
+        static const char zeros[16] = {};
+        const size_t padding = (alignment - position % alignment) % alignment;
+        writeBytes(zeros, padding);
+    }
+
+    uint64_t tell() const { return position; }
+
+    void close() {
+        out.flush();
+        if (!out) {
+            throw std::runtime_error("Blad zapisu pliku binarnego.");
+        }
+        out.close();
+    }
+};
+
+/**
+ * @brief BinaryWriter into a growing memory buffer, for images that are assembled first and
+ * written in one piece. clear() keeps the capacity, so a reused buffer stops allocating.
+ */
+class BinaryBufferWriter {
+private:
+    std::vector<char> bytes;
+
+public:
+    template<typename T>
+    void write(const T& value) {
+        static_assert(std::is_trivially_copyable<T>::value, "BinaryBufferWriter::write requires a trivially copyable type");
+        writeBytes(&value, sizeof(T));
+    }
+
+    template<typename T>
+    void writeArray(const T* values, size_t count) {
+        static_assert(std::is_trivially_copyable<T>::value, "BinaryBufferWriter::writeArray requires a trivially copyable type");
+        align(8);
+        writeBytes(values, sizeof(T) * count);
+    }
+
+    template<typename T>
+    void writeVector(const std::vector<T>& values) {
+        write<uint64_t>(values.size());
+        writeArray(values.data(), values.size());
+    }
+
+    void writeBytes(const void* source, size_t size) {
+        const char* first = static_cast<const char*>(source);
+        bytes.insert(bytes.end(), first, first + size);
+    }
+
+    void align(size_t alignment) {
+        bytes.resize(bytes.size() + (alignment - bytes.size() % alignment) % alignment, 0);
+    }
+
+    uint64_t tell() const { return bytes.size(); }
+    const std::vector<char>& data() const { return bytes; }
+    void clear() { bytes.clear(); }
+};
+
+/**
+ * @brief Bounds-checked reader over an in-memory (typically memory-mapped) binary buffer
+ * written by BinaryWriter. Throws std::runtime_error when the data ends prematurely.
+ */
+class BinaryReader {
+private:
+    const char* data;
+    size_t size;
+    size_t position = 0;
+
+    void require(size_t bytes) const {
+        if (bytes > size - position) {
+            throw std::runtime_error("Nieoczekiwany koniec pliku binarnego.");
+        }
+    }
+
+public:
+    BinaryReader(const void* data, size_t size) : data(static_cast<const char*>(data)), size(size) {}
+
+    template<typename T>
+    T read() {
+        static_assert(std::is_trivially_copyable<T>::value, "BinaryReader::read requires a trivially copyable type");
+        T value;
+        readBytes(&value, sizeof(T));
+        return value;
+    }
+
+    // Returns a pointer to count elements inside the buffer without copying them.
+    template<typename T>
+    const T* viewArray(size_t count) {
+        align(8);
+        if (count > (size - position) / sizeof(T)) {
+            throw std::runtime_error("Nieoczekiwany koniec pliku binarnego.");
+        }
+        const T* values = reinterpret_cast<const T*>(data + position);
+        position += sizeof(T) * count;
+        return values;
+    }
+
+    template<typename T>
+    void readArray(T* values, size_t count) {
+        const T* source = viewArray<T>(count);
+        std::memcpy(values, source, sizeof(T) * count);
+    }
+
+    template<typename T>
+    void readVector(std::vector<T>& values) {
+        const uint64_t count = read<uint64_t>();
+        const T* source = viewArray<T>(count);
+        values.assign(source, source + count);
+    }
+
+    std::string readString() {
+        const uint32_t length = read<uint32_t>();
+        require(length);
+        std::string value(data + position, length);
+        position += length;
+        return value;
+    }
+
+    void readBytes(void* bytes, size_t count) {
+        require(count);
+        std::memcpy(bytes, data + position, count);
+        position += count;
+    }
+
+    void align(size_t alignment) {
+        const size_t padding = (alignment - position % alignment) % alignment;
+        require(padding);
+        position += padding;
+    }
+
+    size_t tell() const { return position; }
+    size_t remaining() const { return size - position; }
+};
+
+#endif // BINARY_IO_HPP
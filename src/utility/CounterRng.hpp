@@ -0,0 +1,141 @@
+#ifndef COUNTER_RNG_HPP
+#define COUNTER_RNG_HPP
+
+#include <cmath>
+#include <cstdint>
+
+/**
+ * @brief Counter-based random stream built on Philox4x32-10 (Salmon et al., "Parallel random
+ * numbers: as easy as 1, 2, 3").
+ *
+ * The output is a pure function of (seed, stream, position), so every connection rule and every
+ * neuron can own an independent stream that gives the same numbers no matter which thread, or in
+ * which order, it is consumed. Creating a stream costs nothing, no state has to be seeded.
+ */
+class CounterRng {
+public:
+    using Block = uint32_t[4];
+
+    // One Philox4x32-10 block: 4 random words for the 128-bit counter under the 64-bit key.
+    static void philox(const uint32_t counter[4], uint64_t key, uint32_t out[4]) {
+        uint32_t c0 = counter[0], c1 = counter[1], c2 = counter[2], c3 = counter[3];
+        uint32_t k0 = static_cast<uint32_t>(key), k1 = static_cast<uint32_t>(key >> 32);
+        for (int round = 0; round < 10; round++) {
+            const uint64_t p0 = static_cast<uint64_t>(0xD2511F53u) * c0;
+            const uint64_t p1 = static_cast<uint64_t>(0xCD9E8D57u) * c2;
+            const uint32_t hi0 = static_cast<uint32_t>(p0 >> 32), lo0 = static_cast<uint32_t>(p0);
+            const uint32_t hi1 = static_cast<uint32_t>(p1 >> 32), lo1 = static_cast<uint32_t>(p1);
+            c0 = hi1 ^ c1 ^ k0;
+            c1 = lo1;
+            c2 = hi0 ^ c3 ^ k1;
+            c3 = lo0;
+            k0 += 0x9E3779B9u;
+            k1 += 0xBB67AE85u;
+        }
+        out[0] = c0; out[1] = c1; out[2] = c2; out[3] = c3;
+    }
+
+    CounterRng(uint64_t seed, uint64_t stream) : key(seed) {
+        counter[0] = 0;
+        counter[1] = 0;
+        counter[2] = static_cast<uint32_t>(stream);
+        counter[3] = static_cast<uint32_t>(stream >> 32);
+    }
+
+    uint32_t nextUint32() {
+        if (bufferPos == 4) {
+            philox(counter, key, buffer);
+            if (++counter[0] == 0) {
+                ++counter[1];
+            }
+            bufferPos = 0;
+        }
+        return buffer[bufferPos++];
+    }
+
+    // Advances the stream by count words, as if nextUint32 had been called count times.
+    void skip(uint64_t count) {
+        const uint64_t nextBlock = (static_cast<uint64_t>(counter[1]) << 32) | counter[0];
+        const uint64_t position = nextBlock * 4 - (4 - bufferPos) + count;
+        setBlock(position / 4);
+        bufferPos = 4;
+        if (position % 4 != 0) {
+            nextUint32(); // generates the block
+            bufferPos = static_cast<int>(position % 4);
+        }
+    }
+
+    uint64_t nextUint64() {
+        const uint64_t hi = nextUint32();
+        return (hi << 32) | nextUint32();
+    }
+
+    // uniform in [0, 1) with 53 random bits
+    double nextDouble() {
+        return static_cast<double>(nextUint64() >> 11) * (1.0 / 9007199254740992.0);
+    }
+
+    double nextUniform(double min, double max) {
+        return min + (max - min) * nextDouble();
+    }
+
+    // uniform integer in [0, maxExclusive), unbiased (Lemire's multiply-and-reject)
+    int nextInt(int maxExclusive) {
+        if (maxExclusive <= 0) {
+            return 0;
+        }
+        const uint32_t range = static_cast<uint32_t>(maxExclusive);
+        uint64_t product = static_cast<uint64_t>(nextUint32()) * range;
+        uint32_t low = static_cast<uint32_t>(product);
+        if (low < range) {
+            const uint32_t threshold = (0u - range) % range;
+            while (low < threshold) {
+                product = static_cast<uint64_t>(nextUint32()) * range;
+                low = static_cast<uint32_t>(product);
+            }
+        }
+        return static_cast<int>(product >> 32);
+    }
+
+    // Box-Muller, the second value of each pair is kept for the next call
+    double nextNormal(double mean, double stddev) {
+        if (hasSpare) {
+            hasSpare = false;
+            return mean + stddev * spare;
+        }
+        double u1 = nextDouble();
+        while (u1 <= 0.0) {
+            u1 = nextDouble();
+        }
+        const double u2 = nextDouble();
+        const double radius = std::sqrt(-2.0 * std::log(u1));
+        const double angle = 6.283185307179586 * u2;
+        spare = radius * std::sin(angle);
+        hasSpare = true;
+        return mean + stddev * radius * std::cos(angle);
+    }
+
+    // Largest rule index and sub-index streamId can tell apart; callers reject larger ones.
+    static constexpr uint32_t MAX_STREAM_INDEX = 0xFFFFu;
+
+    // Stream identifiers: a 16-bit rule index, a 16-bit sub-index (e.g. matched group pair)
+    // and a 32-bit element index (e.g. neuron) packed into one 64-bit stream number.
+    static uint64_t streamId(uint32_t rule, uint32_t sub, uint32_t element) {
+        return (static_cast<uint64_t>(rule & 0xFFFFu) << 48) | (static_cast<uint64_t>(sub & 0xFFFFu) << 32) | element;
+    }
+
+private:
+    void setBlock(uint64_t block) {
+        counter[0] = static_cast<uint32_t>(block);
+        counter[1] = static_cast<uint32_t>(block >> 32);
+    }
+
+    uint64_t key;
+    uint32_t counter[4];
+    uint32_t buffer[4] = {0, 0, 0, 0};
+    int bufferPos = 4;
+    bool hasSpare = false;
+    double spare = 0.0;
+};
+
+#endif // COUNTER_RNG_HPP
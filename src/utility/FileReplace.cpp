@@ -0,0 +1,44 @@
+#include "FileReplace.hpp"
+#include <stdexcept>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <cstdio>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#ifndef _WIN32
+// fsync of a file or directory; returns false on failure.
+static bool syncPath(const std::string& path, int flags) {
+    const int fd = ::open(path.c_str(), flags);
+    if (fd < 0) {
+        return false;
+    }
+    const bool synced = ::fsync(fd) == 0;
+    ::close(fd);
+    return synced;
+}
+#endif
+
+void replaceFile(const std::string& tempPath, const std::string& path) {
+#ifdef _WIN32
+    // replaces an existing file, and write-through waits until the move is on the disk
+    if (!MoveFileExA(tempPath.c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH)) {
+        throw std::runtime_error("Nie mozna zapisac pliku " + path);
+    }
+#else
+    if (!syncPath(tempPath, O_RDONLY)) {
+        throw std::runtime_error("Nie mozna zapisac na dysk pliku " + tempPath);
+    }
+    // rename replaces path atomically
+    if (std::rename(tempPath.c_str(), path.c_str()) != 0) {
+        throw std::runtime_error("Nie mozna zapisac pliku " + path);
+    }
+    // the new directory entry, best effort: some file systems cannot sync a directory
+    const size_t slash = path.find_last_of('/');
+    syncPath(slash == std::string::npos ? "." : (slash == 0 ? "/" : path.substr(0, slash)), O_RDONLY | O_DIRECTORY);
+#endif
+}
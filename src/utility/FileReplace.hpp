@@ -0,0 +1,11 @@
+#ifndef FILE_REPLACE_HPP
+#define FILE_REPLACE_HPP
+
+#include <string>
+
+// Moves the completely written tempPath over path in one step, so that a crash leaves either the
+// old or the new file at path, never none or a truncated one. The data of tempPath is flushed to
+// the disk first, so this also holds after a power loss. Throws std::runtime_error.
+void replaceFile(const std::string& tempPath, const std::string& path);
+
+#endif // FILE_REPLACE_HPP
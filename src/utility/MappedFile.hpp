@@ -0,0 +1,36 @@
+#ifndef MAPPED_FILE_HPP
+#define MAPPED_FILE_HPP
+
+#include <cstddef>
+#include <string>
+
+/**
+ * @brief Read-only memory mapping of a whole file (mmap on POSIX, MapViewOfFile on Windows).
+ */
+class MappedFile {
+private:
+    const void* mapping = nullptr;
+    size_t mappedSize = 0;
+#ifdef _WIN32
+    void* fileHandle = nullptr;
+    void* mappingHandle = nullptr;
+#endif
+
+    void unmap();
+
+public:
+    MappedFile() = default;
+    explicit MappedFile(const std::string& path); // throws std::runtime_error if the file cannot be mapped
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    MappedFile(MappedFile&& other) noexcept;
+    MappedFile& operator=(MappedFile&& other) noexcept;
+    ~MappedFile();
+
+    const void* data() const { return mapping; }
+    size_t size() const { return mappedSize; }
+
+    static bool exists(const std::string& path);
+};
+
+#endif // MAPPED_FILE_HPP
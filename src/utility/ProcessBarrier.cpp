@@ -0,0 +1,66 @@
+#include "ProcessBarrier.hpp"
+#include <thread>
+
+#ifdef __linux__
+#include <ctime>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+// The futex calls are not FUTEX_PRIVATE: the word is shared between processes.
+static void sleepWhileEqual(std::atomic<uint32_t>& word, uint32_t value, int milliseconds) {
+#ifdef __linux__
+    struct timespec timeout;
+    timeout.tv_sec = milliseconds / 1000;
+    timeout.tv_nsec = static_cast<long>(milliseconds % 1000) * 1000000L;
+    ::syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word), FUTEX_WAIT, value, &timeout, nullptr, 0);
+#else
+    (void)word;
+    (void)value;
+    (void)milliseconds;
+    std::this_thread::yield();
+#endif
+}
+
+void ProcessBarrier::wakeAll() {
+#ifdef __linux__
+    ::syscall(SYS_futex, reinterpret_cast<uint32_t*>(&generation), FUTEX_WAKE, INT32_MAX, nullptr, nullptr, 0);
+#endif
+}
+
+bool ProcessBarrier::wait(const std::function<void()>& poll) {
+    const uint32_t current = generation.load(std::memory_order_acquire);
+    if (isAborted()) {
+        return false;
+    }
+    if (arrived.fetch_add(1, std::memory_order_acq_rel) + 1 == parties) {
+        // reset before releasing, the released parties may arrive at the next wait right away
+        arrived.store(0, std::memory_order_relaxed);
+        generation.fetch_add(1, std::memory_order_release);
+        wakeAll();
+        return !isAborted();
+    }
+
+    // a step of a small partition is short, so spin a little before sleeping
+    const int SPIN_LIMIT = 64;
+    for (int spin = 0; spin < SPIN_LIMIT && generation.load(std::memory_order_acquire) == current; spin++) {
+        std::this_thread::yield();
+    }
+    while (generation.load(std::memory_order_acquire) == current) {
+        if (isAborted()) {
+            return false;
+        }
+        sleepWhileEqual(generation, current, POLL_MILLISECONDS);
+        if (poll && generation.load(std::memory_order_acquire) == current) {
+            poll();
+        }
+    }
+    return !isAborted();
+}
+
+void ProcessBarrier::abort() {
+    aborted.store(1, std::memory_order_release);
+    generation.fetch_add(1, std::memory_order_release);
+    wakeAll();
+}
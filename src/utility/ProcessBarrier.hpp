@@ -0,0 +1,40 @@
+#ifndef PROCESS_BARRIER_HPP
+#define PROCESS_BARRIER_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+
+/**
+ * @brief Reusable barrier for threads of different processes, placed in memory they share.
+ *
+ * Construct it in a MAP_SHARED mapping before forking. Waiters spin briefly and then sleep on a
+ * futex (Linux; elsewhere they yield), waking every POLL_MILLISECONDS to run the caller's poll
+ * function, e.g. to notice that another process died. abort() releases every waiter, now and in
+ * later waits, and makes wait return false, so that no process is left behind at the barrier.
+ */
+class ProcessBarrier {
+public:
+    static constexpr int POLL_MILLISECONDS = 100;
+
+    explicit ProcessBarrier(int parties) : parties(static_cast<uint32_t>(parties)) {}
+    ProcessBarrier(const ProcessBarrier&) = delete;
+    ProcessBarrier& operator=(const ProcessBarrier&) = delete;
+
+    // Returns false if the barrier was aborted before or while waiting.
+    bool wait(const std::function<void()>& poll = {});
+    void abort();
+    bool isAborted() const { return aborted.load(std::memory_order_acquire) != 0; }
+
+private:
+    const uint32_t parties;
+    std::atomic<uint32_t> arrived{0};
+    std::atomic<uint32_t> generation{0}; // futex word, advanced by the last arriving party
+    std::atomic<uint32_t> aborted{0};
+
+    void wakeAll();
+};
+
+static_assert(std::atomic<uint32_t>::is_always_lock_free, "ProcessBarrier needs lock-free 32-bit atomics");
+
+#endif // PROCESS_BARRIER_HPP
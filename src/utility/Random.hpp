@@ -1,31 +0,0 @@
-#ifndef RANDOM_HPP
-#define RANDOM_HPP
-
-#include <random>
-
-/**
- * @brief Singleton class for random number generation.
- */
-class Random {
-private:
-    std::mt19937 engine;
-
-    Random();
-public:
-    Random(const Random&) = delete;
-    Random& operator=(const Random&) = delete;
-    
-    static Random& getInstance();
-    void setSeed(unsigned int seed);
-
-    static double getNormal(double mean, double stddev);
-    static double getUniform(double min, double max);
-    static double nextDouble();
-    static int nextInt(int maxExclusive);
-    static int getInt(int min, int max);
-
-    template<typename RandomIt>
-    static void shuffle(RandomIt first, RandomIt last);
-};
-
-#endif // RANDOM_HPP
\ No newline at end of file
@@ -0,0 +1,91 @@
+#include "ThreadPool.hpp"
+
+static constexpr int SPIN_ITERATIONS = 20000;
+
+ThreadPool::ThreadPool(int threadCount) {
+    const int workerCount = resolveThreadCount(threadCount) - 1;
+    workers.reserve(workerCount);
+    for (int i = 0; i < workerCount; i++) {
+        workers.emplace_back(&ThreadPool::workerLoop, this, i + 1);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+        generation.fetch_add(1, std::memory_order_release);
+    }
+    wakeWorkers.notify_all();
+    for (auto& worker : workers) {
+        worker.join();
+    }
+}
+
+int ThreadPool::resolveThreadCount(int requested) {
+    if (requested > 0) {
+        return requested;
+    }
+    const unsigned int hardware = std::thread::hardware_concurrency();
+    return hardware > 0 ? static_cast<int>(hardware) : 1;
+}
+
+void ThreadPool::run(const std::function<void(int)>& fn) {
+    if (workers.empty()) {
+        fn(0);
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        task = &fn;
+        pending.store(static_cast<int>(workers.size()), std::memory_order_relaxed);
+        generation.fetch_add(1, std::memory_order_release);
+    }
+    wakeWorkers.notify_all();
+
+    fn(0);
+
+    for (int spin = 0; spin < SPIN_ITERATIONS; spin++) {
+        if (pending.load(std::memory_order_acquire) == 0) {
+            return;
+        }
+        std::this_thread::yield();
+    }
+    std::unique_lock<std::mutex> lock(mutex);
+    wakeCaller.wait(lock, [this] { return pending.load(std::memory_order_acquire) == 0; });
+}
+
+void ThreadPool::workerLoop(int index) {
+    unsigned long long seen = 0;
+    while (true) {
+        // wait for the next generation, spinning first
+        bool started = false;
+        for (int spin = 0; spin < SPIN_ITERATIONS; spin++) {
+            if (generation.load(std::memory_order_acquire) != seen) {
+                started = true;
+                break;
+            }
+            std::this_thread::yield();
+        }
+        const std::function<void(int)>* current;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            if (!started) {
+                wakeWorkers.wait(lock, [&] { return generation.load(std::memory_order_acquire) != seen; });
+            }
+            if (stopping) {
+                return;
+            }
+            seen = generation.load(std::memory_order_acquire);
+            current = task;
+        }
+
+        (*current)(index);
+
+        if (pending.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            std::lock_guard<std::mutex> lock(mutex);
+            wakeCaller.notify_one();
+        }
+    }
+}
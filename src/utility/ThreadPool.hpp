@@ -0,0 +1,45 @@
+#ifndef THREAD_POOL_HPP
+#define THREAD_POOL_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief Persistent pool of worker threads running one data-parallel task at a time.
+ *
+ * run(task) calls task(i) for every i in [0, size()), index 0 on the calling thread,
+ * and returns once all of them have finished. Workers spin briefly before sleeping,
+ * so back-to-back calls (e.g. once per simulation step) avoid the wake-up latency.
+ */
+class ThreadPool {
+private:
+    std::vector<std::thread> workers;
+    const std::function<void(int)>* task = nullptr;
+
+    std::mutex mutex;
+    std::condition_variable wakeWorkers;
+    std::condition_variable wakeCaller;
+    std::atomic<unsigned long long> generation{0};
+    std::atomic<int> pending{0};
+    bool stopping = false;
+
+    void workerLoop(int index);
+
+public:
+    explicit ThreadPool(int threadCount); // total number of threads, including the caller
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+    ~ThreadPool();
+
+    int size() const { return static_cast<int>(workers.size()) + 1; }
+    void run(const std::function<void(int)>& task);
+
+    // 0 means one thread per hardware thread
+    static int resolveThreadCount(int requested);
+};
+
+#endif // THREAD_POOL_HPP
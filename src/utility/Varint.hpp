@@ -0,0 +1,34 @@
+#ifndef VARINT_HPP
+#define VARINT_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+// LEB128 unsigned varints: 7 bits per byte, high bit set on all bytes but the last.
+inline void appendVarint(std::vector<uint8_t>& out, uint64_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<uint8_t>(value) | 0x80);
+        value >>= 7;
+    }
+    out.push_back(static_cast<uint8_t>(value));
+}
+
+// Decodes one varint at data[position], advancing position. Throws std::runtime_error past end.
+inline uint64_t readVarint(const uint8_t* data, size_t size, size_t& position) {
+    uint64_t value = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        if (position >= size) {
+            throw std::runtime_error("Nieoczekiwany koniec danych varint.");
+        }
+        const uint8_t byte = data[position++];
+        value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0) {
+            return value;
+        }
+    }
+    throw std::runtime_error("Niepoprawna wartosc varint.");
+}
+
+#endif // VARINT_HPP
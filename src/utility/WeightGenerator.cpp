@@ -1,8 +1,8 @@
 #include "WeightGenerator.hpp"
 #include <stdexcept>
 
-WeightGenerator::WeightGenerator(Random& random, GenerationType type, double p1, double p2)
-    : random(random), type(type), p1(p1), p2(p2) {
+WeightGenerator::WeightGenerator(GenerationType type, double p1, double p2)
+    : type(type), p1(p1), p2(p2) {
     switch (type) {
         case GenerationType::FIXED:
             break;
@@ -21,38 +21,48 @@ WeightGenerator::WeightGenerator(Random& random, GenerationType type, double p1,
     }
 }
 
-WeightGenerator WeightGenerator::createFixed(Random& random, double fixedValue) {
-    return WeightGenerator(random, GenerationType::FIXED, fixedValue, 0.0);
+WeightGenerator WeightGenerator::createFixed(double fixedValue) {
+    return WeightGenerator(GenerationType::FIXED, fixedValue, 0.0);
 }
 
-WeightGenerator WeightGenerator::createUniform(Random& random, double min, double max) {
+WeightGenerator WeightGenerator::createUniform(double min, double max) {
     if (min > max) {
         throw std::invalid_argument("Minimalna wartość rozkładu jednostajnego nie może być większa niż maksymalna.");
     }
-    return WeightGenerator(random, GenerationType::UNIFORM, min, max);
+    return WeightGenerator(GenerationType::UNIFORM, min, max);
 }
 
-WeightGenerator WeightGenerator::createNormal(Random& random, double mean, double std) {
+WeightGenerator WeightGenerator::createNormal(double mean, double std) {
     if (std < 0) {
         throw std::invalid_argument("Odchylenie standardowe rozkładu normalnego nie może być ujemne.");
     }
-    return WeightGenerator(random, GenerationType::NORMAL, mean, std);
+    return WeightGenerator(GenerationType::NORMAL, mean, std);
 }
 
-double WeightGenerator::generate() const {
+double WeightGenerator::generate(CounterRng& rng) const {
     switch (type) {
         case GenerationType::FIXED:
             return p1;
 
         case GenerationType::UNIFORM: {
-            return random.getUniform(p1, p2);
+            return rng.nextUniform(p1, p2);
         }
 
         case GenerationType::NORMAL: {
-            return random.getNormal(p1, p2);
+            return rng.nextNormal(p1, p2);
         }
 
         default:
             throw std::runtime_error("Nieznany typ generowania wagi.");
     }
-}
\ No newline at end of file
+}
+int WeightGenerator::wordsPerDraw() const {
+    switch (type) {
+        case GenerationType::FIXED:
+            return 0;
+        case GenerationType::UNIFORM:
+            return 2; // one nextDouble
+        default:
+            return -1; // Box-Muller keeps a spare value and rejects zero
+    }
+}
@@ -1,7 +1,7 @@
 #ifndef WEIGHT_GENERATOR_HPP
 #define WEIGHT_GENERATOR_HPP
 
-#include "Random.hpp"
+#include "CounterRng.hpp"
 
 class WeightGenerator {
 public:
@@ -13,18 +13,20 @@ public:
 
 private:
     GenerationType type;
-    Random &random;
     double p1 = 0.0;
     double p2 = 0.0;
     
-    WeightGenerator(Random& random, GenerationType type, double p1, double p2);
+    WeightGenerator(GenerationType type, double p1, double p2);
 
 public:
-    static WeightGenerator createFixed(Random& random, double fixedValue);
-    static WeightGenerator createUniform(Random& random, double min, double max);
-    static WeightGenerator createNormal(Random& random, double mean, double std);
+    static WeightGenerator createFixed(double fixedValue);
+    static WeightGenerator createUniform(double min, double max);
+    static WeightGenerator createNormal(double mean, double std);
 
-    double generate() const;
+    // draws from the given stream, so weights are reproducible per connection rule and neuron
+    double generate(CounterRng& rng) const;
+    // random words one generate call consumes, -1 if that varies from call to call
+    int wordsPerDraw() const;
 };
 
 #endif // WEIGHT_GENERATOR_HPP
\ No newline at end of file
@@ -0,0 +1,76 @@
+#include "WorkStealingPool.hpp"
+
+WorkStealingPool::WorkStealingPool(int threadCount)
+    : pool(threadCount), shares(new Share[pool.size()]) {
+    workerTask = [this](int thread) { work(thread); };
+}
+
+void WorkStealingPool::parallelFor(int count, const std::function<void(int)>& fn) {
+    if (count <= 0) {
+        return;
+    }
+    const int threads = size();
+    for (int t = 0; t < threads; t++) {
+        const uint32_t begin = static_cast<uint32_t>(static_cast<long long>(count) * t / threads);
+        const uint32_t end = static_cast<uint32_t>(static_cast<long long>(count) * (t + 1) / threads);
+        shares[t].range.store(pack(begin, end), std::memory_order_relaxed);
+    }
+    body = &fn;
+    pool.run(workerTask); // publishes the shares to the workers and waits for all of them
+    body = nullptr;
+}
+
+void WorkStealingPool::work(int thread) {
+    uint32_t item;
+    while (true) {
+        while (takeOwn(thread, item)) {
+            (*body)(static_cast<int>(item));
+        }
+        if (!steal(thread)) {
+            return; // nothing left anywhere; items still running elsewhere finish before run() returns
+        }
+    }
+}
+
+bool WorkStealingPool::takeOwn(int thread, uint32_t& item) {
+    std::atomic<uint64_t>& range = shares[thread].range;
+    uint64_t current = range.load(std::memory_order_acquire);
+    while (beginOf(current) < endOf(current)) {
+        if (range.compare_exchange_weak(current, pack(beginOf(current) + 1, endOf(current)), std::memory_order_acq_rel)) {
+            item = beginOf(current);
+            return true;
+        }
+    }
+    return false;
+}
+
+bool WorkStealingPool::steal(int thread) {
+    const int threads = size();
+    while (true) {
+        // victim with the most items left
+        int victim = -1;
+        uint64_t victimRange = 0;
+        uint32_t most = 0;
+        for (int t = 0; t < threads; t++) {
+            const uint64_t range = shares[t].range.load(std::memory_order_acquire);
+            const uint32_t left = endOf(range) > beginOf(range) ? endOf(range) - beginOf(range) : 0;
+            if (t != thread && left > most) {
+                most = left;
+                victim = t;
+                victimRange = range;
+            }
+        }
+        if (victim < 0) {
+            return false;
+        }
+        // take the back half, at least one item
+        const uint32_t begin = beginOf(victimRange);
+        const uint32_t end = endOf(victimRange);
+        const uint32_t middle = begin + (end - begin) / 2;
+        if (shares[victim].range.compare_exchange_strong(victimRange, pack(begin, middle), std::memory_order_acq_rel)) {
+            // our own share is empty, nobody else changes it
+            shares[thread].range.store(pack(middle, end), std::memory_order_release);
+            return true;
+        }
+    }
+}
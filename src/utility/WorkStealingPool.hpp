@@ -0,0 +1,46 @@
+#ifndef WORK_STEALING_POOL_HPP
+#define WORK_STEALING_POOL_HPP
+
+#include "ThreadPool.hpp"
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+
+/**
+ * @brief Parallel loop over independent items of uneven cost, balanced by work stealing.
+ *
+ * parallelFor(count, body) gives every thread an equal contiguous share of [0, count). A thread
+ * takes items from the front of its own share; once it runs dry it steals the back half of the
+ * largest remaining share of another thread. A share is one atomic word (begin, end), so taking
+ * and stealing are single compare-and-swaps. The threads are those of a ThreadPool, and
+ * parallelFor returns only when every item has finished, which makes it a barrier.
+ */
+class WorkStealingPool {
+public:
+    explicit WorkStealingPool(int threadCount); // total number of threads including the caller, 0 = hardware
+
+    int size() const { return pool.size(); }
+    void parallelFor(int count, const std::function<void(int)>& body);
+
+private:
+    struct alignas(64) Share {
+        std::atomic<uint64_t> range{0}; // begin in the low, end in the high 32 bits
+    };
+
+    ThreadPool pool;
+    std::unique_ptr<Share[]> shares;
+    const std::function<void(int)>* body = nullptr;
+    std::function<void(int)> workerTask;
+
+    static uint64_t pack(uint32_t begin, uint32_t end) { return static_cast<uint64_t>(end) << 32 | begin; }
+    static uint32_t beginOf(uint64_t range) { return static_cast<uint32_t>(range); }
+    static uint32_t endOf(uint64_t range) { return static_cast<uint32_t>(range >> 32); }
+
+    void work(int thread);
+    bool takeOwn(int thread, uint32_t& item);
+    bool steal(int thread);
+};
+
+#endif // WORK_STEALING_POOL_HPP
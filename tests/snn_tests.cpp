@@ -0,0 +1,240 @@
+// snn_tests: regression tests of the simulation core, run by ctest (see CMakeLists.txt).
+//
+//   snn_tests construction | simulation | input-reference <file> | input-compare <file>
+//
+// Each invocation runs one test and exits with 0 when it passes. The tests check the guarantees the
+// rest of the code relies on: the same seed gives the same network for any number of threads and
+// either construction mode; SNN, PartitionedSNN and a run restored from a checkpoint fire the same
+// spikes; and the background input is the same for every SIMD level (SNN_CPU_LEVEL, set by ctest:
+// input-reference writes the hash of the scalar input, input-compare checks the wider levels against it).
+#include "SNN.hpp"
+#include "NetworkTopologyLoader.hpp"
+#include "PartitionedSNN.hpp"
+#include "InputGenerator.hpp"
+#include "IzhikevichKernels.hpp"
+#include "Hash.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <exception>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+static int failures = 0;
+
+#define CHECK(condition)                                                                  \
+    do {                                                                                  \
+        if (!(condition)) {                                                               \
+            std::cerr << __FILE__ << ":" << __LINE__ << ": check failed: " #condition "\n"; \
+            failures++;                                                                   \
+        }                                                                                 \
+    } while (0)
+
+// Excitatory (RS and tonic PM) and inhibitory groups with stored, degree-based and procedural
+// rules, noise and Poisson input.
+static std::string networkYaml(int threads, const std::string& construction) {
+    std::ostringstream yaml;
+    yaml << "simulation:\n  seed: 42\n  threads: " << threads << "\n  construction: " << construction << "\n"
+         << "neuron_types:\n"
+         << "  RS: {a: 0.02, b: 0.2, c: -65.0, d: 8.0, v0: -70.0, u0: -14.0}\n"
+         << "  PM: {a: 0.02, b: 0.25, c: -65.0, d: 6.0, v0: -64.0, u0: -16.0}\n"
+         << "  FS: {a: 0.1, b: 0.2, c: -65.0, d: 2.0, v0: -70.0, u0: -14.0}\n"
+         << "groups:\n"
+         << "  - name: \"E\"\n    neurons:\n"
+         << "      - {type: RS, count: 1500}\n"
+         << "      - {type: PM, count: 100}\n"
+         << "  - name: \"I\"\n    neurons:\n"
+         << "      - {type: FS, count: 400}\n"
+         << "connections:\n"
+         << "  - {from: E, to: E, from_type: RS, to_type: RS, rule: {type: probabilistic, probability: 0.02},\n"
+         << "     weight: {uniform: {min: 0.0, max: 3.0}}, delay: 3}\n"
+         << "  - {from: E, to: I, from_type: PM, to_type: all, rule: {type: fixed_out_degree, count: 40},\n"
+         << "     weight: {uniform: {min: 0.0, max: 4.0}}, delay: 1}\n"
+         << "  - {from: E, to: I, from_type: RS, to_type: FS, rule: {type: fixed_in_degree, count: 30},\n"
+         << "     weight: {uniform: {min: 0.0, max: 2.0}}, delay: 2}\n"
+         << "  - {from: I, to: E, from_type: FS, to_type: RS, rule: {type: probabilistic, probability: 0.05},\n"
+         << "     weight: {fixed: -2.0}, delay: 1, procedural: true}\n"
+         << "inputs:\n"
+         << "  - {group: E, type: noise, mean: 1.0, std: 4.0}\n"
+         << "  - {group: I, type: poisson, rate: 10.0, sources: 50, weight: 1.5}\n";
+    return yaml.str();
+}
+
+static std::shared_ptr<const NetworkTopology> loadNetwork(int threads, const std::string& construction) {
+    const std::string path = "snn_tests_network.yaml";
+    std::ofstream(path) << networkYaml(threads, construction);
+    auto topology = NetworkTopology::create(NetworkTopologyLoader().loadFromYaml<SNNScalar>(path));
+    std::remove(path.c_str());
+    return topology;
+}
+
+static bool sameSynapses(const SynapseMatrix& a, const SynapseMatrix& b) {
+    return a.offsets == b.offsets && a.targets == b.targets && a.weights == b.weights && a.delays == b.delays &&
+           a.maxDelay == b.maxDelay && a.procedural.size() == b.procedural.size() &&
+           a.proceduralOffsets == b.proceduralOffsets && a.proceduralIndex == b.proceduralIndex;
+}
+
+static void testConstruction() {
+    const auto reference = loadNetwork(1, "rows");
+    CHECK(reference->synapses.synapseCount() > 0);
+    CHECK(!reference->synapses.procedural.empty());
+    CHECK(sameSynapses(reference->synapses, loadNetwork(4, "rows")->synapses));
+    CHECK(sameSynapses(reference->synapses, loadNetwork(1, "two_pass")->synapses));
+    CHECK(sameSynapses(reference->synapses, loadNetwork(3, "two_pass")->synapses));
+}
+
+using SpikeTrain = std::vector<std::vector<int>>; // the sorted fired neurons of every step
+
+template<typename Network>
+static void run(Network& network, int steps, SpikeTrain& spikes) {
+    for (int s = 0; s < steps; s++) {
+        network.step(0.5);
+        std::vector<int> fired(network.getFiredNeurons(), network.getFiredNeurons() + network.getFiredCount());
+        std::sort(fired.begin(), fired.end());
+        spikes.push_back(std::move(fired));
+    }
+}
+
+static size_t spikeCount(const SpikeTrain& spikes) {
+    size_t count = 0;
+    for (const std::vector<int>& fired : spikes) {
+        count += fired.size();
+    }
+    return count;
+}
+
+static void testSimulation() {
+    const int steps = 400;
+    const auto topology = loadNetwork(1, "rows");
+
+#ifdef __linux__
+    // forks its workers, so it comes before any SNN starts threads
+    SpikeTrain partitioned;
+    {
+        PartitionedSNN network(topology, 3);
+        run(network, steps, partitioned);
+    }
+#endif
+
+    SpikeTrain reference;
+    {
+        SNN network(topology, 1);
+        run(network, steps, reference);
+    }
+    CHECK(spikeCount(reference) > static_cast<size_t>(steps));
+#ifdef __linux__
+    CHECK(partitioned == reference);
+#endif
+
+    SpikeTrain threaded;
+    {
+        SNN network(topology, 4);
+        run(network, steps, threaded);
+    }
+    CHECK(threaded == reference);
+
+    // a checkpoint halfway, restored into a new simulation of the same network
+    const std::string checkpoint = "snn_tests.ckpt";
+    SpikeTrain restored;
+    {
+        SNN network(topology, 1);
+        run(network, steps / 2, restored);
+        network.saveCheckpoint(checkpoint);
+    }
+    {
+        SNN network(topology, 1);
+        network.loadCheckpoint(checkpoint);
+        CHECK(network.getCurrentStep() == steps / 2);
+        run(network, steps - steps / 2, restored);
+    }
+    std::remove(checkpoint.c_str());
+    CHECK(restored == reference);
+}
+
+// Hash of the input of 20 steps to 1300 neurons from noise, Poisson and a noise source with an
+// interval, added in two ranges that split a chunk.
+static uint64_t inputHash() {
+    std::vector<InputSource> sources(3);
+    sources[0].type = InputSource::Type::Noise;
+    sources[0].ranges = {{0, 1000}};
+    sources[0].mean = 1.0;
+    sources[0].stddev = 2.0;
+    sources[1].type = InputSource::Type::Poisson;
+    sources[1].ranges = {{300, 1000}};
+    sources[1].rate = 40.0;
+    sources[1].sources = 50;
+    sources[1].weight = 0.5;
+    sources[2].type = InputSource::Type::Noise;
+    sources[2].ranges = {{0, 700}, {900, 400}};
+    sources[2].stddev = 1.0;
+    sources[2].interval = 3;
+
+    const int neurons = 1300;
+    const int split = 517;
+    InputGenerator<double> generator(sources, 7);
+    generator.setStream(2);
+    uint64_t hash = fnv1a64(nullptr, 0);
+    for (long long step = 0; step < 20; step++) {
+        std::vector<double> input(neurons, 0.0);
+        generator.prepare(0.5);
+        generator.addCurrents(step, 0, split, input.data());
+        generator.addCurrents(step, split, neurons, input.data() + split);
+        hash = fnv1a64(input.data(), input.size() * sizeof(double), hash);
+    }
+    return hash;
+}
+
+static const char* cpuLevelName() {
+    switch (IzhikevichKernels::cpuLevel()) {
+        case IzhikevichKernels::CpuLevel::Avx512:
+            return "avx512";
+        case IzhikevichKernels::CpuLevel::Avx2:
+            return "avx2";
+        default:
+            return "scalar";
+    }
+}
+
+static void testInputReference(const std::string& path) {
+    std::ofstream out(path);
+    out << inputHash() << "\n";
+    CHECK(static_cast<bool>(out));
+}
+
+static void testInputCompare(const std::string& path) {
+    std::ifstream in(path);
+    uint64_t expected = 0;
+    in >> expected;
+    CHECK(static_cast<bool>(in));
+    const uint64_t hash = inputHash();
+    if (hash != expected) {
+        std::cerr << "input on " << cpuLevelName() << ": " << hash << ", reference: " << expected << "\n";
+    }
+    CHECK(hash == expected);
+}
+
+int main(int argc, char** argv) {
+    const std::string test = argc > 1 ? argv[1] : "";
+    const std::string file = argc > 2 ? argv[2] : "";
+    try {
+        if (test == "construction") {
+            testConstruction();
+        } else if (test == "simulation") {
+            testSimulation();
+        } else if (test == "input-reference" && !file.empty()) {
+            testInputReference(file);
+        } else if (test == "input-compare" && !file.empty()) {
+            testInputCompare(file);
+        } else {
+            std::cerr << "Uzycie: snn_tests construction | simulation | input-reference <plik> | input-compare <plik>\n";
+            return 2;
+        }
+    } catch (const std::exception& e) {
+        std::cerr << test << ": " << e.what() << "\n";
+        return 1;
+    }
+    std::cout << test << " (" << cpuLevelName() << "): " << (failures == 0 ? "OK" : "FAILED") << "\n";
+    return failures == 0 ? 0 : 1;
+}